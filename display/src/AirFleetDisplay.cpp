@@ -18,6 +18,17 @@ LiquidCrystal lcd(D7, D6, D5, D4, D3, D2);
 // Mutex lock to avoid async functions to communicate with LCD simultaneously
 os_mutex_t lcdLock;
 
+// Advertising intervals (x 0.625 ms). Advertise fast for a while after a
+// disconnect, so the sensor finds us again quickly, then slow down.
+#define ADV_FAST_INTERVAL	32		// 20 ms
+#define ADV_SLOW_INTERVAL	160		// 100 ms
+#define ADV_FAST_PERIOD_MS	30000
+
+// Set by disconnect callback, handled in loop
+volatile bool advFastRequested = false;
+bool advFast = false;
+unsigned long advFastTime = 0;
+
 // Flash state
 enum FlashState {
 	DISABLE,
@@ -49,6 +60,8 @@ void disconnectedCallback(const BlePeerDevice& peer, void* context) {
 	lcd.setCursor(0, 3);
 	lcd.print("Afbrudt             ");
 	os_mutex_unlock(lcdLock);
+
+	advFastRequested = true;
 }
 
 // LCD clear
@@ -138,8 +151,11 @@ void setup() {
     BleAdvertisingData advData;
     advData.appendServiceUUID(serviceUuid);
 
-	// Start advertising device
+	// Start advertising device, fast until the sensor has found us
+	BLE.setAdvertisingInterval(ADV_FAST_INTERVAL);
     BLE.advertise(&advData);
+	advFast = true;
+	advFastTime = millis();
 
 	// Setup LCD and show current state
 	lcd.begin(20, 4);
@@ -149,6 +165,18 @@ void setup() {
 }
 
 void loop() {
+	// Fast advertising after disconnect
+	if (advFastRequested) {
+		advFastRequested = false;
+		BLE.setAdvertisingInterval(ADV_FAST_INTERVAL);
+		advFast = true;
+		advFastTime = millis();
+	}
+	else if (advFast && millis() - advFastTime >= ADV_FAST_PERIOD_MS) {
+		BLE.setAdvertisingInterval(ADV_SLOW_INTERVAL);
+		advFast = false;
+	}
+
 	switch (flashState) {
 		case DISABLE:
 			break;
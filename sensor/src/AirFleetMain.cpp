@@ -11,9 +11,31 @@
 #include "Htu31.h"
 #include "Mics.h"
 #include "L86.h"
+#include "MemStats.h"
+#include "Profiler.h"
+#include "Radio.h"
+#include "Journal.h"
+#include "SampleLog.h"
+#include "UsbExport.h"
+#include "Burst.h"
+#include "Battery.h"
+#include "Scheduler.h"
+#include "TimeBase.h"
+#include "Sample.h"
+#include "Fixed.h"
+#include "RollingStats.h"
+#include "Recirc.h"
+#include "Hotspots.h"
+#include "Energy.h"
+#include "Trace.h"
+#include "WarmStart.h"
+#include "Text.h"
 
 #include "Settings.h"
 
+// A sample as JSON must fit a journal record
+static_assert(SAMPLE_JSON_LEN < JOURNAL_RECORD_LEN, "JOURNAL_RECORD_LEN too short for a sample");
+
 // Run manual mode so we can control WiFi etc.
 SYSTEM_MODE(MANUAL);
 
@@ -40,9 +62,44 @@ Mics mics;
 // L86 GPS module
 L86 l86;
 
+// Heap and free memory watermark
+MemStats memStats;
+
+// WiFi/cloud sessions
+Radio radio;
+
+// Samples waiting to be published
+Journal journal;
+
+// Published samples in flash, and their export over USB
+SampleLog sampleLog;
+UsbExport usbExport(sampleLog);
+
+// High rate samples around exposure events
+BurstCapture burst;
+
+// Battery voltage and ignition
+Battery battery;
+
+// Events and deadlines for the main loop
+Scheduler scheduler;
+
+// Cabin recirculation output
+Recirc recirc;
+
+// Historical levels per map cell
+Hotspots hotspots;
+
+// Trends of max PM part and CO2, for display and alerts
+RollingStats pmStats;
+RollingStats co2Stats;
+
 // Past averages [CO2, PM1, PM2.5, PM4, PM10]
 float_t past_average[5] = {0., 0., 0., 0., 0.};
 
+// Last millis, when past averages were requested, 0 if never
+system_tick_t levelsTime = 0;
+
 // States
 enum State {
   INIT,
@@ -50,25 +107,56 @@ enum State {
   SAMPLE,
   PUBLISH,
   SLEEP,
-  LEVELS
+  LEVELS,
+  UPLOAD
 };
 State state = INIT;
 
+// Each state is timed in its own profiler slot, PROF_STATE_INIT + state
+static_assert(PROF_STATE_INIT + IDLE == PROF_STATE_IDLE && PROF_STATE_INIT + SAMPLE == PROF_STATE_SAMPLE &&
+  PROF_STATE_INIT + PUBLISH == PROF_STATE_PUBLISH && PROF_STATE_INIT + SLEEP == PROF_STATE_SLEEP &&
+  PROF_STATE_INIT + LEVELS == PROF_STATE_LEVELS && PROF_STATE_INIT + UPLOAD == PROF_STATE_UPLOAD,
+  "ProfSlot state slots must follow State");
+
 // Prototypes
-String generate_scale(float_t val, float_t minval, float_t maxval, float_t prev, uint8_t width);
+bool alert_level(const RollingStats &stats, float_t maxval, bool active);
 void airfleet_levels(const char *event, const char *data);
-void disconnectCloud();
-bool connectCloud();
+void airfleet_hotspots(const char *event, const char *data);
+bool check_hotspots(const int32_t *pos, const uint16_t *pm_max, const uint16_t *cv);
 void triggerSample();
-bool isIgnitionOn();
-float_t getBatteryV();
+void sampleBattery();
+void burst_sample();
+void save_warm_state();
+void restore_warm_state();
+String timingVariable();
+String radioVariable();
+String statsVariable();
+String recircVariable();
+String hotspotsVariable();
+String gpsVariable();
+String energyVariable();
+String traceVariable();
+String warmVariable();
+String exportVariable();
+String burstVariable();
+String batteryVariable();
+int timingFunction(String arg);
 
 // Timer that triggers sample every X sec.
 Timer sampleTimer(SAMPLE_INTERVAL_MS, triggerSample);
 
+// Timer that samples battery voltage, and posts ignition changes
+Timer batteryTimer(BATTERY_SAMPLE_MS, sampleBattery);
+
 // Flag that forces LCD update
 bool forceLcdUpdate = false;
 
+// Millis at ignition, 0 at power on
+system_tick_t bootTime = 0;
+
+// Millis when sample timer fires next, 0 until it has fired
+volatile system_tick_t nextSampleAt = 0;
+
 void setup() {
 
 #ifdef AIRFLEET_DEBUG
@@ -86,68 +174,243 @@ void setup() {
   sen50 = Sen50();
   htu31 = Htu31();
   mics = Mics();
-  l86 = L86();
 
-  // Subscribe to air quality levels
+  // Resume trip state from before a reset, unless this is a cold boot
+  if (warmStart.begin()) restore_warm_state();
+
+  // Recirculation output, open until first sample
+  recirc.begin();
+
+  // Hotspot map from flash
+  hotspots.begin();
+
+  // Log of published samples in flash
+  sampleLog.begin();
+
+  // GPS disciplined time base
+  timeBase.begin();
+
+  // Event queue, must exist before sample timer starts
+  scheduler.begin();
+
+  // Timing instrumentation, available from cloud and USB serial
+  profiler.begin();
+  traceLog.begin();
+  Particle.variable("timing", timingVariable);
+  Particle.function("timing", timingFunction);
+  Particle.variable("radio", radioVariable);
+  Particle.variable("stats", statsVariable);
+  Particle.variable("recirc", recircVariable);
+  Particle.variable("hotspots", hotspotsVariable);
+  Particle.variable("gps", gpsVariable);
+  Particle.variable("energy", energyVariable);
+  Particle.variable("trace", traceVariable);
+  Particle.variable("warm", warmVariable);
+  Particle.variable("export", exportVariable);
+  Particle.variable("burst", burstVariable);
+  Particle.variable("battery", batteryVariable);
+
+  // Subscribe to air quality levels and hotspot map updates
   Particle.subscribe("hook-response/air-quality-request", airfleet_levels, MY_DEVICES);
+  Particle.subscribe("hook-response/air-quality-hotspots", airfleet_hotspots, MY_DEVICES);
 
-  // Start sample timer
+  // Start sample and battery timers
   sampleTimer.start();
+  battery.begin();
+  batteryTimer.start();
 }
 
 void loop() {
-  // Last millis, when data was published to cloud
-  static system_tick_t publishTime = 0;
-
-  // Last millis, when we got average PMs
-  static system_tick_t levelsTime = 0;
+  // Last millis, when a sample was published from the journal
+  static system_tick_t uploadTime = 0;
 
-  // Last known good samples
-  static float_t log_pm[4] = { 0., 0., 0., 0. };
-  static float_t log_th[2] = { 0., 0. };
+  // Last known good samples, fixed point as in SampleSchema.h
+  static uint16_t log_pm[4] = { 0, 0, 0, 0 };
+  static int16_t log_th[2] = { 0, 0 };
   static uint16_t log_cv[2] = { 0, 0 };
-  static String log_datetime = "0000-00-00 00:00:00";
-  static float_t log_gps[4] = { 0., 0., 0., 0. };
-
-  String datetime;
-  float_t pm[4];
+  static uint64_t log_time = 0;
+  static GpsSample log_gps = { 0, 0, 0, 0 };
+  static int32_t log_pos[2] = { 0, 0 };
+  static uint16_t log_batt = 0;
+  static uint8_t log_flags = 0;
+
+  // State last seen by the trace log
+  static State tracedState = SLEEP;
+
+  // Sensors up since ignition, bit per sensor
+  static uint8_t boot_ready = 0;
+
+  // Active alerts
+  static bool pm_alert = false;
+  static bool co2_alert = false;
+  static bool hotspot_ahead = false;
+
+  uint64_t sample_time;
+  ClockText clock;
+  LcdLine line;
+  uint16_t pm[4];
+  uint16_t pm_max;
   uint8_t pm_result;
-  float_t th[2];
+  int16_t th[2];
   uint8_t th_result;
   uint16_t cv[2];
   uint8_t cv_result;
-  float_t gps[4];
+  GpsSample gps;
   uint8_t gps_result;
+  system_tick_t acquired;
+  int32_t pos[2];
+
+  // Timing of this pass
+  profiler.loopMark();
+  State curState = state;
+  if (curState != tracedState) {
+    TRACE(STATE, curState);
+    tracedState = curState;
+  }
+  ProfTicks stateTicks = profiler.start();
+  ProfTicks ticks;
+  ProfTicks readTicks;
+  uint8_t ready;
 
   // State machine
   switch (state) {
     case INIT:
-      // Wake up everything
-      sen50.on();
+      // Wake up everything. Nothing here waits for the hardware, display
+      // first as connecting to it takes longest. It gets the last frame from
+      // before sleep or reset, drawn as soon as it connects.
       lcd.on();
+      lcd.setFrame(warmState.lcd, warmState.flash);
+      sen50.on();
       htu31.on();
       mics.on();
       l86.on();
 
-      // Take first sample after init
-      state = SAMPLE;
+      // Sample as sensors come up, publish when all are, and start housekeeping
+      TRACE(START, Time.isValid() ? Time.now() : 0, millis());
+      energy.tripStart();
+      boot_ready = 0;
+      scheduler.reset();
+      scheduler.post(EV_BOOT);
+      scheduler.post(EV_IGNITION);
+      scheduler.post(EV_RADIO);
+      scheduler.post(EV_LCD);
+      scheduler.post(EV_SENSORS);
+      scheduler.post(EV_EXPORT);
+      burst.reset();
+      if (BURST_CAPTURE) scheduler.post(EV_BURST);
+#ifdef AIRFLEET_TRACE
+      scheduler.post(EV_TRACE);
+#endif
+      state = IDLE;
 
       break;
 
     case IDLE:
-      // Housekeeping for different modules
-
-      lcd.loop();
-      sen50.loop();
-      htu31.loop();
-      mics.loop();
-      l86.loop();
-
-      // Check if ignition is off
-      if (!isIgnitionOn()) state = SLEEP;
-
-      // Check if we need to publish to cloud
-      else if (publishTime == 0 || publishTime + PUBLISH_INTERVAL_MS <= millis()) state = PUBLISH;
+      // Sleep until next event, and handle it
+      switch (scheduler.wait()) {
+        case EV_IGNITION:
+          // Posted by the battery timer when ignition has changed, and at
+          // INIT. Also when the level seen at wake didn't hold, see
+          // Battery::wakeCheck(), then bring-up stops here.
+          TRACE(IGNITION, battery.isIgnitionOn(), battery.getMv());
+          if (!battery.isIgnitionOn()) state = SLEEP;
+          break;
+
+        case EV_SAMPLE:
+          state = SAMPLE;
+          break;
+
+        case EV_BURST:
+          scheduler.schedule(EV_BURST, BURST_INTERVAL_MS);
+          burst_sample();
+          break;
+
+        case EV_WARMUP:
+          sen50.on();
+          break;
+
+        case EV_BOOT:
+          // New sample whenever another sensor is up, so the display fills
+          // in without waiting for the slowest one
+          ready = (sen50.isReady() ? 1 : 0) | (htu31.isReady() ? 2 : 0) | (mics.isReady() ? 4 : 0);
+          if (ready & ~boot_ready) scheduler.post(EV_SAMPLE);
+          boot_ready |= ready;
+
+          if (boot_ready == 7 || millis() - bootTime >= BOOT_TIMEOUT_MS) {
+            if (boot_ready == 7) profiler.bootMark(BOOT_SENSORS_READY);
+            scheduler.post(EV_PUBLISH);
+          }
+          else {
+            scheduler.schedule(EV_BOOT, BOOT_POLL_MS);
+          }
+          break;
+
+        case EV_PUBLISH:
+          state = PUBLISH;
+          scheduler.schedule(EV_PUBLISH, PUBLISH_INTERVAL_MS);
+          break;
+
+        case EV_UPLOAD:
+          state = UPLOAD;
+          break;
+
+        case EV_LEVELS:
+          state = LEVELS;
+          break;
+
+        case EV_RADIO:
+          // Session timeouts, and check if queued samples should be uploaded
+          radio.loop();
+          if (radio.wantsUpload(journal.depth(), journal.oldestAgeMs(), journal.getPushIntervalMs())) {
+            scheduler.post(EV_UPLOAD);
+          }
+          scheduler.schedule(EV_RADIO, radio.isOn() ? RADIO_POLL_MS : RADIO_IDLE_POLL_MS);
+          break;
+
+        case EV_LCD:
+          ticks = profiler.start();
+          lcd.loop();
+          profiler.stop(PROF_LCD, ticks);
+          scheduler.schedule(EV_LCD, lcd.pollInterval());
+          break;
+
+        case EV_SENSORS:
+          ticks = profiler.start();
+          sen50.loop();
+          profiler.stop(PROF_SEN50, ticks);
+
+          ticks = profiler.start();
+          htu31.loop();
+          profiler.stop(PROF_HTU31, ticks);
+
+          ticks = profiler.start();
+          mics.loop();
+          profiler.stop(PROF_MICS, ticks);
+
+          ticks = profiler.start();
+          l86.loop();
+          profiler.stop(PROF_L86, ticks);
+
+          // Keep system clock in line with GPS
+          timeBase.loop();
+
+          scheduler.schedule(EV_SENSORS, SENSORS_POLL_MS);
+          break;
+
+        case EV_EXPORT:
+          // Back 1 ms later while an export is running, not at once, so
+          // EV_TRACE still gets its turn
+          scheduler.schedule(EV_EXPORT, usbExport.loop() ? 1 : USB_EXPORT_POLL_MS);
+          break;
+
+        case EV_TRACE:
+          traceLog.drain();
+          scheduler.schedule(EV_TRACE, TRACE_DRAIN_MS);
+          break;
+
+        default:
+          break;
+      }
 
       break;
 
@@ -155,170 +418,267 @@ void loop() {
       // Get sample
       state = IDLE;
 
-      // Get sample for all sensors
-      gps_result = l86.getSample(gps, &datetime);
+      // Sample path should not touch the heap
+      memStats.begin();
+      profiler.sampleStart();
+
+      // Get sample for all sensors, not ready ones return an error at once
+      gps_result = l86.getSample(&gps);
+
+      acquired = millis();
+      readTicks = profiler.start();
+      ticks = readTicks;
       pm_result = sen50.getSample(pm);
-      th_result = htu31.getSample(th);
+      profiler.stop(PROF_SEN50, ticks);
+
+      ticks = profiler.start();
       cv_result = mics.getSample(cv);
+      profiler.stop(PROF_MICS, ticks);
 
-      // Particles
-      if (pm_result == 0 && (memcmp(pm, log_pm, sizeof(pm)) != 0 || forceLcdUpdate)) {
-        // Find max PM part
-        float_t maxpm = 0;
-        for (size_t i = 0; i < sizeof(pm) / sizeof(pm[0]); i++) {
-          if (pm[i] > maxpm) maxpm = pm[i];
+      // Levels and alerts go by the highest PM part
+      pm_max = 0;
+      for (size_t i = 0; i < sizeof(pm) / sizeof(pm[0]); i++) {
+        if (pm[i] > pm_max) pm_max = pm[i];
+      }
+
+      // Recirculation acts first, before display and cloud
+      recirc.update(
+        pm_result == 0 ? pm_max / 10.f : NAN,
+        cv_result == 0 ? (float_t)cv[1] : NAN);
+      profiler.stop(PROF_RECIRC, readTicks);
+
+      ticks = profiler.start();
+      th_result = htu31.getSample(th);
+      profiler.stop(PROF_HTU31, ticks);
+
+      // Readings taken before the sensor settled are flagged
+      if (pm_result == 0) {
+        log_flags &= ~SAMPLE_FLAG_PM_UNSETTLED;
+        if (!sen50.isSettled()) log_flags |= SAMPLE_FLAG_PM_UNSETTLED;
+      }
+      if (cv_result == 0) {
+        log_flags &= ~SAMPLE_FLAG_CV_UNSETTLED;
+        if (!mics.isSettled()) log_flags |= SAMPLE_FLAG_CV_UNSETTLED;
+      }
+
+      // With a long sample interval, the SEN50 fan only runs ahead of the next
+      // sample. Burst capture needs it all the time.
+      if (SEN50_DUTY_CYCLE && !BURST_CAPTURE && pm_result == 0 && nextSampleAt != 0) {
+        int32_t warmupIn = (int32_t)(nextSampleAt - SEN50_SETTLE_MS - millis());
+        if (warmupIn >= SEN50_MIN_OFF_MS) {
+          sen50.off();
+          scheduler.schedule(EV_WARMUP, warmupIn);
         }
+      }
+
+      if (pm_result == 0 || cv_result == 0 || th_result == 0) profiler.bootMark(BOOT_FIRST_SAMPLE);
 
-        // Update LCD
-        lcd.print(0, 2, "PM  " + generate_scale(maxpm, PM_MIN, PM_MAX,
-          (past_average[1] + past_average[2] + past_average[3] + past_average[4]) / 4., // Average PM
-          16)); // + " " + String::format("%.1f", maxpm));
+      // Time and position where the sensors were read, midway through the reads
+      acquired += (millis() - acquired) / 2;
+      sample_time = timeBase.toUtc(acquired);
+      if (gps_result == 0 && !l86.getPosition(acquired, &pos[0], &pos[1])) {
+        pos[0] = gps.latitude;
+        pos[1] = gps.longitude;
+      }
 
-        memcpy(log_pm, pm, sizeof(log_pm));
+      // Known levels on the road ahead, used by recirculation from next sample
+      if (gps_result == 0) {
+        hotspot_ahead = check_hotspots(pos, pm_result == 0 ? &pm_max : NULL, cv_result == 0 ? cv : NULL);
+      }
+      else {
+        hotspot_ahead = false;
+        recirc.forecast(NAN, NAN);
+      }
+
+      // Particles
+      if (pm_result == 0) {
+        pmStats.update(pm_max / 10.f);
+
+        // Update LCD with smoothed level
+        if (memcmp(pm, log_pm, sizeof(pm)) != 0 || forceLcdUpdate) {
+          line.clear();
+          line.append("PM  ");
+          lcdScale(&line, pmStats.ewma(STATS_FAST), PM_MIN, PM_MAX,
+            (past_average[1] + past_average[2] + past_average[3] + past_average[4]) / 4., // Average PM
+            16);
+          lcd.print(0, 2, line);
+
+          memcpy(log_pm, pm, sizeof(log_pm));
+        }
       }
 
       // Temperature / humidity
       if (th_result == 0 && (memcmp(th, log_th, sizeof(th)) != 0 || forceLcdUpdate)) {
-        // Show temp at top right in format: XXXC
-        lcd.print(16, 0, String::format("%3.0fC", th[0]));
+        // Show temp at top right in format: XXXC, rounded from 0.01 C
+        line.clear();
+        line.appendInt((th[0] + (th[0] < 0 ? -50 : 50)) / 100, 3).append('C');
+        lcd.print(16, 0, line);
 
         // Show humidity right on second line: XX%RH
-        lcd.print(8, 0, String::format("%2.0f%%RH", th[1]));
+        line.clear();
+        line.appendInt((th[1] + 50) / 100, 2).append("%RH");
+        lcd.print(8, 0, line);
 
         memcpy(log_th, th, sizeof(log_th));
       }
 
       // CO2 / VOC
-      if (cv_result == 0 && (memcmp(cv, log_cv, sizeof(cv)) != 0 || forceLcdUpdate)) {
-        lcd.print(0, 1, "CO2 " + generate_scale((float_t)cv[1], CO2_MIN, CO2_MAX,
-          past_average[0], 16)); // + " " + String(cv[1]));
+      if (cv_result == 0) {
+        co2Stats.update(cv[1]);
+
+        if (memcmp(cv, log_cv, sizeof(cv)) != 0 || forceLcdUpdate) {
+          line.clear();
+          line.append("CO2 ");
+          lcdScale(&line, co2Stats.ewma(STATS_FAST), CO2_MIN, CO2_MAX, past_average[0], 16);
+          lcd.print(0, 1, line);
 
-        memcpy(log_cv, cv, sizeof(log_cv));
+          memcpy(log_cv, cv, sizeof(log_cv));
+        }
       }
 
       // GPS
       if (gps_result == 0) {
-        // Show clock at top left 2024-11-11 11:11:11
-        if (log_datetime.substring(11, 16) != datetime.substring(11, 16) || forceLcdUpdate) {
-          lcd.print(0, 0, datetime.substring(11, 16));
+        // Show clock at top left hh:mm
+        if (log_time / 60000 != sample_time / 60000 || forceLcdUpdate) {
+          TimeBase::formatClock(sample_time, &clock);
+          lcd.print(0, 0, clock);
         }
-        log_datetime = datetime;
+        log_time = sample_time;
 
-        if (memcmp(gps, log_gps, sizeof(gps)) != 0) {
-          memcpy(log_gps, gps, sizeof(log_gps));
-        }
+        log_gps = gps;
+        memcpy(log_pos, pos, sizeof(log_pos));
       }
       else {
         // Show there's no GPS
         lcd.print(0, 0, "?GPS?");
       }
 
-      // Show alerts
-      if (log_pm[0] >= PM_MAX || log_pm[1] >= PM_MAX || log_pm[2] >= PM_MAX || log_pm[3] >= PM_MAX) {
+      // Show alerts, on smoothed levels so a single noisy reading doesn't trigger
+      pm_alert = alert_level(pmStats, PM_MAX, pm_alert);
+      co2_alert = alert_level(co2Stats, CO2_MAX, co2_alert);
+      if (pm_alert) {
         lcd.enableFlash(0, 3, "   PM NIVEAU H0J    ", 750);
       }
-      else if (log_cv[1] >= CO2_MAX) {
+      else if (co2_alert) {
         lcd.enableFlash(0, 3, "   CO2 NIVEAU H0J   ", 750);
       }
+      else if (hotspot_ahead) {
+        lcd.enableFlash(0, 3, "   HOTSPOT FORUDE   ", 750);
+      }
       else {
         lcd.disableFlash();
         lcd.print(9, 3, "OK");
       }
 
       // Check if we need to publish data
-      if (log_gps[3] >= PUBLISH_INTERVAL_KM) state = PUBLISH;
+      if (log_gps.meters >= (uint32_t)(PUBLISH_INTERVAL_KM * 1000)) scheduler.post(EV_PUBLISH);
 
       // Clear force update flag
       forceLcdUpdate = false;
 
+      memStats.end();
+
+      // Sample to trace log, formatted on the host by tools/trace_decode
+      log_batt = battery.getMv();
+      TRACE(BATTERY, log_batt);
+      if (pm_result == 0) TRACE(SAMPLE_PM, pm[0], pm[1], pm[2], pm[3]);
+      if (th_result == 0) TRACE(SAMPLE_TH, th[0], th[1]);
+      if (cv_result == 0) TRACE(SAMPLE_CV, cv[0], cv[1]);
+      if (gps_result == 0) TRACE(SAMPLE_GPS, pos[0], pos[1], gps.speed, gps.meters);
+      if (pm_result != 0 || th_result != 0 || cv_result != 0 || gps_result != 0) {
+        TRACE(SAMPLE_ERR, pm_result, th_result, cv_result, gps_result);
+      }
+
 #ifdef AIRFLEET_DEBUG
-      Log.info("---------------");
+      memStats.log();
+#endif
 
-      // Car battery
-      Log.info("Battery voltage: %.1fV", getBatteryV());
+      break;
 
-      // Particles
-      if (pm_result == 0) {
-        Log.info("PM1: %.1f, PM2.5: %.1f, PM4: %.1f, PM10: %.1f", pm[0], pm[1], pm[2], pm[3]);
-      }
-      else {
-        Log.error("Could not get particles in air");
-      }
+    case PUBLISH:
+      // Queue last sample for upload to cloud
+      state = IDLE;
 
-      // Temperature
-      if (th_result == 0) {
-        Log.info("Temperature: %.1f, humidity: %.1f", th[0], th[1]);
-      }
-      else {
-        Log.error("Could not get temperature and humidity");
-      }
+      // Fields as listed in SampleSchema.h, readings are already in its units
+      Sample sample;
+      sample.pm1 = log_pm[0];                                  // Particles
+      sample.pm25 = log_pm[1];
+      sample.pm4 = log_pm[2];
+      sample.pm10 = log_pm[3];
+      sample.temp = log_th[0];                                 // Temperature + humidity
+      sample.humi = log_th[1];
+      sample.voc = log_cv[0];                                  // VOC + CO2
+      sample.co2 = log_cv[1];
+      sample.lat = log_pos[0];                                 // GPS lat, lng
+      sample.lng = log_pos[1];
+      sample.batt = log_batt;                                  // Battery, filtered
+      sample.flags = log_flags;                                // Unsettled readings
+      sample.time = log_time;                                  // UTC epoch ms
 
-      // CO2 / VOC
-      if (cv_result == 0) {
-        Log.info("VOC: %d, CO2: %d", cv[0], cv[1]);
-      }
-      else {
-        Log.error("Could not get VOC/CO2");
-      }
+      // Build JSON string
+      char buf[SAMPLE_JSON_LEN + 1];
+      sampleJson(sample, buf, sizeof(buf));
 
-      // GPS
-      if (gps_result == 0) {
-        Log.info("GPS UTC time: %s", (const char*)datetime);
-        Log.info("GPS Latitude: %f, Longitude: %f, Speed: %f, Distance: %f", gps[0], gps[1], gps[2], gps[3]);
-      }
-      else if (gps_result == 1) {
-        Log.error("GPS looking for satelittes");
-      }
-      else {
-        Log.error("No data from GPS");
-      }
+      // Queue, radio session manager decides when to upload
+      journal.push(buf);
+      scheduler.post(EV_RADIO);
+
+      // Kept in flash for bulk export
+      sampleLog.append(sample);
+
+      // Reset distance, so publish will be triggered in X km
+      l86.reset_distance();
+
+      // Resume point in case of a reset
+      save_warm_state();
 
-      Log.info("---------------");
+#ifdef AIRFLEET_DEBUG
+      Log.info("Queued sample, journal depth: %u", journal.depth());
+      timingFunction("");
 #endif
 
       break;
 
-    case PUBLISH:
-      // Publish last sample to cloud
-
+    case UPLOAD:
+      // Publish queued samples to cloud
       state = IDLE;
-      if (!connectCloud()) break;
+      if (!radio.request()) break;
+
+      // Cloud allows 1 publish per second. Samples first, then bursts.
+      if (journal.depth() > 0 || burst.pending()) {
+        if (millis() - uploadTime < 1000) {
+          scheduler.schedule(EV_UPLOAD, 1000 - (millis() - uploadTime));
+          break;
+        }
 
 #ifdef AIRFLEET_DEBUG
-      Log.info("Publishing data to cloud");
+        Log.info("Publishing data to cloud");
 #endif
 
-      // Build JSON string
-      char buf[255];
-      snprintf(buf, sizeof(buf),
-        "{"
-        "\"pm1\":%.1f,\"pm25\":%.1f,\"pm4\":%.1f,\"pm10\":%.1f,"   // Particles
-        "\"temp\":%.1f,\"humi\":%.1f,"                             // Temperature + humidity
-        "\"voc\":%d,\"co2\":%d,"                                   // VOC + CO2
-        "\"lat\":%.6f,\"lng\":%.6f,"                               // GPS lat, lng
-        "\"time\":\"%s\""                                          // UTC time
-        "}",
-        log_pm[0], log_pm[1], log_pm[2], log_pm[3],
-        log_th[0], log_th[1],
-        log_cv[0], log_cv[1],
-        log_gps[0], log_gps[1],
-        (const char*)log_datetime
-        );
-
-      // Publish to cloud
-      Particle.publish("airfleet_push", buf, PRIVATE);
-
-      // Reset distance + publishtime, so publish will be triggered in X millisec./km
-      l86.reset_distance();
-      publishTime = millis();
+        if (journal.depth() > 0) {
+          if (Particle.publish("airfleet_push", journal.peek(), PRIVATE)) {
+            journal.pop();
+            radio.countUpload();
+          }
+        }
+        else {
+          char part[BURST_PART_LEN + 1];
+          if (burst.part(part, sizeof(part)) > 0 && Particle.publish("airfleet_burst", part, PRIVATE)) {
+            burst.sent();
+            radio.countUpload();
+          }
+        }
+        uploadTime = millis();
+        scheduler.schedule(EV_UPLOAD, 1000);
+        break;
+      }
 
       // Check if we need to update the past PM levels from cloud
       if (levelsTime == 0 || levelsTime + LEVELS_INTERVAL_MS <= millis()) {
         state = LEVELS;
       }
       else {
-        // Disconnect WiFi
-        disconnectCloud();
+        radio.release(journal.getPushIntervalMs());
       }
 
       break;
@@ -326,14 +686,24 @@ void loop() {
     case LEVELS:
       // Update average particle levels
       state = IDLE;
-      if (!connectCloud()) break;
+      if (!radio.request()) {
+        // Retry while radio is connecting
+        if (radio.isOn()) scheduler.schedule(EV_LEVELS, RADIO_POLL_MS);
+        break;
+      }
 
 #ifdef AIRFLEET_DEBUG
         Log.info("AIRFLEET_LEVELS Requesting...");
 #endif
 
-      // Request particle levels
-      if (Particle.publish("air-quality-request", "", PRIVATE)) levelsTime = millis();
+      // Request particle levels, response is handled in airfleet_levels()
+      if (Particle.publish("air-quality-request", "", PRIVATE)) {
+        levelsTime = millis();
+        radio.beginOp(RADIO_LEVELS_TIMEOUT_MS);
+      }
+      else {
+        radio.release(journal.getPushIntervalMs());
+      }
 
       break;
 
@@ -344,71 +714,155 @@ void loop() {
       Log.info("=== GOING TO SLEEP  ===");
 #endif
 
+      // Last frame and fix, before the display shows we're off
+      save_warm_state();
+
       // Update LCD
       lcd.disableFlash();
       lcd.clear();
       lcd.print(0, 1, "    TAENDING FRA");
 
       // Put everything asleep
+      radio.off();
+      recirc.off();
       sen50.off();
       lcd.off();
       htu31.off();
       mics.off();
       l86.off();
+      energy.tripEnd();
+
+      // Trace of the trip out and synced before the RAM ring stops
+      traceLog.drain();
 
-      // Put Photon 2 to sleep, and wakeup every X sec to check for ignition
+      // Put Photon 2 to sleep, and wakeup every X sec to check for ignition.
+      // The ADC can't wake it, a digital ignition line can.
+      batteryTimer.stop();
       SystemSleepConfiguration config;
       config.mode(SystemSleepMode::ULTRA_LOW_POWER).duration(IGNITION_CHECK_INTERVAL);
-      while (!isIgnitionOn()) System.sleep(config);
+#ifdef IGNITION_WAKE_PIN
+      config.gpio(IGNITION_WAKE_PIN, RISING);
+#endif
+      energy.set(ENERGY_MCU, ENERGY_MCU_SLEEP);
+      do {
+        System.sleep(config);
+      } while (!battery.wakeCheck());
+      energy.set(ENERGY_MCU, ENERGY_MCU_RUN);
+
+      // Ignition is debounced by the timer during INIT, not before it
+      batteryTimer.start();
 
 #ifdef AIRFLEET_DEBUG
       Log.info("=== WOKE UP ===");
 #endif
 
+      profiler.loopResume();
+      profiler.bootStart(millis());
+      bootTime = millis();
       state = INIT;
 
       break;
   }
-}
 
-// Timer for triggering sampling
-void triggerSample() {
-  if (state != SLEEP) state = SAMPLE;
+  profiler.stop((ProfSlot)(PROF_STATE_INIT + curState), stateTicks);
 }
 
-// Start and check connection to Particle cloud
-bool connectCloud() {
+// Hot state to retained SRAM, see WarmStart.h
+void save_warm_state() {
+  lcd.getFrame(warmState.lcd, warmState.flash);
+
+  // Keep last valid fix while there is none
+  GpsFix fix;
+  l86.getFix(&fix);
+  if (fix.valid == 0 && fix.utcMs != 0) {
+    warmState.latitude = fix.latitude;
+    warmState.longitude = fix.longitude;
+    warmState.fixUtcMs = fix.utcMs;
+  }
 
-    // Check WiFi
-    if (WiFi.isOff()) {
+  if (pmStats.getCount() > 0) pmStats.getAverages(warmState.pmAverage);
+  if (co2Stats.getCount() > 0) co2Stats.getAverages(warmState.co2Average);
+  memcpy(warmState.pastAverage, past_average, sizeof(past_average));
+  if (levelsTime != 0 && Time.isValid()) warmState.levelsAt = Time.now() - (millis() - levelsTime) / 1000;
 
-#ifdef AIRFLEET_DEBUG
-      Log.info("CLOUD connecting");
-#endif
+  warmStart.save();
+}
 
-      WiFi.on();
-      WiFi.connect();
-      Particle.connect();
-      return false;
+// Carries averages, past levels and last fix over a reset. The frame is
+// restored at each ignition, see INIT.
+void restore_warm_state() {
+  pmStats.seed(warmState.pmAverage);
+  co2Stats.seed(warmState.co2Average);
+  memcpy(past_average, warmState.pastAverage, sizeof(past_average));
+
+  // No new request for past levels until they are due
+  if (warmState.levelsAt != 0 && Time.isValid() && (uint32_t)Time.now() >= warmState.levelsAt) {
+    uint32_t age = Time.now() - warmState.levelsAt;
+    if (age < LEVELS_INTERVAL_MS / 1000) {
+      levelsTime = millis() - age * 1000;
+      if (levelsTime == 0) levelsTime = 1;
     }
-    if (!WiFi.ready()) return false;
+  }
 
-    // Check Particle cloud
-    if (!Particle.connected()) return false;
+  l86.seedFix(warmState.latitude, warmState.longitude, warmState.fixUtcMs);
+}
 
-    return true;
+// Timer for triggering sampling
+void triggerSample() {
+  profiler.sampleTimer();
+  nextSampleAt = millis() + SAMPLE_INTERVAL_MS;
+  scheduler.post(EV_SAMPLE);
 }
 
-// End connection to Particle cloud
-void disconnectCloud() {
-  if (WiFi.isOff()) return;
+// Timer for battery voltage
+void sampleBattery() {
+  if (battery.sample()) scheduler.post(EV_IGNITION);
+}
 
-#ifdef AIRFLEET_DEBUG
-  Log.info("CLOUD disconnecting");
-#endif
+// Sample into the burst ring, at BURST_INTERVAL_MS. A sensor that fails
+// keeps its last reading, as in the regular samples.
+void burst_sample() {
+  static Sample last = {};
+  uint16_t pm[4];
+  int16_t th[2];
+  uint16_t cv[2];
+  GpsSample gps;
+  int32_t pos[2];
+
+  system_tick_t acquired = millis();
+  if (sen50.getSample(pm) == 0) {
+    last.pm1 = pm[0];
+    last.pm25 = pm[1];
+    last.pm4 = pm[2];
+    last.pm10 = pm[3];
+    last.flags &= ~SAMPLE_FLAG_PM_UNSETTLED;
+    if (!sen50.isSettled()) last.flags |= SAMPLE_FLAG_PM_UNSETTLED;
+  }
+  if (htu31.getSample(th) == 0) {
+    last.temp = th[0];
+    last.humi = th[1];
+  }
+  if (mics.getSample(cv) == 0) {
+    last.voc = cv[0];
+    last.co2 = cv[1];
+    last.flags &= ~SAMPLE_FLAG_CV_UNSETTLED;
+    if (!mics.isSettled()) last.flags |= SAMPLE_FLAG_CV_UNSETTLED;
+  }
+
+  // Filtered position at the time of the reads, at full resolution
+  acquired += (millis() - acquired) / 2;
+  last.time = timeBase.toUtc(acquired);
+  if (l86.getSample(&gps) == 0) {
+    if (!l86.getPosition(acquired, &pos[0], &pos[1])) {
+      pos[0] = gps.latitude;
+      pos[1] = gps.longitude;
+    }
+    last.lat = pos[0];
+    last.lng = pos[1];
+  }
+  last.batt = battery.getMv();
 
-  Particle.disconnect();
-  WiFi.off();
+  burst.add(last);
 }
 
 // Callback when we get past average levels
@@ -445,43 +899,179 @@ void airfleet_levels(const char *event, const char *data) {
     }
   }
 
-  disconnectCloud();
-
   forceLcdUpdate = true;
+
+  // Continue with hotspot map while connected
+  if (hotspots.syncDue() && hotspots.request()) {
+    radio.beginOp(RADIO_LEVELS_TIMEOUT_MS);
+    return;
+  }
+
+  // Done with cloud for now
+  radio.endOp();
+  radio.release(journal.getPushIntervalMs());
 }
 
-// Function generating a scale, e.g.:
-// [---    |    ]
-String generate_scale(float_t val, float_t minval, float_t maxval, float_t prev, uint8_t width) {
-  String scale = "[";
-  int8_t val_i = (int8_t)((val - minval) / (maxval - minval) * (float_t)(width - 2));
-  if (val_i < 0) val_i = 0;
-  if (val_i > width - 3) val_i = width - 3;
-  int8_t prev_i = (int8_t)((prev - minval) / (maxval - minval) * (float_t)(width - 2));
-  if (prev_i < 0) prev_i = 0;
-  if (prev_i > width - 3) prev_i = width - 3;
-  for (uint8_t i = 0; i < width - 2; i++) {
-    if (val_i >= i && prev_i == i) {
-      scale.concat("+");
-    }
-    else if (val_i >= i) {
-      scale.concat("-");
-    }
-    else if (prev_i == i) {
-      scale.concat("|");
-    }
-    else {
-      scale.concat(" ");
-    }
+// Callback for a page of hotspot map updates
+void airfleet_hotspots(const char *event, const char *data) {
+#ifdef AIRFLEET_DEBUG
+  Log.info("AIRFLEET_HOTSPOTS CALLBACK event: %s, data: %s", event, data);
+#endif
+
+  // Ask for next page, or done with cloud for now
+  if (hotspots.handle(data) && hotspots.request()) {
+    radio.beginOp(RADIO_LEVELS_TIMEOUT_MS);
+    return;
+  }
+  radio.endOp();
+  radio.release(journal.getPushIntervalMs());
+}
+
+// Looks up historical levels here and HOTSPOT_LOOKAHEAD_S ahead. Passes the
+// levels ahead to recirculation, and returns true if we are heading into a
+// hotspot we are not already in.
+bool check_hotspots(const int32_t *pos, const uint16_t *pm_max, const uint16_t *cv) {
+  GpsFix fix;
+  l86.getFix(&fix);
+
+  // Position in 1e-7 degrees, moved ahead along the filtered velocity
+  int32_t ahead_lat = pos[0];
+  int32_t ahead_lng = pos[1];
+  if (fix.track.valid) {
+    ahead_lat += lroundf(fix.track.velNorth * HOTSPOT_LOOKAHEAD_S * (1e7f / 111320.f));
+    ahead_lng += lroundf(fix.track.velEast * HOTSPOT_LOOKAHEAD_S * (1e7f / 111320.f) / cosf(pos[0] * (float)(M_PI / 180e7)));
+  }
+
+  HotspotCell here;
+  HotspotCell ahead;
+  bool known_here = hotspots.lookup(Hotspots::cellOf(pos[0], pos[1]), &here);
+  if (!hotspots.lookup(Hotspots::cellOf(ahead_lat, ahead_lng), &ahead)) {
+    recirc.forecast(NAN, NAN);
+    return false;
   }
-  scale.concat("]");
-  return scale;
+  recirc.forecast(ahead.pm / 10.f, ahead.co2);
+
+#ifdef AIRFLEET_DEBUG
+  // Current readings against the local baseline
+  if (known_here && pm_max && cv) {
+    Log.info("Hotspot baseline PM: %s (now %s), CO2: %u (now %+d)",
+      FixedText(here.pm, 1).text, FixedText((int32_t)*pm_max - here.pm, 1).text,
+      here.co2, (int)cv[1] - here.co2);
+  }
+#else
+  (void)pm_max;
+  (void)cv;
+#endif
+
+  // Cells hold PM in 0.1 ug/m3, as the sensor
+  bool hot_ahead = ahead.pm >= (uint16_t)(PM_MAX * 10) || ahead.co2 >= (uint16_t)CO2_MAX;
+  bool hot_here = known_here && (here.pm >= (uint16_t)(PM_MAX * 10) || here.co2 >= (uint16_t)CO2_MAX);
+  return hot_ahead && !hot_here;
+}
+
+// Alert when the fast average reaches max, clear with hysteresis
+bool alert_level(const RollingStats &stats, float_t maxval, bool active) {
+  if (stats.getCount() == 0) return false;
+  return stats.ewma(STATS_FAST) >= (active ? maxval * STATS_ALERT_CLEAR : maxval);
+}
+
+// Cloud variable with timing summary as JSON
+String timingVariable() {
+  char buf[700];
+  profiler.summary(buf, sizeof(buf));
+  return String(buf);
+}
+
+// Cloud variable with radio session statistics as JSON
+String radioVariable() {
+  char buf[200];
+  radio.summary(buf, sizeof(buf));
+  return String(buf);
 }
 
-bool isIgnitionOn() {
-  return getBatteryV() >= IGNITION_ON_V;
+// Cloud variable with PM and CO2 statistics as JSON
+String statsVariable() {
+  char pm_buf[160];
+  char co2_buf[160];
+  pmStats.summary(pm_buf, sizeof(pm_buf));
+  co2Stats.summary(co2_buf, sizeof(co2_buf));
+  return String::format("{\"pm\":%s,\"co2\":%s}", pm_buf, co2_buf);
 }
 
-float_t getBatteryV() {
-  return analogRead(VIN_REF_PIN) * VIN_REF_FACTOR;
-}
\ No newline at end of file
+// Cloud variable with recirculation state as JSON
+String recircVariable() {
+  char buf[256];
+  recirc.summary(buf, sizeof(buf));
+  return String(buf);
+}
+
+// Cloud variable with hotspot map state as JSON
+String hotspotsVariable() {
+  char buf[120];
+  hotspots.summary(buf, sizeof(buf));
+  return String(buf);
+}
+
+// Cloud variable with GPS power mode and time to first fix as JSON
+String gpsVariable() {
+  char buf[120];
+  l86.summary(buf, sizeof(buf));
+  return String(buf);
+}
+
+// Cloud variable with energy per subsystem, trip and uploaded sample as JSON
+String energyVariable() {
+  char buf[320];
+  energy.summary(buf, sizeof(buf));
+  return String(buf);
+}
+
+// Cloud variable with trace log counters as JSON
+String traceVariable() {
+  char buf[96];
+  traceLog.summary(buf, sizeof(buf));
+  return String(buf);
+}
+
+// Cloud variable with warm start state as JSON
+String warmVariable() {
+  char buf[80];
+  warmStart.summary(buf, sizeof(buf));
+  return String(buf);
+}
+
+// Cloud variable with sample log and last USB export as JSON
+String exportVariable() {
+  char log_buf[80];
+  char usb_buf[80];
+  sampleLog.summary(log_buf, sizeof(log_buf));
+  usbExport.summary(usb_buf, sizeof(usb_buf));
+  return String::format("{\"log\":%s,\"usb\":%s}", log_buf, usb_buf);
+}
+
+String burstVariable() {
+  char buf[128];
+  burst.summary(buf, sizeof(buf));
+  return String(buf);
+}
+
+// Cloud variable with battery voltage and ignition as JSON
+String batteryVariable() {
+  char buf[120];
+  battery.summary(buf, sizeof(buf));
+  return String(buf);
+}
+
+// Cloud function: "reset" clears timing, anything else dumps timing to USB serial
+int timingFunction(String arg) {
+  if (arg == "reset") {
+    profiler.reset();
+    return 0;
+  }
+
+  profiler.dump(Serial);
+  Serial.printlnf("Scheduler wakeups: %lu", scheduler.getWakeups());
+  Serial.printlnf("GPS UART overruns: %lu, max fill: %u, ring overruns: %lu, CRC errors: %lu, dropped sentences: %lu",
+    l86.getUartOverruns(), l86.getUartMaxFill(), l86.getRingOverruns(), l86.getCrcErrors(), l86.getDroppedSentences());
+  return 0;
+}
@@ -0,0 +1,121 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Battery voltage and ignition with hysteresis and debounce
+*/
+
+#include "Battery.h"
+#include "Fixed.h"
+
+static_assert(IGNITION_OFF_V <= IGNITION_ON_V, "Ignition hysteresis needs IGNITION_OFF_V <= IGNITION_ON_V");
+static_assert(IGNITION_DEBOUNCE_MS >= BATTERY_SAMPLE_MS, "Ignition debounce is at least one sample");
+
+// Levels and ADC scale in integers, so samples stay out of floats
+static const uint16_t onMv = (uint16_t)(IGNITION_ON_V * 1000);
+static const uint16_t offMv = (uint16_t)(IGNITION_OFF_V * 1000);
+static const uint32_t uvPerCount = (uint32_t)(VIN_REF_FACTOR * 1000000 + .5);
+static const uint16_t debounceSamples = (IGNITION_DEBOUNCE_MS + BATTERY_SAMPLE_MS - 1) / BATTERY_SAMPLE_MS;
+
+Battery::Battery() {
+	filter = 0;
+	debounce = 0;
+	confirming = false;
+	mv = 0;
+	on = false;
+	changes = 0;
+	glitches = 0;
+	wakeups = 0;
+}
+
+// At power on, before the timer starts
+void Battery::begin() {
+	prime(read());
+	on = mv >= onMv;
+}
+
+// From the timer, every BATTERY_SAMPLE_MS. Returns true when ignition has
+// changed.
+bool Battery::sample() {
+	filter -= filter >> BATTERY_FILTER_SHIFT;
+	filter += read();
+	mv = filter >> BATTERY_FILTER_SHIFT;
+
+	// After wake, on until the level has held for the debounce time, and
+	// off at once if it doesn't
+	if (confirming) {
+		if (mv < onMv) {
+			confirming = false;
+			debounce = 0;
+			on = false;
+			glitches++;
+			return true;
+		}
+		if (++debounce >= debounceSamples) {
+			confirming = false;
+			debounce = 0;
+			changes++;
+		}
+		return false;
+	}
+
+	bool isOn = on;
+	bool want = mv >= (isOn ? offMv : onMv);
+	if (want == isOn) {
+		if (debounce > 0) glitches++;
+		debounce = 0;
+		return false;
+	}
+	if (++debounce < debounceSamples) return false;
+
+	debounce = 0;
+	on = want;
+	changes++;
+	return true;
+}
+
+// After each wake from sleep, with the timer stopped. One oversampled read,
+// so a parked car goes back to sleep at once. A reading above the on level
+// turns ignition on without waiting, and the timer debounces it while
+// everything comes up, see sample().
+bool Battery::wakeCheck() {
+	wakeups++;
+	uint16_t reading = read();
+	if (reading < onMv) return false;
+
+	prime(reading);
+	confirming = true;
+	on = true;
+	return true;
+}
+
+bool Battery::isIgnitionOn() {
+	return on;
+}
+
+// Filtered voltage, mV
+uint16_t Battery::getMv() {
+	return mv;
+}
+
+// Average of BATTERY_OVERSAMPLE ADC reads, mV
+uint16_t Battery::read() {
+	uint32_t sum = 0;
+	for (uint8_t i = 0; i < BATTERY_OVERSAMPLE; i++) {
+		sum += analogRead(VIN_REF_PIN);
+	}
+	return (uint64_t)sum * uvPerCount / (BATTERY_OVERSAMPLE * 1000UL);
+}
+
+// Filter starts at a reading, rather than climbing from 0
+void Battery::prime(uint16_t reading) {
+	filter = (uint32_t)reading << BATTERY_FILTER_SHIFT;
+	mv = reading;
+	debounce = 0;
+}
+
+size_t Battery::summary(char *buf, size_t len) {
+	int n = snprintf(buf, len,
+		"{\"volts\":%s,\"ignition\":%d,\"changes\":%lu,\"glitches\":%lu,\"wakeups\":%lu}",
+		FixedText(mv, 3).text, (bool)on, (unsigned long)changes, (unsigned long)glitches, (unsigned long)wakeups);
+	return n < 0 ? 0 : ((size_t)n < len ? n : len - 1);
+}
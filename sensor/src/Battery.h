@@ -0,0 +1,49 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Battery voltage and ignition from it. A timer samples the ADC
+			  every BATTERY_SAMPLE_MS, oversampled and low pass filtered.
+			  Ignition goes on and off at separate levels, and only after
+			  holding for IGNITION_DEBOUNCE_MS, so a noisy reading doesn't
+			  power everything down.
+*/
+
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+#include <atomic>
+
+class Battery {
+	public:
+		Battery();
+
+		void begin();
+		bool sample();
+		bool wakeCheck();
+
+		bool isIgnitionOn();
+		uint16_t getMv();
+
+		size_t summary(char *buf, size_t len);
+
+	private:
+		uint16_t read();
+		void prime(uint16_t mv);
+
+		// Filtered voltage, mV << BATTERY_FILTER_SHIFT
+		uint32_t filter;
+		uint16_t debounce;	// Samples the other ignition state has held
+		bool confirming;	// On from a single reading at wake, see wakeCheck()
+
+		std::atomic<uint16_t> mv;
+		std::atomic<bool> on;
+
+		uint32_t changes;
+		uint32_t glitches;	// Ignition changes that didn't hold
+		uint32_t wakeups;
+};
+
+#endif
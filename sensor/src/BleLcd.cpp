@@ -5,6 +5,17 @@
 */
 
 #include "BleLcd.h"
+#include "Profiler.h"
+#include "Energy.h"
+#include "Trace.h"
+
+// Bonded display, persisted in EEPROM so we can reconnect without scanning
+#define BLE_LCD_BOND_MAGIC	0x4C434431 // "LCD1"
+struct BleLcdBond {
+	uint32_t magic;
+	uint8_t addr[BLE_SIG_ADDR_LEN];
+	uint8_t type;
+};
 
 BleLcd::BleLcd() {
 	lcdBleServiceUuid = BleUuid(BLE_LCD_SERVICE_UUID);
@@ -15,22 +26,34 @@ BleLcd::BleLcd() {
 
     // Initial state
     state = IDLE;
+	serverBonded = false;
+	directAttempts = 0;
+	onTime = 0;
+	firstFrameMs = 0;
 }
 
 void BleLcd::loop() {
 	switch(state) {
 		case SCAN:
-			state = WAIT;
+			setState(WAIT);
+			stateTime = millis();
+			BLE.setScanTimeout(BLE_LCD_SCAN_TIMEOUT);
 			BLE.scan(scanResultCallback, this);
 			break;
+
+		case DIRECT:
+			stateDirect();
+			break;
 			
 		case CONNECT:
 			stateConnect();
 			break;
 
 		case WAIT:
-            // Restart scan every 5 sec.
-			if (millis() - stateTime >= 5000) state = SCAN;
+            // Retry known display first, fall back to a full scan
+			if (millis() - stateTime >= BLE_LCD_RETRY_MS) {
+				setState((serverBonded && directAttempts < BLE_LCD_DIRECT_ATTEMPTS) ? DIRECT : SCAN);
+			}
 			break;
 
         case PAIR:
@@ -43,14 +66,37 @@ void BleLcd::loop() {
 	}
 }
 
+// Returns millis until loop() needs to run again
+system_tick_t BleLcd::pollInterval() {
+	switch (state) {
+		case IDLE:
+		case READY:
+			return BLE_LCD_IDLE_POLL_MS;
+
+		case WAIT:
+			if (millis() - stateTime >= BLE_LCD_RETRY_MS) return 0;
+			return BLE_LCD_RETRY_MS - (millis() - stateTime);
+
+		// Connecting or pairing, polled without keeping other events waiting
+		default:
+			return BLE_LCD_POLL_MS;
+	}
+}
+
 void BleLcd::on() {
     // Turn on BLE
     BLE.on();
 	BLE.setPairingIoCaps(BlePairingIoCaps::DISPLAY_YESNO);
 	BLE.setPairingAlgorithm(BlePairingAlgorithm::LESC_ONLY);
 
-    // Start scanning
-    state = SCAN;
+	// Reconnect to bonded display directly, or start scanning
+	loadBond();
+	directAttempts = 0;
+	setState(serverBonded ? DIRECT : SCAN);
+
+	// Measure time until first frame is on the display
+	onTime = millis();
+	firstFrameMs = 0;
 
 	// Clear buffers
 	memset(curLCD, 32, sizeof(curLCD));
@@ -60,16 +106,42 @@ void BleLcd::on() {
 
 void BleLcd::off() {
     // Turn off BLE
-    state = IDLE;
+    setState(IDLE);
     BLE.off();
 }
 
+// Radio is scanning or connecting in all states but IDLE, INIT and READY
+void BleLcd::setState(State next) {
+	state = next;
+	TRACE(BLE_STATE, next);
+	energy.set(ENERGY_BLE, next == IDLE ? ENERGY_BLE_OFF :
+		(next == INIT || next == READY) ? ENERGY_BLE_CONNECTED : ENERGY_BLE_ACTIVE);
+}
+
+// Returns millis from on() until first frame was sent, 0 if not yet
+unsigned long BleLcd::getFirstFrameMs() {
+	return firstFrameMs;
+}
+
 void BleLcd::clearCurrent() {
 	memset(curLCD, 32, sizeof(curLCD));
 	curLCD[0] = 0;
 	memset(curFlash, 0, sizeof(curFlash));
 }
 
+// Current frame, BLE_LCD_FRAME_LEN and BLE_LCD_FLASH_LEN bytes
+void BleLcd::getFrame(uint8_t *lcd, uint8_t *flash) {
+	memcpy(lcd, curLCD, BLE_LCD_FRAME_LEN);
+	memcpy(flash, curFlash, BLE_LCD_FLASH_LEN);
+}
+
+// Frame to show once connected, e.g. the last one before sleep. Call after on().
+void BleLcd::setFrame(const uint8_t *lcd, const uint8_t *flash) {
+	clearCurrent();
+	memcpy(curLCD, lcd, BLE_LCD_FRAME_LEN);
+	memcpy(curFlash, flash, BLE_LCD_FLASH_LEN);
+}
+
 char BleLcd::clear() {
 	// Prepare buffer
 	const uint8_t buf[] = {0};
@@ -88,20 +160,17 @@ char BleLcd::clear() {
 
 // Print message
 char BleLcd::print(const char x, const char y, const uint8_t *buf, size_t len) {
-	uint8_t buf2[255];
+	// Never more than what is left of the display from x, y
+	uint8_t buf2[2 + BLE_LCD_FRAME_LEN];
+	size_t pos = x + BLE_LCD_WIDTH*y;
+	if (pos >= BLE_LCD_FRAME_LEN) return -1;
 	buf2[0] = x;
 	buf2[1] = y;
-	size_t len2 = 0;
-	uint8_t changes = 0;
-	for (len2 = 0; len2 < len && len2 < 250; len2++) {
-		buf2[len2+2] = buf[len2];
-
-		// Check for changes
-		if (curLCD[x + 20*y + len2] != buf[len2]) {
-			changes++;
-			curLCD[x + 20*y + len2] = buf[len2];
-		}
-	}
+	size_t len2 = len < BLE_LCD_FRAME_LEN - pos ? len : BLE_LCD_FRAME_LEN - pos;
+	memcpy(buf2 + 2, buf, len2);
+
+	// Check for changes
+	size_t changes = lcdUpdate(curLCD, pos, buf, len2);
 
 	if (curLCD[0] == 0) curLCD[0] = 32;
 
@@ -113,16 +182,12 @@ char BleLcd::print(const char x, const char y, const uint8_t *buf, size_t len) {
     
     return len2+2;
 }
-char BleLcd::print(const char x, const char y, const String str) {
-	uint8_t buf[255];
-	size_t len;
-	for (len = 0; len < str.length() && len < 255; len++) buf[len] = (char)str.charAt(len);
-
-	return print(x, y, buf, len);
+char BleLcd::print(const char x, const char y, const TextSpan str) {
+	return print(x, y, (const uint8_t *)str.data, str.len);
 }
 
 // Flash text on screen, by show and hiding text
-char BleLcd::enableFlash(const char x, const char y, const String str, const uint16_t interval) {
+char BleLcd::enableFlash(const char x, const char y, const TextSpan str, const uint16_t interval) {
 	uint8_t buf[255];
 	memset(buf, 0, sizeof(buf));
 
@@ -136,8 +201,8 @@ char BleLcd::enableFlash(const char x, const char y, const String str, const uin
 	buf[3] = interval & 0xFF;
 
 	size_t i;
-	for (i = 0; i < str.length() && i < 250; i++) {
-		buf[i+4] = (uint8_t)str.charAt(i);
+	for (i = 0; i < str.len && i < 250; i++) {
+		buf[i+4] = (uint8_t)str.data[i];
 	}
 
 	// Check for changes
@@ -147,9 +212,9 @@ char BleLcd::enableFlash(const char x, const char y, const String str, const uin
     if (state != READY) return -1;
 
     // Send
-    lcdFlashCharacteristic.setValue(buf, str.length() + 4);
+    lcdFlashCharacteristic.setValue(buf, i + 4);
 
-    return str.length() + 4;
+    return i + 4;
 }
 char BleLcd::disableFlash() {
 	uint8_t buf[4];
@@ -182,22 +247,44 @@ void BleLcd::scanResult(const BleScanResult *scanResult) {
 	serverAddr = scanResult->address();
 
     // Go to connect state
-	state = CONNECT;
+	setState(CONNECT);
 
 	// Stop scanning
 	BLE.stopScanning();
 }
 
-// Connects to device
-void BleLcd::stateConnect() {
-    // Connect
-	peer = BLE.connect(serverAddr);
-	if (!peer.connected()) {
-        // Go to wait state before restarting a scan
-		state = WAIT;
-		stateTime = millis();
-		return;
-	}
+// Reads bonded display address from EEPROM
+void BleLcd::loadBond() {
+	BleLcdBond bond;
+	EEPROM.get(BLE_LCD_EEPROM_ADR, bond);
+	serverBonded = (bond.magic == BLE_LCD_BOND_MAGIC);
+	if (serverBonded) serverAddr = BleAddress(bond.addr, (BleAddressType)bond.type);
+}
+
+// Stores bonded display address in EEPROM, if it has changed
+void BleLcd::saveBond() {
+	BleLcdBond bond;
+	EEPROM.get(BLE_LCD_EEPROM_ADR, bond);
+
+	uint8_t addr[BLE_SIG_ADDR_LEN];
+	serverAddr.octets(addr);
+	if (bond.magic == BLE_LCD_BOND_MAGIC && memcmp(bond.addr, addr, sizeof(addr)) == 0 &&
+		bond.type == (uint8_t)serverAddr.type()) return;
+
+	bond.magic = BLE_LCD_BOND_MAGIC;
+	memcpy(bond.addr, addr, sizeof(addr));
+	bond.type = (uint8_t)serverAddr.type();
+	EEPROM.put(BLE_LCD_EEPROM_ADR, bond);
+	serverBonded = true;
+}
+
+// Connects to serverAddr and discovers characteristics
+bool BleLcd::connectPeer() {
+	// Short connection interval, so service discovery and the first frame go fast
+	ProfTicks ticks = profiler.start();
+	peer = BLE.connect(serverAddr, BLE_LCD_CONN_INTERVAL, 0, BLE_LCD_CONN_TIMEOUT);
+	profiler.stop(PROF_BLE_CONNECT, ticks);
+	if (!peer.connected()) return false;
 
     // Connected - getting info about services
 	peer.getCharacteristicByUUID(lcdClearCharacteristic, lcdBleClearCharacteristicUuid);
@@ -205,10 +292,33 @@ void BleLcd::stateConnect() {
 	peer.getCharacteristicByUUID(lcdPrintCharacteristic, lcdBlePrintCharacteristicUuid);
 	peer.getCharacteristicByUUID(lcdFlashCharacteristic, lcdBleFlashCharacteristicUuid);
 
-    // Start pairing
-	BLE.startPairing(peer);
-	state = PAIR;
+	// Already bonded displays reuse their keys, only pair new ones
+	if (!BLE.isPaired(peer)) BLE.startPairing(peer);
+	setState(PAIR);
+	directAttempts = 0;
+
+	stateTime = millis();
+	return true;
+}
+
+// Connects directly to the bonded display, without scanning
+void BleLcd::stateDirect() {
+	if (connectPeer()) return;
+
+	// Go to wait state before retrying or falling back to a scan
+	directAttempts++;
+	setState(WAIT);
+	stateTime = millis();
+
+	TRACE(BLE_DIRECT_FAIL, directAttempts);
+}
+
+// Connects to device found by scan
+void BleLcd::stateConnect() {
+	if (connectPeer()) return;
 
+    // Go to wait state before restarting a scan
+	setState(WAIT);
 	stateTime = millis();
 }
 
@@ -216,7 +326,7 @@ void BleLcd::stateConnect() {
 void BleLcd::statePair() {
 	if (!peer.connected()) {
 		// Lost connection - go to wait before scanning
-		state = WAIT;
+		setState(WAIT);
 		stateTime = millis();
 		return;
 	}
@@ -226,44 +336,50 @@ void BleLcd::statePair() {
 		return;
 	}
 
+	// Remember display, so next reconnect can skip scanning
+	if (BLE.isPaired(peer)) saveBond();
+
     // Init state
-    state = INIT;
+    setState(INIT);
 
 	// Update LCD with recent data
 	if (curLCD[0] == 0) {
 		// Clear
-		Log.info("READY clear");
 		clear();
 	}
 	else {
 		// Print
-		Log.info("READY print");
 		for (size_t y = 0; y <= 3; y++) {
-			uint8_t buf[255];
-			for (size_t len = 0; len < 20; len++) {
-				buf[len] = curLCD[20*y + len];
-			}
-			print(0, y, buf, 20);
+			uint8_t buf[BLE_LCD_WIDTH];
+			memcpy(buf, curLCD + BLE_LCD_WIDTH*y, BLE_LCD_WIDTH);
+			print(0, y, buf, BLE_LCD_WIDTH);
 		}
 	}
 	if (curFlash[2] > 0 || curFlash[3] > 0) {
 		// Flash
-		Log.info("READY flash");
 		size_t len = 4;
 		while (len < 255 && curFlash[len] != 0) len++;
 		lcdFlashCharacteristic.setValue(curFlash, len);
 	}
 
 	// Ready state
-	state = READY;
+	TRACE(BLE_RESTORE, curLCD[0] != 0, curFlash[2] > 0 || curFlash[3] > 0);
+	setState(READY);
+
+	if (firstFrameMs == 0) {
+		firstFrameMs = millis() - onTime;
+		if (firstFrameMs == 0) firstFrameMs = 1;
+		profiler.bootMark(BOOT_FIRST_FRAME);
+		TRACE(BLE_FIRST_FRAME, firstFrameMs);
+	}
 }
 
 // Check connection
 void BleLcd::stateReady() {
 	if (!peer.connected()) {
-		// Lost connection - go to wait before scanning
-		state = WAIT;
-		stateTime = millis();
+		// Lost connection - reconnect directly to the same display
+		directAttempts = 0;
+		setState(DIRECT);
 		return;
 	}    
 }
\ No newline at end of file
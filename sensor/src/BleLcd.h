@@ -9,6 +9,7 @@
 
 #include "Particle.h"
 #include "Settings.h"
+#include "LcdText.h"
 
 class BleLcd {
 	public:
@@ -17,24 +18,30 @@ class BleLcd {
 		void on();
 		void off();
 		void loop();
+		system_tick_t pollInterval();
 		char clear();
 		char print(const char x, const char y, const uint8_t *buf, size_t len);
-		char print(const char x, const char y, const String str);
-		char enableFlash(const char x, const char y, const String str, const uint16_t interval);
+		char print(const char x, const char y, const TextSpan str);
+		char enableFlash(const char x, const char y, const TextSpan str, const uint16_t interval);
 		char disableFlash();
 		void clearCurrent();
+		void getFrame(uint8_t *lcd, uint8_t *flash);
+		void setFrame(const uint8_t *lcd, const uint8_t *flash);
+		unsigned long getFirstFrameMs();
 
 	private:
 		enum State {
 			IDLE,
 			SCAN,
 			WAIT,
+			DIRECT,
 			CONNECT,
 			PAIR,
 			INIT,
 			READY
 		};
 		State state;
+		void setState(State next);
 
 		BleUuid lcdBleServiceUuid;
 		BleUuid lcdBleClearCharacteristicUuid;
@@ -50,12 +57,22 @@ class BleLcd {
 
 		unsigned long stateTime;
 		BleAddress serverAddr;
+		bool serverBonded;
+		uint8_t directAttempts;
+
+		// Time-to-first-frame after on()
+		unsigned long onTime;
+		unsigned long firstFrameMs;
 
 		uint8_t curLCD[255];
 		uint8_t curFlash[255];
 
 		static void scanResultCallback(const BleScanResult *scanResult, void *context);
 		void scanResult(const BleScanResult *scanResult);
+		void loadBond();
+		void saveBond();
+		bool connectPeer();
+		void stateDirect();
 		void stateConnect();
 		void statePair();
 		void stateReady();
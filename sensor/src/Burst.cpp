@@ -0,0 +1,192 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Burst capture around short exposure events
+*/
+
+#include "Burst.h"
+#include "Fixed.h"
+
+static_assert(BURST_RISE_SAMPLES < BURST_PRE_SAMPLES, "Rise is measured within the pre-trigger ring");
+static_assert((BURST_PART_SAMPLES * SAMPLE_BINARY_LEN + 2) / 3 * 4 + 80 <= BURST_PART_LEN, "Burst part must fit in one publish");
+
+static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Base64 of data, returns end of text. No termination.
+static char *writeBase64(char *p, const uint8_t *data, size_t len) {
+	for (size_t i = 0; i < len; i += 3) {
+		uint32_t v = data[i] << 16;
+		if (i + 1 < len) v |= data[i + 1] << 8;
+		if (i + 2 < len) v |= data[i + 2];
+		*p++ = base64[(v >> 18) & 0x3F];
+		*p++ = base64[(v >> 12) & 0x3F];
+		*p++ = i + 1 < len ? base64[(v >> 6) & 0x3F] : '=';
+		*p++ = i + 2 < len ? base64[v & 0x3F] : '=';
+	}
+	return p;
+}
+
+BurstCapture::BurstCapture() {
+	first = 0;
+	used = 0;
+	capturing = false;
+	bursts = 0;
+	dropped = 0;
+	partsSent = 0;
+	reset();
+}
+
+// At ignition. The ring starts over, a burst being captured is kept as far
+// as it got.
+void BurstCapture::reset() {
+	ringHead = 0;
+	ringCount = 0;
+	pmAbove = false;
+	co2Above = false;
+	triggered = false;
+	if (capturing) {
+		Window &w = windows[(first + used - 1) % BURST_QUEUE];
+		w.end = w.count;
+		capturing = false;
+		bursts++;
+	}
+}
+
+// Next sample at BURST_INTERVAL_MS. Returns true when a burst is complete.
+bool BurstCapture::add(const Sample &sample) {
+	uint8_t reason = trigger(sample);
+
+	ring[ringHead] = sample;
+	ringHead = (ringHead + 1) % BURST_PRE_SAMPLES;
+	if (ringCount < BURST_PRE_SAMPLES) ringCount++;
+
+	if (capturing) {
+		Window &w = windows[(first + used - 1) % BURST_QUEUE];
+		w.samples[w.count++] = sample;
+		if (w.count < w.end) return false;
+		capturing = false;
+		bursts++;
+		return true;
+	}
+
+	// One burst per event, a long one is not captured again and again
+	if (reason == 0 || (triggered && millis() - triggerTime < BURST_HOLDOFF_MS)) return false;
+	triggered = true;
+	triggerTime = millis();
+	if (used == BURST_QUEUE) {
+		dropped++;
+		return false;
+	}
+	start(sample, reason);
+	return false;
+}
+
+// Trigger reasons for a new sample, against the ring before it. Readings
+// taken before a sensor settled don't count.
+uint8_t BurstCapture::trigger(const Sample &sample) {
+	uint8_t reason = 0;
+	const Sample *past = ringCount >= BURST_RISE_SAMPLES ?
+		&ring[(ringHead + BURST_PRE_SAMPLES - BURST_RISE_SAMPLES) % BURST_PRE_SAMPLES] : NULL;
+
+	if (!(sample.flags & SAMPLE_FLAG_PM_UNSETTLED)) {
+		uint16_t pm = pmMax(sample);
+		bool above = pm >= (uint16_t)(BURST_PM_LEVEL * 10);
+		if (above && !pmAbove) reason |= BURST_ON_PM_LEVEL;
+		pmAbove = above;
+		if (past && !(past->flags & SAMPLE_FLAG_PM_UNSETTLED) &&
+			pm >= pmMax(*past) + (uint16_t)(BURST_PM_RISE * 10)) reason |= BURST_ON_PM_RISE;
+	}
+
+	if (!(sample.flags & SAMPLE_FLAG_CV_UNSETTLED) && sample.co2 != 0) {
+		bool above = sample.co2 >= BURST_CO2_LEVEL;
+		if (above && !co2Above) reason |= BURST_ON_CO2_LEVEL;
+		co2Above = above;
+		if (past && !(past->flags & SAMPLE_FLAG_CV_UNSETTLED) && past->co2 != 0 &&
+			sample.co2 >= past->co2 + BURST_CO2_RISE) reason |= BURST_ON_CO2_RISE;
+	}
+
+	return reason;
+}
+
+// New window with the ring, oldest first. Ends BURST_POST_SAMPLES later.
+void BurstCapture::start(const Sample &sample, uint8_t reason) {
+	Window &w = windows[(first + used) % BURST_QUEUE];
+	used++;
+	capturing = true;
+
+	w.time = sample.time;
+	w.reason = reason;
+	w.count = 0;
+	w.sentParts = 0;
+	size_t oldest = (ringHead + BURST_PRE_SAMPLES - ringCount) % BURST_PRE_SAMPLES;
+	for (size_t i = 0; i < ringCount; i++) {
+		w.samples[w.count++] = ring[(oldest + i) % BURST_PRE_SAMPLES];
+	}
+	w.end = w.count + BURST_POST_SAMPLES;
+}
+
+bool BurstCapture::isCapturing() {
+	return capturing;
+}
+
+bool BurstCapture::pending() {
+	return used > (capturing ? 1 : 0);
+}
+
+// Next part of the oldest complete burst, as publish data:
+// {"burst":<UTC ms>,"reason":<bits>,"part":n,"parts":n,"samples":"<base64>"}
+// Samples are binary as in Sample.h, so a part holds BURST_PART_SAMPLES.
+size_t BurstCapture::part(char *buf, size_t len) {
+	if (!pending() || len == 0) return 0;
+	const Window &w = windows[first];
+
+	size_t from = w.sentParts * BURST_PART_SAMPLES;
+	size_t count = w.count - from < BURST_PART_SAMPLES ? w.count - from : BURST_PART_SAMPLES;
+	uint8_t data[BURST_PART_SAMPLES * SAMPLE_BINARY_LEN];
+	size_t n = 0;
+	for (size_t i = 0; i < count; i++) {
+		n += sampleEncode(w.samples[from + i], data + n, sizeof(data) - n);
+	}
+
+	int pos = snprintf(buf, len, "{\"burst\":%s,\"reason\":%u,\"part\":%u,\"parts\":%u,\"samples\":\"",
+		FixedText(w.time, 0).text, w.reason, w.sentParts, parts(w));
+	if (pos < 0 || (size_t)pos + (n + 2) / 3 * 4 + 3 > len) {
+		buf[0] = 0;
+		return 0;
+	}
+	char *p = writeBase64(buf + pos, data, n);
+	*p++ = '"';
+	*p++ = '}';
+	*p = 0;
+	return p - buf;
+}
+
+// Part from part() was published
+void BurstCapture::sent() {
+	if (!pending()) return;
+	Window &w = windows[first];
+	w.sentParts++;
+	partsSent++;
+	if (w.sentParts < parts(w)) return;
+	first = (first + 1) % BURST_QUEUE;
+	used--;
+}
+
+uint16_t BurstCapture::pmMax(const Sample &sample) {
+	uint16_t pm = sample.pm1;
+	if (sample.pm25 > pm) pm = sample.pm25;
+	if (sample.pm4 > pm) pm = sample.pm4;
+	if (sample.pm10 > pm) pm = sample.pm10;
+	return pm;
+}
+
+uint16_t BurstCapture::parts(const Window &window) {
+	return (window.count + BURST_PART_SAMPLES - 1) / BURST_PART_SAMPLES;
+}
+
+size_t BurstCapture::summary(char *buf, size_t len) {
+	int n = snprintf(buf, len,
+		"{\"bursts\":%lu,\"capturing\":%d,\"queued\":%u,\"dropped\":%lu,\"parts\":%lu}",
+		bursts, capturing, used - (capturing ? 1 : 0), dropped, partsSent);
+	return n < 0 ? 0 : ((size_t)n < len ? n : len - 1);
+}
@@ -0,0 +1,83 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Burst capture of short exposure events, like a tunnel or a
+			  diesel bus ahead, which vanish in the regular samples. Samples
+			  at BURST_INTERVAL_MS go through a pre-trigger ring. A level or
+			  rise trigger freezes the ring plus the samples that follow into
+			  a window, which is queued for upload as its own record.
+*/
+
+#ifndef BURST_H
+#define BURST_H
+
+#include "Particle.h"
+#include "Settings.h"
+#include "Sample.h"
+
+#define BURST_SAMPLES		(BURST_PRE_SAMPLES + BURST_POST_SAMPLES)
+
+// Publish data limit, each part of a burst fits in one publish
+#define BURST_PART_LEN		1024
+
+// Why a burst was captured, bits
+enum BurstReason : uint8_t {
+	BURST_ON_PM_LEVEL = 0x01,		// PM rose above BURST_PM_LEVEL
+	BURST_ON_PM_RISE = 0x02,		// PM rose BURST_PM_RISE within BURST_RISE_SAMPLES
+	BURST_ON_CO2_LEVEL = 0x04,
+	BURST_ON_CO2_RISE = 0x08
+};
+
+class BurstCapture {
+	public:
+		BurstCapture();
+
+		void reset();
+		bool add(const Sample &sample);
+		bool isCapturing();
+
+		// Upload of complete bursts, oldest first, one part per publish
+		bool pending();
+		size_t part(char *buf, size_t len);
+		void sent();
+
+		size_t summary(char *buf, size_t len);
+
+	private:
+		struct Window {
+			uint64_t time;		// UTC ms of trigger sample, identifies the burst
+			uint8_t reason;
+			uint16_t count;		// Samples so far
+			uint16_t end;		// Samples when complete
+			uint16_t sentParts;
+			Sample samples[BURST_SAMPLES];
+		};
+
+		uint8_t trigger(const Sample &sample);
+		void start(const Sample &sample, uint8_t reason);
+		static uint16_t pmMax(const Sample &sample);
+		static uint16_t parts(const Window &window);
+
+		// Pre-trigger ring, at BURST_INTERVAL_MS
+		Sample ring[BURST_PRE_SAMPLES];
+		size_t ringHead;		// Next sample to write
+		size_t ringCount;
+
+		// Windows waiting for upload, the newest is filling while capturing
+		Window windows[BURST_QUEUE];
+		uint8_t first;
+		uint8_t used;
+		bool capturing;
+
+		// Level triggers fire on the way up only
+		bool pmAbove;
+		bool co2Above;
+		system_tick_t triggerTime;
+		bool triggered;
+
+		uint32_t bursts;
+		uint32_t dropped;		// Triggers with no free window
+		uint32_t partsSent;
+};
+
+#endif
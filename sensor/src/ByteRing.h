@@ -0,0 +1,59 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Lock-free single producer, single consumer byte ring
+*/
+
+#ifndef BYTE_RING_H
+#define BYTE_RING_H
+
+#include "Particle.h"
+
+#include <atomic>
+
+// N must be a power of 2. Holds up to N - 1 bytes.
+template <size_t N>
+class ByteRing {
+	public:
+		ByteRing() : head(0), tail(0) {}
+
+		// Producer: returns number of bytes written
+		size_t push(const uint8_t *buf, size_t len) {
+			size_t h = head.load(std::memory_order_relaxed);
+			size_t t = tail.load(std::memory_order_acquire);
+			size_t room = (t - h - 1) & (N - 1);
+			if (len > room) len = room;
+			for (size_t i = 0; i < len; i++) data[(h + i) & (N - 1)] = buf[i];
+			head.store((h + len) & (N - 1), std::memory_order_release);
+			return len;
+		}
+
+		// Consumer: returns number of bytes read
+		size_t pop(uint8_t *buf, size_t len) {
+			size_t t = tail.load(std::memory_order_relaxed);
+			size_t h = head.load(std::memory_order_acquire);
+			size_t avail = (h - t) & (N - 1);
+			if (len > avail) len = avail;
+			for (size_t i = 0; i < len; i++) buf[i] = data[(t + i) & (N - 1)];
+			tail.store((t + len) & (N - 1), std::memory_order_release);
+			return len;
+		}
+
+		size_t available() {
+			return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & (N - 1);
+		}
+
+		// Consumer only
+		void clear() {
+			tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+		}
+
+	private:
+		static_assert((N & (N - 1)) == 0, "ByteRing size must be a power of 2");
+
+		uint8_t data[N];
+		std::atomic<size_t> head;
+		std::atomic<size_t> tail;
+};
+
+#endif
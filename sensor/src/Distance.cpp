@@ -0,0 +1,155 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Distance between GPS fixes
+*/
+
+#include "Distance.h"
+
+// WGS84
+#define WGS84_A		6378137.
+#define WGS84_F		(1. / 298.257223563)
+#define WGS84_B		(WGS84_A * (1. - WGS84_F))
+#define WGS84_E2	(WGS84_F * (2. - WGS84_F))
+
+// Mean earth radius for spherical kernels
+#define EARTH_R		6371008.8f
+
+#define DEG_TO_RAD	(M_PI / 180.)
+
+// Local meridian and prime vertical radii as meters per degree
+void distanceScale(double latitude, DistanceScale *scale) {
+	double s = sin(latitude * DEG_TO_RAD);
+	double w = 1. - WGS84_E2 * s * s;
+	double n = WGS84_A / sqrt(w);
+	double m = n * (1. - WGS84_E2) / w;
+	scale->latitude = latitude;
+	scale->north = m * DEG_TO_RAD;
+	scale->east = n * cos(latitude * DEG_TO_RAD) * DEG_TO_RAD;
+}
+
+// Flat earth around the scale's latitude. Differences are taken in double,
+// so the float math keeps cm resolution.
+float distanceEquirect(const DistanceScale &scale, double lat1, double lng1, double lat2, double lng2) {
+	float y = (float)(lat2 - lat1) * scale.north;
+	float x = (float)(lng2 - lng1) * scale.east;
+	return sqrtf(x * x + y * y);
+}
+
+float distanceHaversine(double lat1, double lng1, double lat2, double lng2) {
+	float dLat = (float)((lat2 - lat1) * DEG_TO_RAD);
+	float dLng = (float)((lng2 - lng1) * DEG_TO_RAD);
+	float sLat = sinf(dLat / 2);
+	float sLng = sinf(dLng / 2);
+	float a = sLat * sLat + sLng * sLng * cosf((float)(lat1 * DEG_TO_RAD)) * cosf((float)(lat2 * DEG_TO_RAD));
+	return 2 * EARTH_R * asinf(sqrtf(fminf(a, 1.f)));
+}
+
+// Vincenty inverse formula. Falls back to the sphere for nearly antipodal
+// points, where it does not converge.
+double distanceVincenty(double lat1, double lng1, double lat2, double lng2) {
+	double L = (lng2 - lng1) * DEG_TO_RAD;
+	double U1 = atan((1. - WGS84_F) * tan(lat1 * DEG_TO_RAD));
+	double U2 = atan((1. - WGS84_F) * tan(lat2 * DEG_TO_RAD));
+	double sinU1 = sin(U1), cosU1 = cos(U1);
+	double sinU2 = sin(U2), cosU2 = cos(U2);
+
+	double lambda = L;
+	double sinSigma, cosSigma, sigma, cos2Alpha, cos2SigmaM;
+	for (uint8_t i = 0; i < 100; i++) {
+		double sinLambda = sin(lambda), cosLambda = cos(lambda);
+		double t1 = cosU2 * sinLambda;
+		double t2 = cosU1 * sinU2 - sinU1 * cosU2 * cosLambda;
+		sinSigma = sqrt(t1 * t1 + t2 * t2);
+		if (sinSigma == 0.) return 0.;
+		cosSigma = sinU1 * sinU2 + cosU1 * cosU2 * cosLambda;
+		sigma = atan2(sinSigma, cosSigma);
+		double sinAlpha = cosU1 * cosU2 * sinLambda / sinSigma;
+		cos2Alpha = 1. - sinAlpha * sinAlpha;
+		cos2SigmaM = cos2Alpha != 0. ? cosSigma - 2. * sinU1 * sinU2 / cos2Alpha : 0.;
+		double C = WGS84_F / 16. * cos2Alpha * (4. + WGS84_F * (4. - 3. * cos2Alpha));
+		double prev = lambda;
+		lambda = L + (1. - C) * WGS84_F * sinAlpha *
+			(sigma + C * sinSigma * (cos2SigmaM + C * cosSigma * (-1. + 2. * cos2SigmaM * cos2SigmaM)));
+		if (fabs(lambda - prev) < 1e-12) {
+			double u2 = cos2Alpha * (WGS84_A * WGS84_A - WGS84_B * WGS84_B) / (WGS84_B * WGS84_B);
+			double A = 1. + u2 / 16384. * (4096. + u2 * (-768. + u2 * (320. - 175. * u2)));
+			double B = u2 / 1024. * (256. + u2 * (-128. + u2 * (74. - 47. * u2)));
+			double dSigma = B * sinSigma * (cos2SigmaM + B / 4. * (cosSigma * (-1. + 2. * cos2SigmaM * cos2SigmaM) -
+				B / 6. * cos2SigmaM * (-3. + 4. * sinSigma * sinSigma) * (-3. + 4. * cos2SigmaM * cos2SigmaM)));
+			return WGS84_B * A * (sigma - dSigma);
+		}
+	}
+	return distanceHaversine(lat1, lng1, lat2, lng2);
+}
+
+Odometer::Odometer(DistanceKernel kernel) : kernel(kernel) {
+	scale.latitude = 1000.;
+	reset();
+}
+
+void Odometer::reset() {
+	meters = 0.;
+	rejected = 0;
+	pause();
+}
+
+// Next fix starts a new leg, e.g. after losing position
+void Odometer::pause() {
+	anchored = false;
+}
+
+// Adds distance to this fix. While slower than DISTANCE_STATIONARY_KMH,
+// fixes within DISTANCE_JITTER_M of the last counted position are ignored.
+void Odometer::add(double latitude, double longitude, float speed, system_tick_t millis) {
+	if (!anchored) {
+		anchorLat = latitude;
+		anchorLng = longitude;
+		lastMillis = millis;
+		anchored = true;
+		return;
+	}
+
+	if (kernel == DISTANCE_SPEED) {
+		if (speed >= DISTANCE_STATIONARY_KMH) {
+			meters += speed / 3.6 * (millis - lastMillis) / 1000.;
+		}
+		else {
+			rejected++;
+		}
+		lastMillis = millis;
+		return;
+	}
+
+	float d = hop(latitude, longitude);
+	lastMillis = millis;
+	if (speed < DISTANCE_STATIONARY_KMH && d < DISTANCE_JITTER_M) {
+		rejected++;
+		return;
+	}
+	meters += d;
+	anchorLat = latitude;
+	anchorLng = longitude;
+}
+
+float Odometer::hop(double latitude, double longitude) {
+	switch (kernel) {
+		case DISTANCE_EQUIRECT:
+			if (fabs(latitude - scale.latitude) > DISTANCE_SCALE_REFRESH_DEG) distanceScale(latitude, &scale);
+			return distanceEquirect(scale, anchorLat, anchorLng, latitude, longitude);
+		case DISTANCE_HAVERSINE:
+			return distanceHaversine(anchorLat, anchorLng, latitude, longitude);
+		case DISTANCE_VINCENTY:
+			return distanceVincenty(anchorLat, anchorLng, latitude, longitude);
+		default:
+			return 0;
+	}
+}
+
+double Odometer::getKm() {
+	return meters / 1000.;
+}
+
+uint32_t Odometer::getRejected() {
+	return rejected;
+}
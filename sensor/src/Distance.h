@@ -0,0 +1,58 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Distance between GPS fixes. Interchangeable kernels, from cheap
+			  (speed * time, flat earth with cached scale) to Vincenty on the
+			  WGS84 ellipsoid for reference, and an odometer that ignores
+			  position jitter while stationary.
+*/
+
+#ifndef DISTANCE_H
+#define DISTANCE_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+enum DistanceKernel {
+	DISTANCE_SPEED,			// Speed over ground * time between fixes
+	DISTANCE_EQUIRECT,		// Flat earth, local ellipsoid radii cached per latitude
+	DISTANCE_HAVERSINE,		// Sphere, single precision
+	DISTANCE_VINCENTY		// WGS84 ellipsoid, double precision, iterative
+};
+
+// Meters per degree at a latitude, for the equirectangular kernel
+struct DistanceScale {
+	double latitude;		// Latitude the scale was computed for
+	float north;			// m per degree latitude
+	float east;				// m per degree longitude
+};
+
+void distanceScale(double latitude, DistanceScale *scale);
+float distanceEquirect(const DistanceScale &scale, double lat1, double lng1, double lat2, double lng2);
+float distanceHaversine(double lat1, double lng1, double lat2, double lng2);
+double distanceVincenty(double lat1, double lng1, double lat2, double lng2);
+
+class Odometer {
+	public:
+		Odometer(DistanceKernel kernel = L86_DISTANCE_KERNEL);
+
+		void reset();
+		void pause();
+		void add(double latitude, double longitude, float speed, system_tick_t millis);
+		double getKm();
+		uint32_t getRejected();
+
+	private:
+		float hop(double latitude, double longitude);
+
+		DistanceKernel kernel;
+		DistanceScale scale;
+		bool anchored;
+		double anchorLat;		// Last position counted
+		double anchorLng;
+		system_tick_t lastMillis;
+		double meters;
+		uint32_t rejected;		// Fixes dropped as stationary jitter
+};
+
+#endif
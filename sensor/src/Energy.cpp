@@ -0,0 +1,135 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Energy ledger, time in state x current per subsystem
+*/
+
+#include "Energy.h"
+#include "Fixed.h"
+
+// Shared instance, so drivers can report their state changes
+EnergyLedger energy;
+
+#define MA_MS_PER_MAH	3600000.
+
+// Supply current per state, mA
+static const float currents[ENERGY_SUBSYSTEMS][ENERGY_MAX_STATES] = {
+	{ ENERGY_MCU_RUN_MA, ENERGY_MCU_SLEEP_MA },
+	{ 0, RADIO_CONNECT_MA, RADIO_IDLE_MA },
+	{ 0, ENERGY_BLE_ACTIVE_MA, ENERGY_BLE_CONNECTED_MA },
+	{ L86_FULL_MA, L86_ALWAYSLOCATE_MA,
+		(L86_FULL_MA * L86_PERIODIC_RUN_MS + L86_STANDBY_MA * L86_PERIODIC_SLEEP_MS) / (L86_PERIODIC_RUN_MS + L86_PERIODIC_SLEEP_MS),
+		L86_BACKUP_MA },
+	{ ENERGY_SEN50_IDLE_MA, ENERGY_SEN50_MEASURING_MA }
+};
+
+EnergyLedger::EnergyLedger() {
+	for (uint8_t i = 0; i < ENERGY_SUBSYSTEMS; i++) {
+		state[i] = 0;
+		since[i] = 0;
+		trip[i] = 0;
+	}
+	inTrip = false;
+	parked = 0;
+	uploads = 0;
+	tripStartMs = 0;
+	lastTripMah = 0;
+	lastTripUploads = 0;
+	lastTripMs = 0;
+}
+
+// Books time in current state, then switches
+void EnergyLedger::set(EnergySubsystem sub, uint8_t next) {
+	if (sub >= ENERGY_SUBSYSTEMS || next >= ENERGY_MAX_STATES || state[sub] == next) return;
+	book(sub);
+	state[sub] = next;
+}
+
+// Call at ignition. Energy until now is booked as parked.
+void EnergyLedger::tripStart() {
+	bookAll();
+	for (uint8_t i = 0; i < ENERGY_SUBSYSTEMS; i++) trip[i] = 0;
+	uploads = 0;
+	tripStartMs = millis();
+	inTrip = true;
+}
+
+// Call when ignition goes off, after the drivers are turned off
+void EnergyLedger::tripEnd() {
+	if (!inTrip) return;
+	bookAll();
+	lastTripMah = tripMah();
+	lastTripUploads = uploads;
+	lastTripMs = millis() - tripStartMs;
+	parked = 0;
+	inTrip = false;
+}
+
+void EnergyLedger::countUpload() {
+	uploads++;
+}
+
+float EnergyLedger::tripMah() {
+	float mAh = 0;
+	for (uint8_t i = 0; i < ENERGY_SUBSYSTEMS; i++) mAh += tripMah((EnergySubsystem)i);
+	return mAh;
+}
+
+float EnergyLedger::tripMah(EnergySubsystem sub) {
+	if (sub >= ENERGY_SUBSYSTEMS) return 0;
+	book(sub);
+	return trip[sub] / MA_MS_PER_MAH;
+}
+
+uint32_t EnergyLedger::tripUploads() {
+	return uploads;
+}
+
+// Since last trip ended
+float EnergyLedger::parkedMah() {
+	bookAll();
+	return parked / MA_MS_PER_MAH;
+}
+
+// {"trip":{"ms":..,"mAh":..,"mcu":..,...,"uploads":n,"perUpload":..},"last":{...},"parked":..}
+size_t EnergyLedger::summary(char *buf, size_t len) {
+	bookAll();
+	size_t pos = 0;
+
+	float mAh = tripMah();
+	pos += snprintf(buf + pos, len > pos ? len - pos : 0, "{\"trip\":{\"ms\":%lu,\"mAh\":%s,",
+		inTrip ? (unsigned long)(millis() - tripStartMs) : 0UL, FixedText(lroundf(mAh * 100), 2).text);
+	for (uint8_t i = 0; i < ENERGY_SUBSYSTEMS; i++) {
+		pos += snprintf(buf + pos, len > pos ? len - pos : 0, "\"%s\":%s,",
+			name((EnergySubsystem)i), FixedText(llround(trip[i] * 100 / MA_MS_PER_MAH), 2).text);
+	}
+	pos += snprintf(buf + pos, len > pos ? len - pos : 0,
+		"\"uploads\":%lu,\"perUpload\":%s},\"last\":{\"ms\":%lu,\"mAh\":%s,\"uploads\":%lu},\"parked\":%s}",
+		(unsigned long)uploads, FixedText(uploads ? lroundf(mAh * 1000 / uploads) : 0, 3).text,
+		(unsigned long)lastTripMs, FixedText(lroundf(lastTripMah * 100), 2).text, (unsigned long)lastTripUploads,
+		FixedText(llround(parked * 100 / MA_MS_PER_MAH), 2).text);
+
+	return pos < len ? pos : len - 1;
+}
+
+float EnergyLedger::current(EnergySubsystem sub, uint8_t state) {
+	if (sub >= ENERGY_SUBSYSTEMS || state >= ENERGY_MAX_STATES) return 0;
+	return currents[sub][state];
+}
+
+const char *EnergyLedger::name(EnergySubsystem sub) {
+	static const char *names[ENERGY_SUBSYSTEMS] = { "mcu", "wifi", "ble", "gps", "sen50" };
+	return sub < ENERGY_SUBSYSTEMS ? names[sub] : "?";
+}
+
+void EnergyLedger::book(EnergySubsystem sub) {
+	system_tick_t now = millis();
+	double mAms = (double)currents[sub][state[sub]] * (system_tick_t)(now - since[sub]);
+	since[sub] = now;
+	if (inTrip) trip[sub] += mAms;
+	else parked += mAms;
+}
+
+void EnergyLedger::bookAll() {
+	for (uint8_t i = 0; i < ENERGY_SUBSYSTEMS; i++) book((EnergySubsystem)i);
+}
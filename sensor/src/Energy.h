@@ -0,0 +1,75 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Energy ledger. Drivers report state changes, and time in each
+			  state is booked against a table of currents, per subsystem,
+			  per trip and while parked.
+*/
+
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+enum EnergySubsystem {
+	ENERGY_MCU,
+	ENERGY_WIFI,
+	ENERGY_BLE,
+	ENERGY_GPS,
+	ENERGY_SEN50,
+	ENERGY_SUBSYSTEMS
+};
+
+// States per subsystem, index into the current table. First state is the
+// one the subsystem is in at power up.
+enum { ENERGY_MCU_RUN, ENERGY_MCU_SLEEP };
+enum { ENERGY_WIFI_OFF, ENERGY_WIFI_CONNECTING, ENERGY_WIFI_CONNECTED };
+enum { ENERGY_BLE_OFF, ENERGY_BLE_ACTIVE, ENERGY_BLE_CONNECTED };
+enum { ENERGY_GPS_FULL, ENERGY_GPS_ALWAYSLOCATE, ENERGY_GPS_PERIODIC, ENERGY_GPS_BACKUP };	// GpsPowerMode first
+enum { ENERGY_SEN50_IDLE, ENERGY_SEN50_MEASURING };
+
+#define ENERGY_MAX_STATES	4
+
+class EnergyLedger {
+	public:
+		EnergyLedger();
+
+		void set(EnergySubsystem sub, uint8_t state);
+		void tripStart();
+		void tripEnd();
+		void countUpload();
+
+		float tripMah();
+		float tripMah(EnergySubsystem sub);
+		uint32_t tripUploads();
+		float parkedMah();
+
+		size_t summary(char *buf, size_t len);
+
+		static float current(EnergySubsystem sub, uint8_t state);
+		static const char *name(EnergySubsystem sub);
+
+	private:
+		void book(EnergySubsystem sub);
+		void bookAll();
+
+		uint8_t state[ENERGY_SUBSYSTEMS];
+		system_tick_t since[ENERGY_SUBSYSTEMS];
+
+		// mA x ms
+		bool inTrip;
+		double trip[ENERGY_SUBSYSTEMS];
+		double parked;
+		uint32_t uploads;
+		system_tick_t tripStartMs;
+
+		// Last completed trip
+		float lastTripMah;
+		uint32_t lastTripUploads;
+		system_tick_t lastTripMs;
+};
+
+extern EnergyLedger energy;
+
+#endif
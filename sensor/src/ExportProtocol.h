@@ -0,0 +1,74 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Bulk export of the sample log over USB serial, shared by the
+			  firmware and tools/journal_export. Only depends on stdint, so
+			  host tools can include it.
+
+			  Host sends one text line:
+			    AFX <from ms> <to ms> <skip>\n   Samples with from <= time < to
+			                                     (0 = open end), leaving out the
+			                                     first <skip>, to resume
+			    AFB <bytes>\n                    Dummy data, for throughput
+			    AFK <index>\n                    Records up to END's index are
+			                                     safely stored. After AFX 0 0,
+			                                     records kept from before a
+			                                     firmware update are deleted.
+
+			  Device answers with frames, little endian:
+			    uint8_t   'A'
+			    uint8_t   'F'
+			    uint8_t   type
+			    uint8_t   EXPORT_PROTOCOL_VERSION
+			    uint16_t  payload length
+			    uint32_t  index
+			    uint8_t   payload[length]
+			    uint32_t  CRC-32 of all of the above
+
+			  HEADER   index = skip, payload = schema version, record length.
+			           Sent again with the number of the next record when
+			           the layout changes. Records kept from before a
+			           firmware update come first, in their own layout.
+			  DATA     index = number of the first record, payload = records
+			           of the last HEADER's layout
+			  END      index = number of records in the range
+			  ERROR    payload = text
+*/
+
+#ifndef EXPORT_PROTOCOL_H
+#define EXPORT_PROTOCOL_H
+
+#include <string.h>
+#include "Crc32.h"
+
+#define EXPORT_PROTOCOL_VERSION	1
+
+#define EXPORT_HEADER_LEN		10
+#define EXPORT_CRC_LEN			4
+#define EXPORT_MAX_PAYLOAD		1024
+
+enum ExportFrameType {
+	EXPORT_HEADER = 1,
+	EXPORT_DATA,
+	EXPORT_END,
+	EXPORT_ERROR
+};
+
+// Builds a frame in out, which must hold payload + EXPORT_HEADER_LEN +
+// EXPORT_CRC_LEN bytes. Returns frame length.
+inline size_t exportFrame(uint8_t type, uint32_t index, const uint8_t *payload, uint16_t len, uint8_t *out) {
+	out[0] = 'A';
+	out[1] = 'F';
+	out[2] = type;
+	out[3] = EXPORT_PROTOCOL_VERSION;
+	out[4] = len & 0xFF;
+	out[5] = len >> 8;
+	for (uint8_t i = 0; i < 4; i++) out[6 + i] = (index >> (8 * i)) & 0xFF;
+	if (len > 0 && payload != out + EXPORT_HEADER_LEN) memcpy(out + EXPORT_HEADER_LEN, payload, len);
+
+	uint32_t crc = crc32(out, EXPORT_HEADER_LEN + len);
+	for (uint8_t i = 0; i < 4; i++) out[EXPORT_HEADER_LEN + len + i] = (crc >> (8 * i)) & 0xFF;
+	return EXPORT_HEADER_LEN + len + EXPORT_CRC_LEN;
+}
+
+#endif
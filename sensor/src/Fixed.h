@@ -0,0 +1,39 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Fixed point values as decimal text, so nothing needs the float
+			  printf. Only depends on stdint, so host tools can include it.
+*/
+
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Writes value / 10^decimals as decimal text, returns end of text. No
+// termination, at most 21 + decimals characters.
+inline char *fixedWrite(char *p, int64_t value, uint8_t decimals) {
+	char tmp[24];
+	size_t n = 0;
+	uint64_t u = value < 0 ? -(uint64_t)value : (uint64_t)value;
+	do {
+		tmp[n++] = '0' + (u % 10);
+		u /= 10;
+		if (n == decimals) tmp[n++] = '.';
+	} while (u > 0 || n < (size_t)decimals + (decimals > 0 ? 2 : 1));
+	if (value < 0) *p++ = '-';
+	while (n > 0) *p++ = tmp[--n];
+	return p;
+}
+
+// Value as text for a %s, e.g. FixedText(mAh, 2).text. Lives until the end
+// of the statement it is created in.
+struct FixedText {
+	FixedText(int64_t value, uint8_t decimals) {
+		*fixedWrite(text, value, decimals) = 0;
+	}
+	char text[24];
+};
+
+#endif
@@ -0,0 +1,167 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Constant velocity Kalman filter for GPS fixes
+*/
+
+#include "GpsFilter.h"
+
+// Meters per degree latitude (mean earth radius 6371 km)
+#define METERS_PER_DEG		111194.93
+
+GpsFilter::GpsFilter() {
+	reset();
+}
+
+void GpsFilter::reset() {
+	initialised = false;
+	originLat = 0.;
+	originLng = 0.;
+	metersPerDegLng = METERS_PER_DEG;
+	lastMillis = 0;
+	memset(&track, 0, sizeof(track));
+	memset(&prevTrack, 0, sizeof(prevTrack));
+}
+
+// Local plane is centered at origin. Moved when we get far from it, to keep
+// float precision in the filter.
+void GpsFilter::setOrigin(double latitude, double longitude) {
+	originLat = latitude;
+	originLng = longitude;
+	metersPerDegLng = METERS_PER_DEG * cos(latitude * M_PI / 180.);
+}
+
+// Speed in km/t, course in degrees from north
+void GpsFilter::update(double latitude, double longitude, float speed, float course, system_tick_t millis) {
+	// Velocity measurement. Course is noise when standing still.
+	float v = speed / 3.6;
+	float velNorth = 0.;
+	float velEast = 0.;
+	if (speed >= GPS_FILTER_MIN_COURSE_SPEED) {
+		velNorth = v * cosf(course * (float)M_PI / 180.f);
+		velEast = v * sinf(course * (float)M_PI / 180.f);
+	}
+
+	float dt = (millis - lastMillis) / 1000.f;
+	if (!initialised || dt <= 0. || dt > GPS_FILTER_RESET_S) {
+		// First fix, or too long since last one
+		setOrigin(latitude, longitude);
+		init(&east, 0., velEast);
+		init(&north, 0., velNorth);
+		initialised = true;
+		lastMillis = millis;
+		prevTrack.valid = false;
+		toTrack(millis);
+		return;
+	}
+
+	// Position in local plane
+	float x = (longitude - originLng) * metersPerDegLng;
+	float y = (latitude - originLat) * METERS_PER_DEG;
+
+	predict(&east, dt);
+	predict(&north, dt);
+	updatePosition(&east, x, GPS_FILTER_POS_VAR);
+	updatePosition(&north, y, GPS_FILTER_POS_VAR);
+	updateVelocity(&east, velEast, GPS_FILTER_VEL_VAR);
+	updateVelocity(&north, velNorth, GPS_FILTER_VEL_VAR);
+	lastMillis = millis;
+
+	prevTrack = track;
+	toTrack(millis);
+
+	// Move origin to current position when far away
+	if (fabsf(east.pos) > GPS_FILTER_ORIGIN_M || fabsf(north.pos) > GPS_FILTER_ORIGIN_M) {
+		setOrigin(track.latitude, track.longitude);
+		east.pos = 0.;
+		north.pos = 0.;
+	}
+}
+
+void GpsFilter::toTrack(system_tick_t millis) {
+	track.valid = true;
+	track.latitude = originLat + north.pos / METERS_PER_DEG;
+	track.longitude = originLng + east.pos / metersPerDegLng;
+	track.velNorth = north.vel;
+	track.velEast = east.vel;
+	track.millis = millis;
+}
+
+const GpsTrack &GpsFilter::getTrack() const {
+	return track;
+}
+
+const GpsTrack &GpsFilter::getPrevTrack() const {
+	return prevTrack;
+}
+
+void GpsFilter::init(Axis *axis, float pos, float vel) {
+	axis->pos = pos;
+	axis->vel = vel;
+	axis->a = GPS_FILTER_POS_VAR;
+	axis->b = 0.;
+	axis->c = GPS_FILTER_VEL_VAR;
+}
+
+// x = F x, P = F P F' + Q, with F = [[1, dt], [0, 1]] and white noise acceleration
+void GpsFilter::predict(Axis *axis, float dt) {
+	float dt2 = dt * dt;
+	float q = GPS_FILTER_ACCEL_VAR;
+	axis->pos += axis->vel * dt;
+	axis->a += 2.f * axis->b * dt + axis->c * dt2 + q * dt2 * dt2 / 4.f;
+	axis->b += axis->c * dt + q * dt2 * dt / 2.f;
+	axis->c += q * dt2;
+}
+
+// Measurement of position, H = [1, 0]
+void GpsFilter::updatePosition(Axis *axis, float pos, float variance) {
+	float s = axis->a + variance;
+	float k1 = axis->a / s;
+	float k2 = axis->b / s;
+	float y = pos - axis->pos;
+	axis->pos += k1 * y;
+	axis->vel += k2 * y;
+	float a = axis->a;
+	float b = axis->b;
+	axis->a = a - k1 * a;
+	axis->b = b - k1 * b;
+	axis->c -= k2 * b;
+}
+
+// Measurement of velocity, H = [0, 1]
+void GpsFilter::updateVelocity(Axis *axis, float vel, float variance) {
+	float s = axis->c + variance;
+	float k1 = axis->b / s;
+	float k2 = axis->c / s;
+	float y = vel - axis->vel;
+	axis->pos += k1 * y;
+	axis->vel += k2 * y;
+	float b = axis->b;
+	float c = axis->c;
+	axis->a -= k1 * b;
+	axis->b = b - k1 * c;
+	axis->c = c - k2 * c;
+}
+
+// Position at time millis. Interpolates between the two latest fixes, or
+// extrapolates from the latest fix with its velocity (max. GPS_FILTER_MAX_EXTRAPOLATE_MS).
+bool GpsFilter::positionAt(const GpsTrack &prev, const GpsTrack &cur, system_tick_t millis,
+	double *latitude, double *longitude) {
+	if (!cur.valid) return false;
+
+	int32_t dt = (int32_t)(millis - cur.millis);
+	if (dt < 0 && prev.valid && (int32_t)(millis - prev.millis) >= 0) {
+		// Between fixes
+		double f = (double)(millis - prev.millis) / (double)(cur.millis - prev.millis);
+		*latitude = prev.latitude + (cur.latitude - prev.latitude) * f;
+		*longitude = prev.longitude + (cur.longitude - prev.longitude) * f;
+		return true;
+	}
+
+	if (dt > GPS_FILTER_MAX_EXTRAPOLATE_MS) dt = GPS_FILTER_MAX_EXTRAPOLATE_MS;
+	if (dt < -GPS_FILTER_MAX_EXTRAPOLATE_MS) dt = -GPS_FILTER_MAX_EXTRAPOLATE_MS;
+	float s = dt / 1000.f;
+	*latitude = cur.latitude + cur.velNorth * s / METERS_PER_DEG;
+	*longitude = cur.longitude + cur.velEast * s / (METERS_PER_DEG * cos(cur.latitude * M_PI / 180.));
+	return true;
+}
@@ -0,0 +1,68 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Constant velocity Kalman filter for GPS fixes, with position
+			  interpolation to arbitrary times. Runs as two independent
+			  2-state filters (east, north) in a local plane, so each
+			  update is a fixed handful of multiplications.
+*/
+
+#ifndef GPS_FILTER_H
+#define GPS_FILTER_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+// Filtered position and velocity at a point in time
+struct GpsTrack {
+	bool valid;
+	double latitude;
+	double longitude;
+	float velNorth;			// m/s
+	float velEast;			// m/s
+	system_tick_t millis;	// Time of fix
+};
+
+class GpsFilter {
+	public:
+		GpsFilter();
+
+		void reset();
+		void update(double latitude, double longitude, float speed, float course, system_tick_t millis);
+		const GpsTrack &getTrack() const;
+		const GpsTrack &getPrevTrack() const;
+
+		static bool positionAt(const GpsTrack &prev, const GpsTrack &cur, system_tick_t millis,
+			double *latitude, double *longitude);
+
+	private:
+		// State and covariance [[a, b], [b, c]] of one axis
+		struct Axis {
+			float pos;	// m
+			float vel;	// m/s
+			float a;
+			float b;
+			float c;
+		};
+
+		static void init(Axis *axis, float pos, float vel);
+		static void predict(Axis *axis, float dt);
+		static void updatePosition(Axis *axis, float pos, float variance);
+		static void updateVelocity(Axis *axis, float vel, float variance);
+
+		void setOrigin(double latitude, double longitude);
+		void toTrack(system_tick_t millis);
+
+		Axis east;
+		Axis north;
+		bool initialised;
+		double originLat;
+		double originLng;
+		float metersPerDegLng;
+		system_tick_t lastMillis;
+
+		GpsTrack track;
+		GpsTrack prevTrack;
+};
+
+#endif
@@ -0,0 +1,28 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Choice of L86 power mode from the fixes
+*/
+
+#include "GpsPower.h"
+
+GpsPowerPolicy::GpsPowerPolicy(system_tick_t alwaysLocateAfterMs, system_tick_t periodicAfterMs) :
+	alwaysLocateAfterMs(alwaysLocateAfterMs), periodicAfterMs(periodicAfterMs) {
+	reset(0);
+}
+
+// Module starts in full tracking
+void GpsPowerPolicy::reset(system_tick_t millis) {
+	stoppedSince = millis;
+}
+
+// Full tracking while moving or without a fix. When stopped, fixes are of
+// little use, so the module is left to save power.
+GpsPowerMode GpsPowerPolicy::update(bool valid, float speed, system_tick_t millis) {
+	if (!valid || speed >= L86_MOVING_KMH) stoppedSince = millis;
+
+	system_tick_t stopped = millis - stoppedSince;
+	if (stopped >= periodicAfterMs) return GPS_MODE_PERIODIC;
+	if (stopped >= alwaysLocateAfterMs) return GPS_MODE_ALWAYSLOCATE;
+	return GPS_MODE_FULL;
+}
@@ -0,0 +1,35 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Choice of L86 power mode from the fixes. Kept apart from the
+			  driver, so the energy simulator runs the same policy.
+*/
+
+#ifndef GPS_POWER_H
+#define GPS_POWER_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+enum GpsPowerMode {
+	GPS_MODE_FULL,			// Continuous tracking at L86_FIX_INTERVAL_MS
+	GPS_MODE_ALWAYSLOCATE,	// Module adapts its own duty cycle
+	GPS_MODE_PERIODIC,		// Standby between fixed run windows
+	GPS_MODE_COUNT
+};
+
+class GpsPowerPolicy {
+	public:
+		GpsPowerPolicy(system_tick_t alwaysLocateAfterMs = L86_ALWAYSLOCATE_AFTER_MS,
+			system_tick_t periodicAfterMs = L86_PERIODIC_AFTER_MS);
+
+		void reset(system_tick_t millis);
+		GpsPowerMode update(bool valid, float speed, system_tick_t millis);
+
+	private:
+		system_tick_t alwaysLocateAfterMs;
+		system_tick_t periodicAfterMs;
+		system_tick_t stoppedSince;
+};
+
+#endif
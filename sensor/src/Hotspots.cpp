@@ -0,0 +1,326 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Historical pollution levels per geohash cell
+*/
+
+#include "Hotspots.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define HOTSPOT_MAGIC		0x48535031	// "HSP1"
+#define HOTSPOT_NO_CELL		0xFFFFFFFF
+#define HOTSPOT_TMP_FILE	HOTSPOT_FILE ".tmp"
+
+static_assert(HOTSPOT_PAGE <= HOTSPOT_MERGE_CELLS, "A page must fit in the merge buffer");
+
+static const char base32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+Hotspots::Hotspots() {
+	fd = -1;
+	header.magic = HOTSPOT_MAGIC;
+	header.version = 0;
+	header.lastCell = HOTSPOT_NO_CELL;
+	header.count = 0;
+	for (size_t i = 0; i < 2; i++) {
+		cache[i].cell = HOTSPOT_NO_CELL;
+		cacheFound[i] = false;
+	}
+	cacheNext = 0;
+	synced = false;
+	syncedAt = 0;
+	pages = 0;
+	merges = 0;
+	reads = 0;
+	pendingCount = 0;
+	cursorVersion = 0;
+	cursorCell = HOTSPOT_NO_CELL;
+}
+
+// Opens table, starting empty if it is missing or damaged
+void Hotspots::begin() {
+	reopen();
+	cursorVersion = header.version;
+	cursorCell = header.lastCell;
+
+#ifdef AIRFLEET_DEBUG
+	Log.info("Hotspots: version %lu, %lu cells", header.version, header.count);
+#endif
+}
+
+void Hotspots::reopen() {
+	if (fd >= 0) close(fd);
+	fd = open(HOTSPOT_FILE, O_RDONLY);
+
+	Header h;
+	if (fd >= 0 && read(fd, &h, sizeof(h)) == sizeof(h) && h.magic == HOTSPOT_MAGIC
+		&& h.count <= HOTSPOT_MAX_CELLS) {
+		header = h;
+	}
+	else {
+		header.magic = HOTSPOT_MAGIC;
+		header.version = 0;
+		header.lastCell = HOTSPOT_NO_CELL;
+		header.count = 0;
+	}
+
+	for (size_t i = 0; i < 2; i++) {
+		cache[i].cell = HOTSPOT_NO_CELL;
+		cacheFound[i] = false;
+	}
+}
+
+bool Hotspots::readCell(uint32_t index, HotspotCell *entry) {
+	reads++;
+	off_t pos = sizeof(Header) + index * sizeof(HotspotCell);
+	return lseek(fd, pos, SEEK_SET) == pos && read(fd, entry, sizeof(*entry)) == sizeof(*entry);
+}
+
+// Binary search in the table file
+bool Hotspots::lookup(uint32_t cell, HotspotCell *entry) {
+	for (size_t i = 0; i < 2; i++) {
+		if (cache[i].cell == cell) {
+			*entry = cache[i];
+			return cacheFound[i];
+		}
+	}
+
+	bool found = false;
+	if (fd >= 0) {
+		uint32_t lo = 0;
+		uint32_t hi = header.count;
+		while (lo < hi) {
+			uint32_t mid = lo + (hi - lo) / 2;
+			if (!readCell(mid, entry)) break;
+			if (entry->cell == cell) {
+				found = true;
+				break;
+			}
+			if (entry->cell < cell) lo = mid + 1;
+			else hi = mid;
+		}
+	}
+	if (!found) {
+		entry->cell = cell;
+		entry->pm = 0;
+		entry->co2 = 0;
+	}
+
+	cache[cacheNext] = *entry;
+	cacheFound[cacheNext] = found;
+	cacheNext ^= 1;
+	return found;
+}
+
+bool Hotspots::syncDue() {
+	return !synced || millis() - syncedAt >= HOTSPOT_SYNC_MS;
+}
+
+// Asks the server for the next page after our cursor, reply goes to handle()
+bool Hotspots::request() {
+	char data[32];
+	char cell[HOTSPOT_CELL_CHARS + 1] = "";
+	if (cursorCell != HOTSPOT_NO_CELL) formatCell(cursorCell, cell);
+	snprintf(data, sizeof(data), "%lu,%s", (unsigned long)cursorVersion, cell);
+	return Particle.publish("air-quality-hotspots", data, PRIVATE);
+}
+
+// Page from server: "<more>,<version>" followed by ";<cell>,<pm x10>,<co2>"
+// for each cell, ordered by version and cell. A cell with 0,0 has dropped
+// out of the map. Returns true if more pages follow.
+bool Hotspots::handle(const char *data) {
+	HotspotCell cells[HOTSPOT_PAGE];
+	size_t count = 0;
+
+	char *end;
+	bool more = strtoul(data, &end, 10) != 0;
+	if (*end != ',') return false;
+	uint32_t version = strtoul(end + 1, &end, 10);
+
+	while (*end == ';' && count < HOTSPOT_PAGE) {
+		const char *str = end + 1;
+		const char *comma = strchr(str, ',');
+		uint32_t cell;
+		if (!comma || !parseCell(str, comma - str, &cell)) return false;
+		cells[count].cell = cell;
+		cells[count].pm = strtoul(comma + 1, &end, 10);
+		if (*end != ',') return false;
+		cells[count].co2 = strtoul(end + 1, &end, 10);
+		count++;
+	}
+	if (*end != 0 && *end != '\r' && *end != '\n') return false;
+
+	// Flash is only rewritten when the buffer is full, or at the end
+	if (pendingCount + count > HOTSPOT_MERGE_CELLS && !flush()) return false;
+	for (size_t i = 0; i < count; i++) buffer(cells[i]);
+
+	// Cursor moves to the last cell of the page
+	if (count > 0) cursorCell = cells[count - 1].cell;
+	cursorVersion = version;
+	pages++;
+
+	if (!more) {
+		if (!flush()) return false;
+		synced = true;
+		syncedAt = millis();
+	}
+	return more;
+}
+
+// Into pending, kept sorted by cell. Same cell twice, latest wins.
+void Hotspots::buffer(const HotspotCell &cell) {
+	size_t lo = 0;
+	size_t hi = pendingCount;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (pending[mid].cell < cell.cell) lo = mid + 1;
+		else hi = mid;
+	}
+	if (lo < pendingCount && pending[lo].cell == cell.cell) {
+		pending[lo] = cell;
+		return;
+	}
+	memmove(&pending[lo + 1], &pending[lo], (pendingCount - lo) * sizeof(HotspotCell));
+	pending[lo] = cell;
+	pendingCount++;
+}
+
+// Merges pending cells into the table, with the cursor after them. On
+// failure they are dropped, and fetched again from the table's cursor.
+bool Hotspots::flush() {
+	if (pendingCount == 0 && cursorVersion == header.version && cursorCell == header.lastCell) return true;
+	bool ok = merge(pending, pendingCount, cursorVersion, cursorCell);
+	pendingCount = 0;
+	if (!ok) {
+		cursorVersion = header.version;
+		cursorCell = header.lastCell;
+		return false;
+	}
+	merges++;
+	return true;
+}
+
+// Rewrites table with sorted cells merged in, then swaps it in place of the
+// old one
+bool Hotspots::merge(HotspotCell *cells, size_t count, uint32_t version, uint32_t lastCell) {
+	int out = open(HOTSPOT_TMP_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (out < 0) return false;
+
+	Header h = header;
+	h.version = version;
+	h.lastCell = lastCell;
+	h.count = 0;
+	bool ok = write(out, &h, sizeof(h)) == sizeof(h);
+
+	HotspotCell old;
+	uint32_t index = 0;
+	uint32_t inserted = 0;
+	bool haveOld = fd >= 0 && header.count > 0 && readCell(0, &old);
+	size_t i = 0;
+	while (ok && (haveOld || i < count)) {
+		HotspotCell next;
+		if (i >= count || (haveOld && old.cell < cells[i].cell)) {
+			next = old;
+			haveOld = ++index < header.count && readCell(index, &old);
+		}
+		else {
+			bool update = haveOld && old.cell == cells[i].cell;
+			bool removed = cells[i].pm == 0 && cells[i].co2 == 0;
+			next = cells[i++];
+			if (update) {
+				// Updated cell replaces the old one, or drops it
+				haveOld = ++index < header.count && readCell(index, &old);
+				if (removed) continue;
+			}
+			else if (removed) {
+				continue;
+			}
+			else if (header.count + inserted >= HOTSPOT_MAX_CELLS) {
+				// Full, only existing cells are updated
+				continue;
+			}
+			else {
+				inserted++;
+			}
+		}
+		ok = write(out, &next, sizeof(next)) == sizeof(next);
+		h.count++;
+	}
+
+	// Header last, with final count
+	ok = ok && lseek(out, 0, SEEK_SET) == 0 && write(out, &h, sizeof(h)) == sizeof(h);
+	close(out);
+	if (!ok) {
+		unlink(HOTSPOT_TMP_FILE);
+		return false;
+	}
+
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+	if (rename(HOTSPOT_TMP_FILE, HOTSPOT_FILE) != 0) {
+		unlink(HOTSPOT_TMP_FILE);
+		reopen();
+		return false;
+	}
+	reopen();
+	return true;
+}
+
+uint32_t Hotspots::getVersion() {
+	return header.version;
+}
+
+uint32_t Hotspots::getCount() {
+	return header.count;
+}
+
+size_t Hotspots::summary(char *buf, size_t len) {
+	int n = snprintf(buf, len,
+		"{\"version\":%lu,\"cells\":%lu,\"synced\":%d,\"pages\":%lu,\"merges\":%lu,\"pending\":%u,\"reads\":%lu}",
+		(unsigned long)header.version, (unsigned long)header.count, synced, (unsigned long)pages,
+		(unsigned long)merges, (unsigned)pendingCount, (unsigned long)reads);
+	return n < 0 ? 0 : ((size_t)n < len ? n : len - 1);
+}
+
+// Geohash of position in 1e-7 degrees, bits interleaved starting with
+// longitude. Halving the range n times is the same as taking the first n
+// bits of the position's fraction of the range, which integers do exactly.
+uint32_t Hotspots::cellOf(int32_t latitude, int32_t longitude) {
+	const uint8_t bits = HOTSPOT_CELL_CHARS * 5;
+	const uint8_t lngBits = (bits + 1) / 2;
+	const uint8_t latBits = bits / 2;
+	uint64_t x = ((uint64_t)((int64_t)longitude + 1800000000) << lngBits) / 3600000000ULL;
+	uint64_t y = ((uint64_t)((int64_t)latitude + 900000000) << latBits) / 1800000000ULL;
+	if (x >> lngBits) x = (1UL << lngBits) - 1;		// +180 is in the last cell
+	if (y >> latBits) y = (1UL << latBits) - 1;
+
+	uint32_t cell = 0;
+	for (uint8_t bit = 0; bit < bits; bit++) {
+		cell <<= 1;
+		if (bit % 2 == 0) cell |= (x >> (lngBits - 1 - bit / 2)) & 1;
+		else cell |= (y >> (latBits - 1 - bit / 2)) & 1;
+	}
+	return cell;
+}
+
+bool Hotspots::parseCell(const char *str, size_t len, uint32_t *cell) {
+	if (len != HOTSPOT_CELL_CHARS) return false;
+	uint32_t value = 0;
+	for (size_t i = 0; i < len; i++) {
+		const char *c = strchr(base32, str[i]);
+		if (!c || !*c) return false;
+		value = (value << 5) | (c - base32);
+	}
+	*cell = value;
+	return true;
+}
+
+void Hotspots::formatCell(uint32_t cell, char *str) {
+	for (size_t i = 0; i < HOTSPOT_CELL_CHARS; i++) {
+		str[i] = base32[(cell >> (5 * (HOTSPOT_CELL_CHARS - 1 - i))) & 0x1F];
+	}
+	str[HOTSPOT_CELL_CHARS] = 0;
+}
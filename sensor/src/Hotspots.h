@@ -0,0 +1,77 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Historical pollution levels per geohash cell, kept in flash as a
+			  table sorted by cell for O(log n) lookup. Synced from the server
+			  in pages of cells changed since the last version seen, which
+			  are buffered and merged into the table a few times per sync.
+*/
+
+#ifndef HOTSPOTS_H
+#define HOTSPOTS_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+// Geohash precision, 5 bits per character
+#define HOTSPOT_CELL_CHARS	6
+
+struct __attribute__((packed)) HotspotCell {
+	uint32_t cell;		// Geohash, 5 bits per character
+	uint16_t pm;		// Average of max PM part, 0.1 ug/m3
+	uint16_t co2;		// Average CO2, ppm
+};
+
+class Hotspots {
+	public:
+		Hotspots();
+
+		void begin();
+		bool lookup(uint32_t cell, HotspotCell *entry);
+		bool syncDue();
+		bool request();
+		bool handle(const char *data);
+		uint32_t getVersion();
+		uint32_t getCount();
+
+		size_t summary(char *buf, size_t len);
+
+		static uint32_t cellOf(int32_t latitude, int32_t longitude);
+		static bool parseCell(const char *str, size_t len, uint32_t *cell);
+		static void formatCell(uint32_t cell, char *str);
+
+	private:
+		struct Header {
+			uint32_t magic;
+			uint32_t version;	// Sync cursor: version and cell of last cell received
+			uint32_t lastCell;
+			uint32_t count;
+		};
+
+		bool readCell(uint32_t index, HotspotCell *entry);
+		void buffer(const HotspotCell &cell);
+		bool flush();
+		bool merge(HotspotCell *cells, size_t count, uint32_t version, uint32_t lastCell);
+		void reopen();
+
+		int fd;
+		Header header;
+		HotspotCell cache[2];	// Last cells looked up, the one we're in and the one ahead
+		bool cacheFound[2];
+		uint8_t cacheNext;
+		bool synced;
+		system_tick_t syncedAt;
+		uint32_t pages;
+		uint32_t merges;
+		uint32_t reads;
+
+		// Cells received but not merged yet, sorted by cell, and the sync
+		// cursor after them. The table header has the cursor of what is
+		// in flash, where a sync starts over after a reset.
+		HotspotCell pending[HOTSPOT_MERGE_CELLS];
+		size_t pendingCount;
+		uint32_t cursorVersion;
+		uint32_t cursorCell;
+};
+
+#endif
@@ -5,9 +5,12 @@
 */
 
 #include "Htu31.h"
+#include "Trace.h"
+#include "SensorCrc.h"
 
 Htu31::Htu31() {
-	return;
+	started = false;
+	onTime = 0;
 }
 
 void Htu31::loop() {
@@ -15,20 +18,33 @@ void Htu31::loop() {
 }
 
 void Htu31::on() {
-	// Soft reset = 15 ms
+	// Soft reset = 15 ms, see isReady(). Heater is off after reset, and the
+	// sensor idles between the single conversions started by getSample().
 	uint8_t buf[] = { 0x1E };
 	writeToDevice(buf, 1);
-	delay(15);
+	started = true;
+	onTime = millis();
 }
 
 void Htu31::off() {
     // Stop measurement
+	started = false;
+}
+
+bool Htu31::isReady() {
+	return started && millis() - onTime >= HTU31_RESET_MS;
 }
 
-// Returns samples
-int8_t Htu31::getSample(float_t *th) {
+// Returns temperature in 0.01 C and humidity in 0.01 %RH
+int8_t Htu31::getSample(int16_t *th) {
 	uint8_t buf[6];
 
+	if (!isReady()) {
+		th[0] = 0;
+		th[1] = 0;
+		return -1;
+	}
+
 	// Start conversion
 	buf[0] = 0x40;
 	writeToDevice(buf, 1);
@@ -55,9 +71,9 @@ int8_t Htu31::getSample(float_t *th) {
 		return -1;
 	}
 
-	// Conversion
-	th[0] = -40. + 165. * (float_t)t / 65535.; 	// Temperature: -40 + 165 * t / (2^16 - 1)
-	th[1] = 100. * (float_t)h / 65535;		    // Humidity: 100 * h / (2^16 - 1)
+	// Conversion, rounded
+	th[0] = -4000 + (int16_t)((16500UL * t + 32767) / 65535);	// Temperature: -40 + 165 * t / (2^16 - 1)
+	th[1] = (int16_t)((10000UL * h + 32767) / 65535);			// Humidity: 100 * h / (2^16 - 1)
 	return 0;
 }
 
@@ -81,29 +97,10 @@ uint16_t Htu31::parseSample(uint8_t *buf, size_t offset) {
 	uint16_t result = (buf[offset] << 8) | buf[offset + 1];
 	
 	// Check CRC - return 0 on error
-	if (buf[offset+2] != calcCRC(result)) return 0;
+	if (buf[offset+2] != sensirionCrc8(buf + offset, 2, 0x00)) {
+		TRACE(SENSOR_CRC, HTU31_ADR);
+		return 0;
+	}
 
 	return result;
-}
-
-// CRC for Sensirion SEN50
-uint8_t Htu31::calcCRC(uint16_t pm) {
-	// uint16_t to uint8_t[2] conversion
-	uint8_t data[2];
-	data[0] = (pm >> 8) & 0xFF;
-	data[1] = pm & 0xFF;
-
-	// Calc CRC TODO: Check CRC calculation
-    unsigned char crc = 0x00;
-    for(int i = 0; i < 2; i++) {
-        crc ^= data[i];
-        for (unsigned char bit = 8; bit > 0; --bit) {
-            if(crc & 0x80) {
-                crc = (crc << 1) ^ 0x31u;
-            } else {
-                crc = (crc << 1);
-            }
-        }
-    }
-    return crc;
 }
\ No newline at end of file
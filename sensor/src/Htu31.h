@@ -17,13 +17,16 @@ class Htu31 {
 		void on();
 		void off();
 		void loop();
-		int8_t getSample(float_t *pm);
+		bool isReady();
+		int8_t getSample(int16_t *th);
 
 	private:
+		bool started;
+		system_tick_t onTime;
+
 		void writeToDevice(uint8_t *buf, size_t len);
 		void readFromDevice(uint8_t *buf, size_t len);
 		uint16_t parseSample(uint8_t *buf, size_t offset);
-		uint8_t calcCRC(uint16_t pm);
 };
 
 #endif
@@ -0,0 +1,66 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Queue of samples waiting to be published to cloud
+*/
+
+#include "Journal.h"
+
+Journal::Journal() {
+	head = 0;
+	tail = 0;
+	count = 0;
+	dropped = 0;
+	lastPush = 0;
+	pushInterval = PUBLISH_INTERVAL_MS;
+}
+
+// Adds record, overwriting the oldest one when full
+void Journal::push(const char *record) {
+	system_tick_t now = millis();
+
+	if (count == JOURNAL_SIZE) {
+		tail = (tail + 1) % JOURNAL_SIZE;
+		count--;
+		dropped++;
+	}
+
+	records[head].time = now;
+	strncpy(records[head].data, record, JOURNAL_RECORD_LEN - 1);
+	records[head].data[JOURNAL_RECORD_LEN - 1] = 0;
+	head = (head + 1) % JOURNAL_SIZE;
+	count++;
+
+	// Moving average of push interval, weight 1/4
+	if (lastPush != 0) pushInterval = (3 * pushInterval + (now - lastPush)) / 4;
+	lastPush = now;
+}
+
+// Returns oldest record, or NULL if empty
+const char *Journal::peek() {
+	if (count == 0) return NULL;
+	return records[tail].data;
+}
+
+void Journal::pop() {
+	if (count == 0) return;
+	tail = (tail + 1) % JOURNAL_SIZE;
+	count--;
+}
+
+size_t Journal::depth() {
+	return count;
+}
+
+system_tick_t Journal::oldestAgeMs() {
+	if (count == 0) return 0;
+	return millis() - records[tail].time;
+}
+
+system_tick_t Journal::getPushIntervalMs() {
+	return pushInterval;
+}
+
+uint32_t Journal::getDropped() {
+	return dropped;
+}
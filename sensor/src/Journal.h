@@ -0,0 +1,41 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Queue of samples waiting to be published to cloud
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+class Journal {
+	public:
+		Journal();
+
+		void push(const char *record);
+		const char *peek();
+		void pop();
+		size_t depth();
+		system_tick_t oldestAgeMs();
+		system_tick_t getPushIntervalMs();
+		uint32_t getDropped();
+
+	private:
+		struct Record {
+			system_tick_t time;
+			char data[JOURNAL_RECORD_LEN];
+		};
+		Record records[JOURNAL_SIZE];
+		size_t head;	// Next record to write
+		size_t tail;	// Oldest record
+		size_t count;
+		uint32_t dropped;
+
+		// Average time between pushes
+		system_tick_t lastPush;
+		system_tick_t pushInterval;
+};
+
+#endif
@@ -2,359 +2,727 @@
 	@author:  Thomas Stadel
 	@date:    2024-11-25
 	@brief:   Driver for Queltec L86 GPS module
+
+			  A high priority thread drains the UART into a ring buffer and
+			  frames and parses sentences, so GPS data is never lost while the
+			  main loop is blocked. Fixes are handed to the main thread as
+			  snapshots protected by a sequence lock. The same thread brings
+			  the module up after on(), so reset, baud rate switch and config
+			  never block the main loop.
 */
 
 #include "L86.h"
+#include "Profiler.h"
+#include "Energy.h"
+#include "Trace.h"
+#include "Fixed.h"
+
+#define L86_ASSIST_MAGIC	0x47505331 // "GPS1"
+
+// Fixed commands, checksums computed at compile time
+static constexpr NmeaFixedCommand cmdBaudrate("PMTK251," NMEA_STR(L86_BAUDRATE));
+static constexpr NmeaFixedCommand cmdRmcOnly("PMTK314,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0");
+static constexpr NmeaFixedCommand cmdFixInterval("PMTK220," NMEA_STR(L86_FIX_INTERVAL_MS));
+static constexpr NmeaFixedCommand cmdSlowFixInterval("PMTK220," NMEA_STR(L86_SLOW_FIX_INTERVAL_MS));
+static constexpr NmeaFixedCommand cmdEasy("PMTK869,1,1");
+static constexpr NmeaFixedCommand cmdFull("PMTK225,0");
+static constexpr NmeaFixedCommand cmdAlwaysLocate("PMTK225,8");
+static constexpr NmeaFixedCommand cmdPeriodic("PMTK225,2,"
+	NMEA_STR(L86_PERIODIC_RUN_MS) "," NMEA_STR(L86_PERIODIC_SLEEP_MS) ","
+	NMEA_STR(L86_PERIODIC_RUN_MS) "," NMEA_STR(L86_PERIODIC_SLEEP_MS));
+static constexpr NmeaFixedCommand cmdBackup("PMTK225,4");
+static_assert(cmdBackup.str[11] == '2' && cmdBackup.str[12] == 'F', "$PMTK225,4*2F");
 
 L86::L86() {
-	// Setup GPIOs
+	// Setup GPIOs, module is brought up by the GPS thread after on()
 	pinMode(L86_RESET_PIN, OUTPUT);
 	pinMode(L86_FORCEON_PIN, OUTPUT);
 
 	digitalWrite(L86_RESET_PIN, LOW);
 	digitalWrite(L86_FORCEON_PIN, HIGH);
-	delay(50);
-	
-	// Reset module to make sure we're in correct state
-	reset();
-
-	// Open UART
-	L86_SERIAL.begin(9600);
-	waitFor(L86_SERIAL.isEnabled, 15000);
-	delay(1000);
-
-	String str;
-	if (L86_BAUDRATE != 9600) {
-		// Empty read buffer
-		while (L86_SERIAL.available()) L86_SERIAL.read();
-
-		// Set baudrate of GPS module
-		str = "$PMTK251,";
-		str.concat(L86_BAUDRATE);
-		str.concat("*");
-		str.concat(calcCRC(str));
-		str.concat("\r\n");
-		L86_SERIAL.print(str);
-
-		// Change baudrate of serial
-		L86_SERIAL.flush();
-		L86_SERIAL.end();
-
-		L86_SERIAL.begin(L86_BAUDRATE);
-		waitFor(L86_SERIAL.isEnabled, 15000);
-		delay(1000);
+
+	// Set defaults
+	work.seq = 0;
+	work.valid = -1;
+	work.latitude = 0.;
+	work.longitude = 0.;
+	work.speed = 0.;
+	work.course = 0.;
+	work.odometer = 0.;
+	odometer.reset();
+	work.millis = 0;
+	work.track.valid = false;
+	work.prevTrack.valid = false;
+	work.utcMs = 0;
+	work.lastLatitude = 0.;
+	work.lastLongitude = 0.;
+	work.lastUtcMs = 0;
+	snapshot = work;
+	snapshotSeq = 0;
+	distanceBase = 0.;
+	lastLoggedSeq = 0;
+	sentenceLen = 0;
+
+	uartOverruns = 0;
+	ringOverruns = 0;
+	crcErrors = 0;
+	droppedSentences = 0;
+	uartMaxFill = 0;
+
+	thread = NULL;
+	enabled = false;
+	threadBusy = false;
+	ready = false;
+	configured = false;
+	baudrate = L86_BAUDRATE;
+	boot = BOOT_POWER;
+	bootTime = 0;
+	bootWaitMs = 0;
+
+	lastFix.magic = 0;
+	talked = false;
+	assistLoaded = false;
+	assistPending = false;
+	assistUtcMs = 0;
+	assistMillis = 0;
+	assistRequested = false;
+	onMillis = 0;
+	ttffMs = 0;
+
+	powerMode = GPS_MODE_FULL;
+	powerModeSince = 0;
+	memset(powerModeMs, 0, sizeof(powerModeMs));
+	powerModeRequested = GPS_MODE_FULL;
+	powerModeSent = GPS_MODE_COUNT;
+}
+
+// GPS thread: next bring-up step, once the wait for the current one is over
+void L86::bootStep() {
+	bool talking = (boot == BOOT_UART || boot == BOOT_BAUD) && bootTalking();
+	if (!talking && millis() - bootTime < bootWaitMs) return;
+
+	switch (boot) {
+		case BOOT_POWER:
+			digitalWrite(L86_FORCEON_PIN, HIGH);
+			digitalWrite(L86_RESET_PIN, LOW);
+			bootWait(BOOT_RESET, 50);
+			break;
+
+		case BOOT_RESET:
+			/*
+				Reset module according to datasheet.
+				Ref: https://docs.rs-online.com/1fe5/0900766b8147dbfb.pdf
+
+				Note, that the logic is inverted, because a transistor is
+				used for pulling down the reset pin, according to schematics.
+				Ref: https://github.com/thomasstadel/AirFleet/blob/main/schematics/sensor%20board/AirFleet.kicad_sch
+			*/
+			digitalWrite(L86_FORCEON_PIN, LOW);
+			digitalWrite(L86_RESET_PIN, HIGH);
+			bootWait(BOOT_RELEASE, 15); // > 10ms
+			break;
+
+		case BOOT_RELEASE:
+			digitalWrite(L86_RESET_PIN, LOW);
+			digitalWrite(L86_FORCEON_PIN, HIGH);
+
+			// Open UART, and wait for module to talk after restart
+			L86_SERIAL.begin(9600);
+			sentenceLen = 0;
+			bootWait(BOOT_UART, L86_BOOT_TIMEOUT_MS);
+			break;
+
+		case BOOT_UART:
+			baudrate = 9600;
+			if (L86_BAUDRATE == 9600) {
+				bootWait(BOOT_CONFIG, 0);
+				break;
+			}
+
+			// Empty read buffer
+			while (L86_SERIAL.available()) L86_SERIAL.read();
+
+			// Set baudrate of GPS module
+			sendSentence(cmdBaudrate.c_str());
+
+			// Change baudrate of serial, and wait for module to talk at new rate
+			L86_SERIAL.flush();
+			L86_SERIAL.end();
+			L86_SERIAL.begin(L86_BAUDRATE);
+			sentenceLen = 0;
+			bootWait(BOOT_BAUD, L86_BOOT_TIMEOUT_MS);
+			break;
+
+		case BOOT_BAUD:
+			// No valid sentence at the new rate, so the module most likely
+			// missed the switch. Carry on at 9600, which it still talks.
+			if (talking) {
+				baudrate = L86_BAUDRATE;
+			}
+			else {
+				L86_SERIAL.end();
+				L86_SERIAL.begin(9600);
+#ifdef AIRFLEET_DEBUG
+				Log.warn("GPS baud rate switch failed, staying at 9600");
+#endif
+			}
+			bootWait(BOOT_CONFIG, 0);
+			break;
+
+		case BOOT_CONFIG:
+			// Empty read buffer
+			while (L86_SERIAL.available()) L86_SERIAL.read();
+
+			// Only output RMC, so the UART carries nothing we don't parse
+			sendSentence(cmdRmcOnly.c_str());
+
+			// EASY: module predicts ephemeris up to 3 days ahead from what it
+			// has received, kept with almanac in backup mode
+			sendSentence(cmdEasy.c_str());
+
+			configured = true;
+			bootWait(BOOT_READY, 0);
+			break;
+
+		case BOOT_WAKE:
+			// Force the GPS module on
+			L86_SERIAL.begin(baudrate);
+			digitalWrite(L86_FORCEON_PIN, HIGH);
+			bootWait(BOOT_READY, 0);
+			break;
+
+		case BOOT_READY:
+			break;
 	}
 
-	// Empty read buffer
-	while (L86_SERIAL.available()) L86_SERIAL.read();
+	if (boot == BOOT_READY) {
+		// Mode and fix interval are kept in backup mode, so always sent
+		powerModeSent = GPS_MODE_COUNT;
+		talked = false;
+		sentenceLen = 0;
+		ring.clear();
+		ready = true;
+		profiler.bootMark(BOOT_GPS_READY);
 
-	// Set fixpoint interval
-	str = "$PMTK220,";
-	str.concat(SAMPLE_INTERVAL_MS);
-	str.concat("*");
-	str.concat(calcCRC(str));
-	str.concat("\r\n");
-	L86_SERIAL.print(str);
 #ifdef AIRFLEET_DEBUG
-	Log.info("GPS setting interval: %s", (const char*)str);
+		Log.info("GPS ready");
 #endif
+	}
+}
 
-	// Set defaults
-	gps_valid = -1;
-	gps_latitude = 0.;
-	gps_longitude = 0.;
-	gps_prev_latitude = 0.;
-	gps_prev_longitude = 0.;
-	gps_speed = 0.;
-	gps_distance = 0.;
-	gps_millis = 0;
-	gps_datetime = "0000-00-00 00:00:00";	
-}
-
-void L86::reset() {
-	/*
-		Reset module according to datasheet.
-		Ref: https://docs.rs-online.com/1fe5/0900766b8147dbfb.pdf
-
-		Note, that the logic is inverted, because a transistor is
-		used for pulling down the reset pin, according to schematics.
-		Ref: https://github.com/thomasstadel/AirFleet/blob/main/schematics/sensor%20board/AirFleet.kicad_sch
-	*/
-	digitalWrite(L86_FORCEON_PIN, LOW);
-	digitalWrite(L86_RESET_PIN, LOW);
-	delay(5); // > 2ms
-	digitalWrite(L86_RESET_PIN, HIGH);
-	delay(15); // > 10ms
-	digitalWrite(L86_RESET_PIN, LOW);
-	delay(15); // Make sure module has restarted
+void L86::bootWait(BootStep next, system_tick_t ms) {
+	boot = next;
+	bootTime = millis();
+	bootWaitMs = ms;
 }
 
-void L86::loop() {
-	// Empty serial buffer
-	while (L86_SERIAL.available()) {
-		// Read single character
+// A sentence with a valid checksum, so the module is up at the current
+// baud rate. Bytes alone may be noise or the tail of the old rate.
+bool L86::bootTalking() {
+	while (L86_SERIAL.available() > 0) {
 		char c = (char)L86_SERIAL.read();
-
-		// Start new command
 		if (c == '$') {
-			readBuffer = c;
+			sentence[0] = c;
+			sentenceLen = 1;
+		}
+		else if (c == '\r' || c == '\n') {
+			bool valid = sentenceLen > 0 && nmeaVerify(sentence, sentenceLen);
+			sentenceLen = 0;
+			if (valid) return true;
+		}
+		else if (sentenceLen > 0) {
+			if (sentenceLen < sizeof(sentence)) sentence[sentenceLen++] = c;
+			else sentenceLen = 0;
+		}
+	}
+	return false;
+}
+
+// Main thread: hands current UTC to the GPS thread, if there is a time source.
+// RTC first, as it keeps running in sleep and is set by the cloud.
+bool L86::requestAssist() {
+	uint64_t utcMs = 0;
+	if (Time.isValid()) utcMs = (uint64_t)Time.now() * 1000ULL;
+	else if (timeBase.isSynced()) utcMs = timeBase.now();
+	if (utcMs == 0) return false;
+
+	assistUtcMs = utcMs;
+	assistMillis = millis();
+	assistRequested = true;
+	return true;
+}
+
+// GPS thread: time, and last position if known, so the module can pick
+// satellites from almanac and ephemeris it kept in backup mode
+void L86::sendAssist() {
+	uint64_t utcMs = assistUtcMs + (millis() - assistMillis);
+	int32_t year;
+	uint8_t month, day;
+	uint32_t sec;
+	TimeBase::civil(utcMs, &year, &month, &day, &sec);
+
+	char body[80];
+	snprintf(body, sizeof(body), "PMTK740,%ld,%u,%u,%lu,%lu,%lu", (long)year, (unsigned)month, (unsigned)day,
+		(unsigned long)(sec / 3600), (unsigned long)(sec / 60 % 60), (unsigned long)(sec % 60));
+	sendCommand(body);
+
+	if (lastFix.magic == L86_ASSIST_MAGIC && lastFix.utcMs <= utcMs) {
+		snprintf(body, sizeof(body), "PMTK741,%s,%s,0,%ld,%u,%u,%lu,%lu,%lu",
+			FixedText(lround(lastFix.latitude * 1e6), 6).text, FixedText(lround(lastFix.longitude * 1e6), 6).text,
+			(long)year, (unsigned)month, (unsigned)day,
+			(unsigned long)(sec / 3600), (unsigned long)(sec / 60 % 60), (unsigned long)(sec % 60));
+		sendCommand(body);
+	}
+}
 
-			if (gps_valid == -1) gps_valid = 1;
+// Reads last fix from EEPROM, for first on() after power up
+void L86::loadAssist() {
+	EEPROM.get(L86_EEPROM_ADR, lastFix);
+	if (lastFix.magic != L86_ASSIST_MAGIC) lastFix.magic = 0;
+	assistLoaded = true;
+}
+
+// Last fix from before a reset, used for hot start if it is newer than the
+// one in EEPROM, which is only written at off(). Call while the GPS thread
+// is stopped, before on() or from off().
+void L86::seedFix(double latitude, double longitude, uint64_t utcMs) {
+	if (!assistLoaded) loadAssist();
+	if (utcMs == 0 || (lastFix.magic == L86_ASSIST_MAGIC && lastFix.utcMs >= utcMs)) return;
+	lastFix.latitude = latitude;
+	lastFix.longitude = longitude;
+	lastFix.utcMs = utcMs;
+	lastFix.magic = L86_ASSIST_MAGIC;
+}
+
+// Stores last fix in EEPROM, if it has changed. The GPS thread's last fix
+// is taken from the snapshot, so it is read under the sequence lock.
+void L86::saveAssist() {
+	GpsFix fix;
+	getFix(&fix);
+	seedFix(fix.lastLatitude, fix.lastLongitude, fix.lastUtcMs);
+	if (lastFix.magic != L86_ASSIST_MAGIC) return;
+
+	Assist saved;
+	EEPROM.get(L86_EEPROM_ADR, saved);
+	if (memcmp(&saved, &lastFix, sizeof(saved)) == 0) return;
+	EEPROM.put(L86_EEPROM_ADR, lastFix);
+}
+
+// Sends $<body>*<checksum>, for commands with runtime values
+void L86::sendCommand(const char *body) {
+	char buf[L86_SENTENCE_LEN];
+	if (nmeaCommand(body, buf, sizeof(buf)) == 0) return;
+	sendSentence(buf);
+}
+
+void L86::sendSentence(const char *sentence) {
+	L86_SERIAL.print(sentence);
+
+#ifdef AIRFLEET_TRACE
+	const char *star = strchr(sentence, '*');
+	TRACE(GPS_CMD, strtoul(sentence + 5, NULL, 10), star ? strtoul(star + 1, NULL, 16) : 0);
+#endif
+}
+
+// Main thread: power mode from latest fix, see GpsPowerPolicy
+void L86::updatePowerMode() {
+	GpsFix fix;
+	getFix(&fix);
+	GpsPowerMode mode = powerPolicy.update(fix.valid == 0, fix.speed, millis());
+	if (mode != powerMode) setPowerMode(mode);
+}
+
+// Main thread: books time in current mode, and hands new mode to the GPS thread
+void L86::setPowerMode(GpsPowerMode mode) {
+	system_tick_t now = millis();
+	powerModeMs[powerMode] += now - powerModeSince;
+	powerModeSince = now;
+	powerMode = mode;
+	powerModeRequested = mode;
+	energy.set(ENERGY_GPS, mode);
+	TRACE(GPS_MODE, mode);
+}
+
+// GPS thread
+void L86::sendPowerMode(GpsPowerMode mode) {
+	switch (mode) {
+		case GPS_MODE_FULL:
+			// Standby wakes on the first UART byte, which may be lost
+			sendSentence(cmdFull.c_str());
+			sendSentence(cmdFull.c_str());
+
+			// Set fixpoint interval. Fixes are filtered and interpolated to the
+			// time of each sample, so this is independent of the sample interval.
+			sendSentence(cmdFixInterval.c_str());
+			break;
+
+		case GPS_MODE_ALWAYSLOCATE:
+			sendSentence(cmdSlowFixInterval.c_str());
+			sendSentence(cmdAlwaysLocate.c_str());
+			break;
+
+		case GPS_MODE_PERIODIC:
+			sendSentence(cmdSlowFixInterval.c_str());
+			sendSentence(cmdPeriodic.c_str());
+			break;
+
+		default:
+			break;
+	}
+}
+
+// Main thread: hot start assistance once there is a time source, and traces
+// new fixes. All UART work is done by the GPS thread.
+void L86::loop() {
+	if (assistPending && ttffMs == 0 && requestAssist()) assistPending = false;
+	if (enabled) updatePowerMode();
+
+#ifdef AIRFLEET_TRACE
+	static uint32_t loggedTtffMs = 0;
+	if (ttffMs != 0 && ttffMs != loggedTtffMs) {
+		loggedTtffMs = ttffMs;
+		TRACE(GPS_TTFF, loggedTtffMs);
+	}
+
+	GpsFix fix;
+	getFix(&fix);
+	if (fix.seq == lastLoggedSeq) return;
+	lastLoggedSeq = fix.seq;
+	TRACE(GPS_FIX, fix.valid, fix.latitude, fix.longitude, fix.speed, fix.course);
+#endif
+}
+
+void L86::threadFunction(void *context) {
+	static_cast<L86 *>(context)->threadLoop();
+}
+
+void L86::threadLoop() {
+	system_tick_t lastWake = millis();
+	while (true) {
+		// Busy is set before enabled is read, so once off() has cleared
+		// enabled and seen busy clear, no pass touches the UART
+		threadBusy = true;
+		if (enabled) {
+			if (!ready) {
+				bootStep();
+			}
+			else {
+				uint8_t mode = powerModeRequested;
+				if (mode != powerModeSent) {
+					sendPowerMode((GpsPowerMode)mode);
+					powerModeSent = mode;
+				}
+				// Module is listening once it has sent a valid sentence
+				if (assistRequested && talked) {
+					sendAssist();
+					assistRequested = false;
+				}
+				drainUart();
+				frameSentences();
+			}
 		}
-		
-		// Check for newlines
-		else if (c == '\r') {
-			String str = trim(readBuffer);
-			readBuffer = "";
-
-	#ifdef AIRFLEET_DEBUG
-			Log.info("GPS data: %s", (const char*)str);
-	#endif
-
-			// Check if this is GPS position data
-			// Expected format: $GNRMC,105117.000,A,5626.2207,N,00922.2751,E,0.00,2.02,251124,,,A,V*00
-			if (str.startsWith("$GNRMC,") && str.indexOf("*") > -1) {
-
-				// CRC check
-				if (str.substring(str.length() - 2) == calcCRC(str.substring(0, str.length() - 2))) {
-					// CRC OK
-
-	#ifdef AIRFLEET_DEBUG
-					Log.info("GPS data CRC OK");
-	#endif
-
-					// Build datetime string
-					String date_part = getPart(str, 9);
-					String time_part = getPart(str, 1);
-					if (date_part.length() == 6 && time_part.length() == 10) {
-						// Seems ok
-						gps_datetime = "20"; // TODO: In year 2100, please change this to 21,
-											// and increment this todo. I wont be there to
-											// thank you, so thank you in advance!
-
-						// Date part
-						gps_datetime.concat(date_part.substring(4, 6)); // Year
-						gps_datetime.concat("-");
-						gps_datetime.concat(date_part.substring(2, 4)); // Month
-						gps_datetime.concat("-");
-						gps_datetime.concat(date_part.substring(0, 2)); // Date
-						gps_datetime.concat(" ");
-
-						// Time part
-						gps_datetime.concat(time_part.substring(0, 2)); // Hour
-						gps_datetime.concat(":");
-						gps_datetime.concat(time_part.substring(2, 4)); // Minute
-						gps_datetime.concat(":");
-						gps_datetime.concat(time_part.substring(4, 6)); // Second
-					}
-
-					// Check if data is valid
-					if (getPart(str, 2) == "A") {
-						// Valid data
-
-						// GPS position
-						gps_latitude = calcDecimalDegrees(getPart(str, 3));
-						if (getPart(str, 4) == "S") gps_latitude *= -1;
-						gps_longitude = calcDecimalDegrees(getPart(str, 5));
-						if (getPart(str, 6) == "W") gps_longitude *= -1;
-
-						// Speed - knots to km/t. 1 knot = 1.852 km/t
-						// Ref: https://en.wikipedia.org/wiki/Knot_(unit)
-	#ifdef L86_DEBUG_SPEED	
-						gps_speed = L86_DEBUG_SPEED;
-	#else
-						gps_speed = getPart(str, 7).toFloat() / 1.852;
-	#endif
-
-						// Calculate distance since last sample
-	#ifdef L86_DISTANCE_BY_SPEED
-						// Calculate distance using time delta and speed
-						if (gps_millis > 0) {
-							unsigned long time_delta = millis() - gps_millis;
-							gps_distance += gps_speed / 3600000. * time_delta;
-						}
-	#else
-		#ifdef L86_DISTANCE_BY_HAVERSINE
-						// Calculate distance using Haversine formula
-						if (gps_prev_latitude != 0. && gps_prev_longitude != 0.) {
-
-							/*
-								BEGIN Haversine implementation
-								This code originates from:
-								https://www.geeksforgeeks.org/haversine-formula-to-find-distance-between-two-points-on-a-sphere/
-							*/
-
-							// distance between latitudes and longitudes
-							double_t dLat = (gps_prev_latitude - gps_latitude) * M_PI / 180.0;
-							double_t dLon = (gps_prev_longitude - gps_longitude) * M_PI / 180.0;
-					
-							// convert to radians
-							double_t lat1 = (gps_prev_latitude) * M_PI / 180.0;
-							double_t lat2 = (gps_latitude) * M_PI / 180.0;
-					
-							// apply formulae
-							double_t a = pow(sin(dLat / 2), 2) + 
-									pow(sin(dLon / 2), 2) * 
-									cos(lat1) * cos(lat2);
-							double_t rad = 6371;
-							double_t c = 2 * asin(sqrt(a));
-							gps_distance += (float_t)(rad * c);
-
-							/*
-								END Haversine implementation
-							*/
-						}
-		#endif
-	#endif
-
-						gps_prev_latitude = gps_latitude;
-						gps_prev_longitude = gps_longitude;
-						gps_millis = millis();
-						gps_valid = 0;
-					}
-					else {
-						// No valid GPS position
-						gps_latitude = 0.;
-						gps_longitude = 0.;
-						gps_speed = 0.;
-						gps_valid = 1;
-					}
+		threadBusy = false;
+		os_thread_delay_until(&lastWake, L86_THREAD_PERIOD_MS);
+	}
+}
+
+// Moves everything in the UART RX buffer to the ring
+void L86::drainUart() {
+	int fill = L86_SERIAL.available();
+	if (fill <= 0) return;
+
+	// A full RX buffer means bytes were most likely lost since last drain
+	if (fill > uartMaxFill) uartMaxFill = fill;
+	if (fill >= L86_SERIAL_RX_BUFFER) uartOverruns++;
+
+	uint8_t buf[64];
+	while (fill > 0) {
+		size_t n = 0;
+		while (n < sizeof(buf) && fill > 0) {
+			buf[n++] = (uint8_t)L86_SERIAL.read();
+			fill--;
+		}
+		if (ring.push(buf, n) < n) ringOverruns++;
+		if (fill == 0) fill = L86_SERIAL.available();
+	}
+}
+
+// Cuts ring content into sentences, starting at $ and ending at newline
+void L86::frameSentences() {
+	uint8_t buf[64];
+	size_t n;
+	while ((n = ring.pop(buf, sizeof(buf))) > 0) {
+		for (size_t i = 0; i < n; i++) {
+			char c = (char)buf[i];
+
+			// Start new sentence
+			if (c == '$') {
+				if (sentenceLen > 0) droppedSentences++;
+				sentence[0] = c;
+				sentenceLen = 1;
+				if (work.valid == -1) work.valid = 1;
+			}
+
+			// End of sentence
+			else if (c == '\r' || c == '\n') {
+				if (sentenceLen > 0) processSentence(sentence, sentenceLen);
+				sentenceLen = 0;
+
+				// Keep UART drained while parsing
+				drainUart();
+			}
+
+			// Append, drop sentences that are too long
+			else if (sentenceLen > 0) {
+				if (sentenceLen < sizeof(sentence)) {
+					sentence[sentenceLen++] = c;
 				}
 				else {
-					// CRC error
-	#ifdef AIRFLEET_DEBUG				
-					Log.error("CRC error reading from GPS-module. Got CRC: %s, calculated CRC: %s",
-						(const char*)str.substring(str.length() - 2),
-						(const char*)calcCRC(str.substring(0, str.length() - 2)));
-	#endif
+					droppedSentences++;
+					sentenceLen = 0;
 				}
 			}
 		}
+	}
+}
+
+void L86::processSentence(const char *str, size_t len) {
+	// Check if this is GPS position data
+	if (len < 7 || memcmp(str + 3, "RMC,", 4) != 0) return;
+
+	// CRC check
+	if (!nmeaVerify(str, len)) {
+		crcErrors++;
+		droppedSentences++;
+		TRACE(GPS_CRC, (uint32_t)crcErrors);
+		return;
+	}
+	talked = true;
 
-		// Append to buffer
-		else  {
-			readBuffer.concat(c);
+	NmeaRmc rmc;
+	if (!nmeaParseRmc(str, len, &rmc)) {
+		droppedSentences++;
+		return;
+	}
+
+	// Time of fix in millis(). GPS time disciplines the time base, which
+	// then tells when the fix was taken.
+	system_tick_t now = millis();
+	system_tick_t fixMillis = now - L86_FIX_LATENCY_MS;
+	work.utcMs = rmc.utcMs;
+	if (rmc.valid && rmc.utcMs != 0) {
+		timeBase.discipline(rmc.utcMs, now);
+		fixMillis = timeBase.toMillis(rmc.utcMs);
+	}
+
+	if (rmc.valid) {
+		work.latitude = rmc.latitude;
+		work.longitude = rmc.longitude;
+#ifdef L86_DEBUG_SPEED	
+		work.speed = L86_DEBUG_SPEED;
+#else
+		work.speed = rmc.speed;
+#endif
+		work.course = rmc.course;
+
+		// Distance since last fix
+		odometer.add(work.latitude, work.longitude, work.speed, fixMillis);
+		work.odometer = odometer.getKm();
+
+		// Filter, stamped with the time the fix was taken
+		filter.update(work.latitude, work.longitude, work.speed, work.course, fixMillis);
+		work.track = filter.getTrack();
+		work.prevTrack = filter.getPrevTrack();
+
+		work.valid = 0;
+
+		// Saved at off(), for hot start next time
+		if (rmc.utcMs != 0) {
+			work.lastLatitude = rmc.latitude;
+			work.lastLongitude = rmc.longitude;
+			work.lastUtcMs = rmc.utcMs;
+		}
+
+		// Time to first fix since on()
+		if (ttffMs == 0) {
+			uint32_t ms = now - onMillis;
+			ttffMs = ms == 0 ? 1 : ms;
+			profiler.bootMark(BOOT_GPS_FIX);
 		}
 	}
+	else {
+		// No valid GPS position
+		work.latitude = 0.;
+		work.longitude = 0.;
+		work.speed = 0.;
+		work.course = 0.;
+		work.valid = 1;
+		odometer.pause();
+		filter.reset();
+		work.track.valid = false;
+		work.prevTrack.valid = false;
+	}
+
+	work.millis = fixMillis;
+	work.seq++;
+	publishFix(&work);
+}
+
+// Sequence lock writer: odd sequence while snapshot is being written
+void L86::publishFix(const GpsFix *fix) {
+	uint32_t seq = snapshotSeq.load(std::memory_order_relaxed);
+	snapshotSeq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	snapshot = *fix;
+	std::atomic_thread_fence(std::memory_order_release);
+	snapshotSeq.store(seq + 2, std::memory_order_release);
 }
 
+// Sequence lock reader: copy until we get a copy that was not written meanwhile
+void L86::getFix(GpsFix *fix) {
+	uint32_t seq;
+	do {
+		seq = snapshotSeq.load(std::memory_order_acquire);
+		if (seq & 1) continue;
+		*fix = snapshot;
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((seq & 1) || seq != snapshotSeq.load(std::memory_order_relaxed));
+}
+
+// Filtered position at millis in 1e-7 degrees, interpolated between fixes.
+// Returns false when there is no valid position.
+bool L86::getPosition(system_tick_t millis, int32_t *latitude, int32_t *longitude) {
+	GpsFix fix;
+	getFix(&fix);
+	if (fix.valid != 0) return false;
+	double lat, lng;
+	if (!GpsFilter::positionAt(fix.prevTrack, fix.track, millis, &lat, &lng)) return false;
+	*latitude = toFixed(lat);
+	*longitude = toFixed(lng);
+	return true;
+}
+
+// Degrees to 1e-7 degrees. The GPS thread works in double, samples don't.
+int32_t L86::toFixed(double degrees) {
+	return (int32_t)lround(degrees * 1e7);
+}
+
+// Returns at once, the GPS thread brings the module up
 void L86::on() {
-	// Empty readbuffer
-	readBuffer = "";
-
-	// Make sure serial is enabled
-	if (!L86_SERIAL.isEnabled()) {
-		L86_SERIAL.begin(L86_BAUDRATE);
-		waitFor(L86_SERIAL.isEnabled, 5000);
-		delay(1000);
+	ready = false;
+	bootWait(configured ? BOOT_WAKE : BOOT_POWER, 0);
+
+	// Hot start assistance, sent when module is ready. Without a time source
+	// yet, loop() retries, e.g. when cloud time arrives.
+	if (!assistLoaded) loadAssist();
+	onMillis = millis();
+	ttffMs = 0;
+	assistPending = !requestAssist();
+
+	// Module wakes in full tracking
+	powerMode = GPS_MODE_FULL;
+	powerModeRequested = GPS_MODE_FULL;
+	powerModeSince = onMillis;
+	powerPolicy.reset(onMillis);
+	energy.set(ENERGY_GPS, ENERGY_GPS_FULL);
+
+	// Start GPS thread
+	enabled = true;
+	if (thread == NULL) {
+		thread = new Thread("gps", threadFunction, this, L86_THREAD_PRIORITY, L86_THREAD_STACK_SIZE);
 	}
-
-	// Force the GPS module on
-	digitalWrite(L86_FORCEON_PIN, HIGH);
-	delay(50);
 }
 
 void L86::off() {
-	// Send GPS module to backup mode
+	// Stop GPS thread from touching UART, and wait for it to finish current pass
+	enabled = false;
+	while (threadBusy) delay(1);
+
+	// Send GPS module to backup mode. If it was turned off halfway through
+	// bring-up, the baud rate is unknown, so start over with a reset next time.
+	if (!ready) configured = false;
+	ready = false;
+	powerModeMs[powerMode] += millis() - powerModeSince;
+	energy.set(ENERGY_GPS, ENERGY_GPS_BACKUP);
 	digitalWrite(L86_FORCEON_PIN, LOW);
 	delay(10);
-	L86_SERIAL.println("$PMTK225,4*2F");
+	L86_SERIAL.print(cmdBackup.c_str());
 	L86_SERIAL.flush();
 	delay(10);
 	L86_SERIAL.end();
+
+	saveAssist();
 }
 
-void L86::reset_distance() {
-	gps_distance = 0.;
+// True when module is configured and the thread is reading sentences
+bool L86::isReady() {
+	return ready;
 }
 
-// Returns:
-//   0 on valid position
-//   1 on no valid position
-//  -1 if no data from module
-// Data contains: [latitude, longitude, speed km/t, traveled distance in km]
-// Datetime format: yyyy-mm-dd hh:mm:ss
-int8_t L86::getSample(float_t *data, String *datetime) {
-	data[0] = gps_latitude;
-	data[1] = gps_longitude;
-	data[2] = gps_speed;
-	data[3] = gps_distance;
-
-	*datetime = gps_datetime;
-
-	return gps_valid;
-}
-
-// Returns part of string separated by comma
-String L86::getPart(String str, int part) {
-	int curpart = 0;
-	int offset = 0;
-	int idx = 0;
-	while (idx > -1 && (unsigned int)offset < str.length()) {
-		idx = str.indexOf(',', offset);
-		if (curpart == part) {
-			if (idx == -1) return str.substring(offset);
-			return str.substring(offset, idx);
-		}
-		offset = idx + 1;
-		curpart++;
-	}
-	return "";
+// Time to first fix since on(), 0 until there is a fix
+uint32_t L86::getTtffMs() {
+	return ttffMs;
+}
+
+GpsPowerMode L86::getPowerMode() {
+	return powerMode;
 }
 
-float_t L86::calcDecimalDegrees(String str) {
-    // Expected format: DDDMM.MMMM or DDMM.MMMM
+// {"mode":n,"ttff":ms,"ms":[full,alwayslocate,periodic]}, energy is in the ledger
+size_t L86::summary(char *buf, size_t len) {
+	uint32_t ms[GPS_MODE_COUNT];
+	memcpy(ms, powerModeMs, sizeof(ms));
+	if (enabled) ms[powerMode] += millis() - powerModeSince;
 
-    // Find .
-    size_t pos = str.indexOf(".");
-    if (pos == std::string::npos) return 0.;
+	int n = snprintf(buf, len, "{\"mode\":%d,\"ttff\":%lu,\"ms\":[%lu,%lu,%lu]}",
+		powerMode, (uint32_t)ttffMs, ms[0], ms[1], ms[2]);
+	return n < 0 ? 0 : ((size_t)n < len ? n : len - 1);
+}
 
-    // Get degrees
-    String degStr = str.substring(0, pos - 2);
-    float_t deg = degStr.toFloat();
-    
-    // Get minutes
-    String minStr = str.substring(pos - 2);
-    float_t min = minStr.toFloat();
+void L86::reset_distance() {
+	GpsFix fix;
+	getFix(&fix);
+	distanceBase = fix.odometer;
+}
 
-    // Return degrees
-    return deg + min / 60.;
+// Times the UART RX buffer was found full
+uint32_t L86::getUartOverruns() {
+	return uartOverruns;
 }
 
-String L86::trim(String str) {
-	// Whitespaces to remove
-	String whitespaces = "\r\n\t";
-	// Remove at beginning
-	while (str.length() > 0 && whitespaces.indexOf(str.charAt(0)) > -1) {
-		str = str.substring(1);
-	}
-	// Remove at end
-	while (str.length() > 0 && whitespaces.indexOf(str.charAt(str.length() - 1)) > -1) {
-		str = str.substring(0, str.length() - 1);
-	}
-	return str;
+// Times bytes were lost because the ring was full
+uint32_t L86::getRingOverruns() {
+	return ringOverruns;
 }
 
-String L86::appendCRC(String str) {
-	str.concat(calcCRC(str));
-	return str;
+// Sentences dropped due to CRC errors
+uint32_t L86::getCrcErrors() {
+	return crcErrors;
 }
 
-// $GNRMC,135030.000,A,5626.2161,N,00922.2802,E,0.00,294.78,261124,,,A35030.000,5626.2161,N,00922.2802,E,1,14,0.69,7.4,M,43.1,M,,*65
+// Sentences dropped due to CRC errors, truncation or bad format
+uint32_t L86::getDroppedSentences() {
+	return droppedSentences;
+}
 
-String L86::calcCRC(String str) {
-	if (!str.startsWith("$") || !str.endsWith("*")) return "";
+// Highest UART RX buffer fill seen
+uint16_t L86::getUartMaxFill() {
+	return uartMaxFill;
+}
 
-	String substr = str.substring(1, str.length() - 1);
-	if (substr.length() == 0) return "";
+// Returns:
+//   0 on valid position
+//   1 on no valid position
+//  -1 if no data from module
+// Timestamps come from the time base
+int8_t L86::getSample(GpsSample *sample) {
+	GpsFix fix;
+	getFix(&fix);
 
-#ifdef AIRFLEET_DEBUG
-	Log.info("Calculating CRC value of: %s", (const char*)substr);
-#endif
+	sample->latitude = toFixed(fix.latitude);
+	sample->longitude = toFixed(fix.longitude);
+	sample->speed = (uint16_t)lroundf(fix.speed * 10);
+	sample->meters = (uint32_t)lround((fix.odometer - distanceBase) * 1000);
 
-	uint8_t crc = substr.charAt(0);
-	for (size_t i = 1; i < substr.length(); i++) {
-		crc = crc ^ substr.charAt(i);
-	}
-	return String::format("%02X", crc);
-}
\ No newline at end of file
+	return fix.valid;
+}
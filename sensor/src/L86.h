@@ -10,6 +10,41 @@
 
 #include "Particle.h"
 #include "Settings.h"
+#include "Text.h"
+#include "Nmea.h"
+#include "ByteRing.h"
+#include "GpsFilter.h"
+#include "Distance.h"
+#include "TimeBase.h"
+#include "GpsPower.h"
+
+#include <atomic>
+
+// Snapshot of last fix, written by GPS thread only
+struct GpsFix {
+	uint32_t seq;			// Incremented on every RMC sentence
+	int8_t valid;			// 0 = valid position, 1 = no position, -1 = no data
+	double latitude;
+	double longitude;
+	float speed;			// km/t
+	float course;
+	double odometer;		// km travelled since on()
+	system_tick_t millis;	// Time of fix
+	uint64_t utcMs;			// GPS time of fix, 0 if unknown
+	GpsTrack track;			// Filtered position at latest fix
+	GpsTrack prevTrack;		// Filtered position at fix before that
+	double lastLatitude;	// Last valid position with GPS time, kept without a fix
+	double lastLongitude;
+	uint64_t lastUtcMs;		// 0 until the first one
+};
+
+// Fix as fixed point, for samples
+struct GpsSample {
+	int32_t latitude;		// 1e-7 degrees, about 1 cm
+	int32_t longitude;
+	uint16_t speed;			// 0.1 km/t
+	uint32_t meters;		// Travelled since reset_distance()
+};
 
 class L86 {
 	public:
@@ -18,29 +53,117 @@ class L86 {
 		void on();
 		void off();
 		void loop();
-		int8_t getSample(float_t *data, String *datetime);
+		bool isReady();
+		uint32_t getTtffMs();
+		GpsPowerMode getPowerMode();
+		size_t summary(char *buf, size_t len);
+		int8_t getSample(GpsSample *sample);
+		void getFix(GpsFix *fix);
+		void seedFix(double latitude, double longitude, uint64_t utcMs);
+		bool getPosition(system_tick_t millis, int32_t *latitude, int32_t *longitude);
+		static int32_t toFixed(double degrees);
 		void reset_distance();
+		uint32_t getUartOverruns();
+		uint32_t getRingOverruns();
+		uint32_t getCrcErrors();
+		uint32_t getDroppedSentences();
+		uint16_t getUartMaxFill();
 
 	private:
-		void writeToDevice(uint8_t *buf, size_t len);
-		void readFromDevice(uint8_t *buf, size_t len);
-		uint16_t parseSample(uint8_t *buf, size_t offset);
-		String appendCRC(String str);
-		String calcCRC(String str);
-		String trim(String str);
-		String getPart(String str, int part);
-		String readBuffer;
-		double_t gps_latitude;
-		double_t gps_longitude;
-		double_t gps_prev_latitude;
-		double_t gps_prev_longitude;
-		float_t gps_speed;
-		float_t gps_distance;
-		uint8_t gps_valid;
-		unsigned long gps_millis;
-		String gps_datetime;
-		float_t calcDecimalDegrees(String str);
-		void reset();
+		// Bring-up steps, run by the GPS thread so on() never blocks
+		enum BootStep {
+			BOOT_POWER,		// Force on, before reset pulse
+			BOOT_RESET,		// Reset asserted
+			BOOT_RELEASE,	// Reset released, module restarting
+			BOOT_UART,		// Module talking at 9600 baud
+			BOOT_BAUD,		// Module talking at L86_BAUDRATE, or back to 9600
+			BOOT_CONFIG,	// Sentences and fix interval
+			BOOT_WAKE,		// From backup mode, module keeps its config
+			BOOT_READY
+		};
+
+		// Last fix, injected with current time at wake for a hot start
+		struct Assist {
+			uint32_t magic;
+			double latitude;
+			double longitude;
+			uint64_t utcMs;		// Time of fix
+		};
+
+		void bootStep();
+		void bootWait(BootStep next, system_tick_t ms);
+		bool bootTalking();
+		bool requestAssist();
+		void sendAssist();
+		void loadAssist();
+		void saveAssist();
+		void updatePowerMode();
+		void setPowerMode(GpsPowerMode mode);
+		void sendPowerMode(GpsPowerMode mode);
+		void sendCommand(const char *body);
+		void sendSentence(const char *sentence);
+
+		// GPS thread
+		static void threadFunction(void *context);
+		void threadLoop();
+		void drainUart();
+		void frameSentences();
+		void processSentence(const char *sentence, size_t len);
+		void publishFix(const GpsFix *fix);
+
+		Thread *thread;
+		std::atomic<bool> enabled;
+		std::atomic<bool> threadBusy;	// Set by GPS thread around each pass, see off()
+		std::atomic<bool> ready;
+		bool configured;		// Module config survives backup mode, so only sent once
+		uint32_t baudrate;		// UART rate the module was left at
+		BootStep boot;
+		system_tick_t bootTime;
+		system_tick_t bootWaitMs;
+		ByteRing<L86_RING_SIZE> ring;
+		char sentence[L86_SENTENCE_LEN];
+		size_t sentenceLen;
+
+		// Thread private fix, published to snapshot with a sequence lock
+		GpsFilter filter;
+		Odometer odometer;
+		GpsFix work;
+		GpsFix snapshot;
+		std::atomic<uint32_t> snapshotSeq;
+
+		// Distance at last reset_distance()
+		double distanceBase;
+
+		// Hot start assistance. Current time is handed to the GPS thread,
+		// which sends it with the last fix once the module is ready.
+		Assist lastFix;				// Main thread, read by GPS thread while running
+		bool talked;				// GPS thread: valid sentence since ready
+		bool assistLoaded;
+		bool assistPending;			// Main thread: waiting for a time source
+		uint64_t assistUtcMs;
+		system_tick_t assistMillis;
+		std::atomic<bool> assistRequested;
+		system_tick_t onMillis;
+		std::atomic<uint32_t> ttffMs;
+
+		// Power mode, chosen by main thread and sent by GPS thread. Time in
+		// each mode is kept for the current draw estimate.
+		GpsPowerPolicy powerPolicy;
+		GpsPowerMode powerMode;
+		system_tick_t powerModeSince;
+		uint32_t powerModeMs[GPS_MODE_COUNT];
+		std::atomic<uint8_t> powerModeRequested;
+		uint8_t powerModeSent;
+
+		// Main thread only, for debug logging
+		uint32_t lastLoggedSeq;
+
+		// Counters, written by GPS thread
+		std::atomic<uint32_t> uartOverruns;
+		std::atomic<uint32_t> ringOverruns;
+		std::atomic<uint32_t> crcErrors;
+		std::atomic<uint32_t> droppedSentences;
+		std::atomic<uint16_t> uartMaxFill;
 };
 
 #endif
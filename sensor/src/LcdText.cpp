@@ -0,0 +1,47 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Text for the 20x4 BLE LCD
+*/
+
+#include "LcdText.h"
+
+// Scale of val between minval and maxval, with prev marked, e.g.:
+// [---    |    ]
+void lcdScale(LcdLine *scale, float val, float minval, float maxval, float prev, uint8_t width) {
+	scale->append('[');
+	int8_t val_i = (int8_t)((val - minval) / (maxval - minval) * (float)(width - 2));
+	if (val_i < 0) val_i = 0;
+	if (val_i > width - 3) val_i = width - 3;
+	int8_t prev_i = (int8_t)((prev - minval) / (maxval - minval) * (float)(width - 2));
+	if (prev_i < 0) prev_i = 0;
+	if (prev_i > width - 3) prev_i = width - 3;
+	for (uint8_t i = 0; i < width - 2; i++) {
+		if (val_i >= i && prev_i == i) {
+			scale->append('+');
+		}
+		else if (val_i >= i) {
+			scale->append('-');
+		}
+		else if (prev_i == i) {
+			scale->append('|');
+		}
+		else {
+			scale->append(' ');
+		}
+	}
+	scale->append(']');
+}
+
+// Writes text into frame at pos, returns the number of characters that
+// changed. Nothing needs sending when it is 0.
+size_t lcdUpdate(uint8_t *frame, size_t pos, const uint8_t *text, size_t len) {
+	size_t changes = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (frame[pos + i] != text[i]) {
+			changes++;
+			frame[pos + i] = text[i];
+		}
+	}
+	return changes;
+}
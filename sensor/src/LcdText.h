@@ -0,0 +1,26 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Text for the 20x4 BLE LCD: lines, the level scale and the diff
+			  against what the display shows. No BLE here, so host tools
+			  can build it.
+*/
+
+#ifndef LCD_TEXT_H
+#define LCD_TEXT_H
+
+#include "Particle.h"
+#include "Text.h"
+
+// One line on the 20x4 LCD
+#define BLE_LCD_WIDTH	20
+typedef Text<BLE_LCD_WIDTH> LcdLine;
+
+// Frame as kept across resets: all 4 lines, and the flash command with one line of text
+#define BLE_LCD_FRAME_LEN	(BLE_LCD_WIDTH * 4)
+#define BLE_LCD_FLASH_LEN	(4 + BLE_LCD_WIDTH)
+
+void lcdScale(LcdLine *scale, float val, float minval, float maxval, float prev, uint8_t width);
+size_t lcdUpdate(uint8_t *frame, size_t pos, const uint8_t *text, size_t len);
+
+#endif
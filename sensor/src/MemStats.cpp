@@ -0,0 +1,71 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Heap usage, fragmentation and free memory watermark
+*/
+
+#include "MemStats.h"
+
+#include <malloc.h>
+
+MemStats::MemStats() {
+	freeMemory = 0;
+	freeMin = UINT32_MAX;
+	heapUsed = 0;
+	heapMax = 0;
+	heapFree = 0;
+	heapArena = 0;
+	heapUsedBegin = 0;
+	growthCount = 0;
+	growthBytes = 0;
+}
+
+void MemStats::update() {
+	struct mallinfo mi = mallinfo();
+	heapArena = mi.arena;
+	heapUsed = mi.uordblks;
+	heapFree = mi.fordblks;
+	if (heapUsed > heapMax) heapMax = heapUsed;
+
+	freeMemory = System.freeMemory();
+	if (freeMemory < freeMin) freeMin = freeMemory;
+}
+
+// Call before a code path, which should not allocate in steady state
+void MemStats::begin() {
+	update();
+	heapUsedBegin = heapUsed;
+}
+
+// Call after the code path, counts if the heap grew in between
+void MemStats::end() {
+	update();
+	if (heapUsed > heapUsedBegin) {
+		growthCount++;
+		growthBytes = heapUsed - heapUsedBegin;
+	}
+}
+
+void MemStats::log() {
+	Log.info("MEM free: %lu (min %lu), heap used: %lu (max %lu), arena: %lu, holes: %lu (%u%%), grew: %lu times (last %lu bytes)",
+		freeMemory, freeMin, heapUsed, heapMax, heapArena, heapFree, getFragmentation(),
+		growthCount, growthBytes);
+}
+
+uint32_t MemStats::getFreeMin() {
+	return freeMin;
+}
+
+uint32_t MemStats::getHeapMax() {
+	return heapMax;
+}
+
+uint32_t MemStats::getGrowthCount() {
+	return growthCount;
+}
+
+// Free bytes trapped in holes inside the heap arena, in percent of the arena
+uint8_t MemStats::getFragmentation() {
+	if (heapArena == 0) return 0;
+	return (uint8_t)((uint64_t)heapFree * 100 / heapArena);
+}
@@ -0,0 +1,40 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Heap usage, fragmentation and free memory watermark
+*/
+
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+class MemStats {
+	public:
+		MemStats();
+
+		void begin();
+		void end();
+		void log();
+
+		uint32_t getFreeMin();
+		uint32_t getHeapMax();
+		uint32_t getGrowthCount();
+		uint8_t getFragmentation();
+
+	private:
+		void update();
+
+		uint32_t freeMemory;		// Free memory right now
+		uint32_t freeMin;			// Lowest free memory seen
+		uint32_t heapUsed;			// Allocated bytes in heap arena
+		uint32_t heapMax;			// Highest allocated bytes seen
+		uint32_t heapFree;			// Free bytes inside heap arena (holes)
+		uint32_t heapArena;			// Total heap arena size
+		uint32_t heapUsedBegin;		// Allocated bytes at begin()
+		uint32_t growthCount;		// Number of begin()/end() periods where heap grew
+		uint32_t growthBytes;		// Bytes heap grew by in last such period
+};
+
+#endif
@@ -5,19 +5,41 @@
 */
 
 #include "Mics.h"
+#include "Trace.h"
+#include "SensorCrc.h"
 
 Mics::Mics() {
+	started = false;
+	answered = false;
+	warm = false;
 }
 
 void Mics::loop() {
 }
 
+// The module has no sleep command and no power switch on this board, so
+// on() and off() only track when readings are in use
 void Mics::on() {
-	// TODO: figure out how to put to sleep
+	started = true;
+	answered = false;
 }
 
 void Mics::off() {
-	// TODO: figure out how to wake up
+	started = false;
+}
+
+// Ready once the module has answered a status request with a valid
+// checksum, which the sample timer sends whether or not it is ready
+bool Mics::isReady() {
+	return started && answered;
+}
+
+// The heater is powered with the board and stays on through sleep, and
+// millis() keeps counting in ULP sleep, so warm-up counts from reset. Kept
+// once reached, so a millis() wrap doesn't start it over.
+bool Mics::isSettled() {
+	if (!warm && millis() >= MICS_WARMUP_MS) warm = true;
+	return warm;
 }
 
 // Returns samples
@@ -30,7 +52,7 @@ int8_t Mics::getSample(uint16_t *cv) {
 	buf[2] = 0x00;
 	buf[3] = 0x00;
 	buf[4] = 0x00;
-	buf[5] = calcCRC(buf, 5);
+	buf[5] = micsChecksum(buf, 5);
 	writeToDevice(buf, 6);
 	delay(100);
 
@@ -38,7 +60,11 @@ int8_t Mics::getSample(uint16_t *cv) {
 	readFromDevice(buf, 7);
 
 	// Check CRC
-	if (buf[6] != calcCRC(buf, 6)) return -1;
+	if (buf[6] != micsChecksum(buf, 6)) {
+		TRACE(SENSOR_CRC, MICS_ADR);
+		return -1;
+	}
+	answered = true;
 
 	// Conversion
 	cv[0] = ((uint16_t)buf[0] - 13) * 1000/229; 	  // VOC
@@ -61,26 +87,3 @@ void Mics::readFromDevice(uint8_t *buf, size_t len) {
 		i++;
 	}
 }
-
-/*
-    CRC-function for MiCS sensor
-    https://www.sgxsensortech.com/content/uploads/2017/03/I2C-Datasheet-MiCS-VZ-89TE-rev-H-ed170214-Read-Only.pdf
-*/
-uint8_t Mics::calcCRC(uint8_t *buffer, size_t size) {
-    /* Local variable */
-    uint8_t crc = 0x00;
-    uint8_t i = 0x00;
-    uint16_t sum = 0x0000;
-
-    /* Summation with carry */
-    for(i = 0; i < size; i++) {
-        sum += (uint16_t)buffer[i];
-    }
-
-    crc = (uint8_t)sum;
-    crc += (sum / 0x0100); // Add with carry
-    crc = 0xFF-crc; // Complement
-    
-    /* Returning results*/
-    return crc;
-}
\ No newline at end of file
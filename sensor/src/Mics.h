@@ -20,13 +20,18 @@ class Mics {
 		void on();
 		void off();
 		void loop();
+		bool isReady();
+		bool isSettled();
 		int8_t getSample(uint16_t *pm);
 
 	private:
+		bool started;
+		bool answered;			// Valid status since on()
+		bool warm;				// Heater warmed up since reset
+
 		void writeToDevice(uint8_t *buf, size_t len);
 		void readFromDevice(uint8_t *buf, size_t len);
 		uint16_t parseSample(uint8_t *buf, size_t offset);
-		uint8_t calcCRC(uint8_t *buffer, size_t size);
 };
 
 #endif
@@ -0,0 +1,179 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   NMEA 0183 sentence helpers working on char buffers
+*/
+
+#include "Nmea.h"
+#include "TimeBase.h"
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+// XOR of all characters
+uint8_t nmeaChecksum(const char *str, size_t len) {
+	uint8_t crc = 0;
+	for (size_t i = 0; i < len; i++) crc ^= (uint8_t)str[i];
+	return crc;
+}
+
+// Checks format $<data>*HH and that HH matches checksum of <data>
+bool nmeaVerify(const char *sentence, size_t len) {
+	if (len < 4 || sentence[0] != '$' || sentence[len - 3] != '*') return false;
+
+	uint8_t crc = nmeaChecksum(sentence + 1, len - 4);
+	return sentence[len - 2] == hexDigits[crc >> 4] && sentence[len - 1] == hexDigits[crc & 0x0F];
+}
+
+// Returns field at index (0 = sentence id), separated by comma. The
+// checksum is not part of the last field.
+bool nmeaField(const char *sentence, size_t len, uint8_t index, TextSpan *field) {
+	size_t start = 0;
+	uint8_t cur = 0;
+	for (size_t i = 0; i <= len; i++) {
+		if (i == len || sentence[i] == ',' || sentence[i] == '*') {
+			if (cur == index) {
+				*field = TextSpan(sentence + start, i - start);
+				return true;
+			}
+			if (i == len || sentence[i] == '*') break;
+			cur++;
+			start = i + 1;
+		}
+	}
+	*field = TextSpan();
+	return false;
+}
+
+// Parses [-]digits[.digits] into mantissa and number of decimals
+bool nmeaDecimal(TextSpan field, int32_t *mantissa, uint8_t *decimals) {
+	int32_t m = 0;
+	uint8_t d = 0;
+	bool dot = false;
+	bool neg = false;
+	bool digits = false;
+	for (size_t i = 0; i < field.len; i++) {
+		char c = field.data[i];
+		if (i == 0 && c == '-') {
+			neg = true;
+		}
+		else if (c == '.' && !dot) {
+			dot = true;
+		}
+		else if (c >= '0' && c <= '9') {
+			// Ignore digits beyond what fits
+			if (m > 200000000) continue;
+			m = m * 10 + (c - '0');
+			if (dot) d++;
+			digits = true;
+		}
+		else {
+			return false;
+		}
+	}
+	*mantissa = neg ? -m : m;
+	*decimals = d;
+	return digits;
+}
+
+// Expected format: DDDMM.MMMM or DDMM.MMMM
+double nmeaDegrees(TextSpan field) {
+	int32_t m;
+	uint8_t d;
+	if (!nmeaDecimal(field, &m, &d)) return 0.;
+
+	// Split DDMM.MMMM into degrees and minutes
+	int32_t scale = 1;
+	for (uint8_t i = 0; i < d; i++) scale *= 10;
+	int32_t deg = m / (scale * 100);
+	int32_t min = m - deg * scale * 100;
+	return deg + (double)min / scale / 60.;
+}
+
+float nmeaFloat(TextSpan field) {
+	int32_t m;
+	uint8_t d;
+	if (!nmeaDecimal(field, &m, &d)) return 0.;
+
+	float val = m;
+	while (d-- > 0) val /= 10.;
+	return val;
+}
+
+// Expected format: $GNRMC,105117.000,A,5626.2207,N,00922.2751,E,0.00,2.02,251124,,,A,V*00
+// Sentence must be verified first
+bool nmeaParseRmc(const char *sentence, size_t len, NmeaRmc *rmc) {
+	TextSpan f;
+	if (!nmeaField(sentence, len, 0, &f) || f.len < 6 || memcmp(f.data + 3, "RMC", 3) != 0) return false;
+
+	// Date and time
+	TextSpan date, time;
+	nmeaField(sentence, len, 9, &date);
+	nmeaField(sentence, len, 1, &time);
+	rmc->timeOfDayMs = 0;
+	rmc->utcMs = 0;
+	int32_t m, dmy;
+	uint8_t d, dd;
+	if (date.len == 6 && time.len >= 6 && nmeaDecimal(time, &m, &d) && nmeaDecimal(date, &dmy, &dd)) {
+		// Time hhmmss.sss
+		int32_t scale = 1;
+		for (uint8_t i = 0; i < d; i++) scale *= 10;
+		int32_t hms = m / scale;
+		int32_t ms = (m - hms * scale) * 1000 / scale;
+		rmc->timeOfDayMs = ((hms / 10000) * 3600 + (hms / 100 % 100) * 60 + hms % 100) * 1000UL + ms;
+
+		// Date ddmmyy
+		rmc->utcMs = TimeBase::epochMs(2000 + dmy % 100,	// TODO: In year 2100, please change this to 2100,
+															// and increment this todo. I wont be there to
+															// thank you, so thank you in advance!
+			dmy / 100 % 100, dmy / 10000, rmc->timeOfDayMs);
+	}
+
+	// Status
+	nmeaField(sentence, len, 2, &f);
+	rmc->valid = (f.len == 1 && f.data[0] == 'A');
+	if (!rmc->valid) {
+		rmc->latitude = 0.;
+		rmc->longitude = 0.;
+		rmc->speed = 0.;
+		rmc->course = 0.;
+		return true;
+	}
+
+	// GPS position
+	nmeaField(sentence, len, 3, &f);
+	rmc->latitude = nmeaDegrees(f);
+	nmeaField(sentence, len, 4, &f);
+	if (f.len == 1 && f.data[0] == 'S') rmc->latitude *= -1;
+	nmeaField(sentence, len, 5, &f);
+	rmc->longitude = nmeaDegrees(f);
+	nmeaField(sentence, len, 6, &f);
+	if (f.len == 1 && f.data[0] == 'W') rmc->longitude *= -1;
+
+	// Speed - knots to km/t. 1 knot = 1.852 km/t
+	// Ref: https://en.wikipedia.org/wiki/Knot_(unit)
+	nmeaField(sentence, len, 7, &f);
+	rmc->speed = nmeaFloat(f) * 1.852;
+
+	// Course over ground
+	nmeaField(sentence, len, 8, &f);
+	rmc->course = nmeaFloat(f);
+
+	return true;
+}
+
+// Builds $<body>*HH\r\n into buf. Returns length, 0 if buf is too small.
+size_t nmeaCommand(const char *body, char *buf, size_t len) {
+	size_t n = strlen(body);
+	if (n + 7 > len) return 0;
+
+	uint8_t crc = nmeaChecksum(body, n);
+	buf[0] = '$';
+	memcpy(buf + 1, body, n);
+	buf[n + 1] = '*';
+	buf[n + 2] = hexDigits[crc >> 4];
+	buf[n + 3] = hexDigits[crc & 0x0F];
+	buf[n + 4] = '\r';
+	buf[n + 5] = '\n';
+	buf[n + 6] = 0;
+	return n + 6;
+}
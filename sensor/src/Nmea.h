@@ -0,0 +1,65 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   NMEA 0183 sentence helpers working on char buffers
+			  Ref: https://docs.rs-online.com/3824/0900766b8147dbf6.pdf
+*/
+
+#ifndef NMEA_H
+#define NMEA_H
+
+#include "Particle.h"
+#include "Text.h"
+
+// Fields from a $GNRMC sentence
+struct NmeaRmc {
+	bool valid;				// Status A = valid position
+	double latitude;		// Decimal degrees, negative = S
+	double longitude;		// Decimal degrees, negative = W
+	float speed;			// km/h
+	float course;			// Degrees from true north
+	uint32_t timeOfDayMs;	// UTC hh:mm:ss.sss in ms
+	uint64_t utcMs;			// UTC epoch ms, 0 if date/time fields are missing
+};
+
+// Macro value as string literal, for building fixed commands from settings
+#define NMEA_STR_(x)	#x
+#define NMEA_STR(x)		NMEA_STR_(x)
+
+// Fixed command built at compile time, $<body>*HH\r\n:
+//   static constexpr NmeaFixedCommand cmd("PMTK225,0");
+template <size_t N>
+struct NmeaFixedCommand {
+	char str[N + 6];
+
+	constexpr NmeaFixedCommand(const char (&body)[N]) : str{} {
+		const char hex[] = "0123456789ABCDEF";
+		uint8_t crc = 0;
+		str[0] = '$';
+		for (size_t i = 0; i < N - 1; i++) {
+			str[i + 1] = body[i];
+			crc ^= (uint8_t)body[i];
+		}
+		str[N] = '*';
+		str[N + 1] = hex[crc >> 4];
+		str[N + 2] = hex[crc & 0x0F];
+		str[N + 3] = '\r';
+		str[N + 4] = '\n';
+		str[N + 5] = 0;
+	}
+
+	const char *c_str() const {
+		return str;
+	}
+};
+
+uint8_t nmeaChecksum(const char *str, size_t len);
+bool nmeaVerify(const char *sentence, size_t len);
+bool nmeaField(const char *sentence, size_t len, uint8_t index, TextSpan *field);
+bool nmeaDecimal(TextSpan field, int32_t *mantissa, uint8_t *decimals);
+double nmeaDegrees(TextSpan field);
+float nmeaFloat(TextSpan field);
+bool nmeaParseRmc(const char *sentence, size_t len, NmeaRmc *rmc);
+size_t nmeaCommand(const char *body, char *buf, size_t len);
+
+#endif
@@ -0,0 +1,183 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Cycle counter based timing of states and drivers, with
+			  latency histograms, loop gap and sample jitter tracking, and
+			  time from ignition to first sample and display frame
+*/
+
+#include "Profiler.h"
+
+// Shared instance, so drivers can time their blocking calls
+Profiler profiler;
+
+Profiler::Profiler() {
+	ticksPerUs = 1;
+	wrapMs = 0;
+	reset();
+	bootStart(0);
+}
+
+void Profiler::begin() {
+	ticksPerUs = System.ticksPerMicrosecond();
+	if (ticksPerUs == 0) ticksPerUs = 1;
+	wrapMs = UINT32_MAX / ticksPerUs / 1000 / 2;
+	reset();
+}
+
+void Profiler::reset() {
+	memset(slots, 0, sizeof(slots));
+	memset(&sampleJitter, 0, sizeof(sampleJitter));
+	memset(&sampleLatency, 0, sizeof(sampleLatency));
+	lastLoopTicks = 0;
+	maxLoopGapUs = 0;
+	timerTicks = 0;
+	lastSampleMillis = 0;
+}
+
+// Returns start of a span, to be passed to stop()
+ProfTicks Profiler::start() {
+	return ((ProfTicks)millis() << 32) | System.ticks();
+}
+
+void Profiler::stop(ProfSlot slot, ProfTicks startTicks) {
+	if (slot >= PROF_SLOT_COUNT) return;
+	record(&slots[slot], elapsedUs(startTicks));
+}
+
+// Call once per pass of loop()
+void Profiler::loopMark() {
+	ProfTicks now = start();
+	if (lastLoopTicks != 0) {
+		uint32_t gap = elapsedUs(lastLoopTicks);
+		if (gap > maxLoopGapUs) maxLoopGapUs = gap;
+	}
+	lastLoopTicks = now;
+}
+
+// Call after sleep, so the sleep is not counted as a loop gap
+void Profiler::loopResume() {
+	lastLoopTicks = 0;
+}
+
+// Call from sample timer callback
+void Profiler::sampleTimer() {
+	timerTicks = start();
+}
+
+// Call when SAMPLE state starts
+void Profiler::sampleStart() {
+	// Only samples from the timer, not the extra ones while sensors come up
+	if (timerTicks == 0) return;
+
+	uint32_t now = millis();
+	if (lastSampleMillis != 0) {
+		int32_t jitter = (int32_t)(now - lastSampleMillis) - SAMPLE_INTERVAL_MS;
+		uint64_t us = (uint64_t)abs(jitter) * 1000;
+		record(&sampleJitter, us > UINT32_MAX ? UINT32_MAX : (uint32_t)us);
+	}
+	lastSampleMillis = now;
+
+	record(&sampleLatency, elapsedUs(timerTicks));
+	timerTicks = 0;
+}
+
+// Call when ignition is detected. Boot milestones are kept across reset().
+// Sample jitter starts over, the last sample is from the previous trip.
+void Profiler::bootStart(system_tick_t ignition) {
+	bootIgnition = ignition;
+	lastSampleMillis = 0;
+	timerTicks = 0;
+	for (uint8_t i = 0; i < BOOT_MARK_COUNT; i++) bootMs[i] = 0;
+}
+
+// Records first time a milestone is reached after bootStart(), from any thread
+void Profiler::bootMark(BootMark mark) {
+	if (mark >= BOOT_MARK_COUNT || bootMs[mark] != 0) return;
+	uint32_t ms = millis() - bootIgnition;
+	bootMs[mark] = ms == 0 ? 1 : ms;
+}
+
+uint32_t Profiler::getMaxLoopGapUs() {
+	return maxLoopGapUs;
+}
+
+void Profiler::record(Histogram *hist, uint32_t us) {
+	hist->count++;
+	hist->sumUs += us;
+	if (us > hist->maxUs) hist->maxUs = us;
+
+	uint8_t bucket = us == 0 ? 0 : 31 - __builtin_clz(us);
+	if (bucket >= PROF_BUCKETS) bucket = PROF_BUCKETS - 1;
+	hist->buckets[bucket]++;
+}
+
+// us since start(), by cycle counter while it can't have wrapped
+uint32_t Profiler::elapsedUs(ProfTicks startTicks) {
+	uint32_t ticks = System.ticks() - (uint32_t)startTicks;
+	system_tick_t ms = millis() - (system_tick_t)(startTicks >> 32);
+	if (ms < wrapMs) return ticks / ticksPerUs;
+	return ms >= UINT32_MAX / 1000 ? UINT32_MAX : ms * 1000;
+}
+
+const char *Profiler::slotName(uint8_t slot) {
+	static const char *names[PROF_SLOT_COUNT] = {
+		"init", "idle", "sample", "publish", "sleep", "levels", "upload",
+		"lcd", "sen50", "htu31", "mics", "l86", "recirc", "ble_conn", "cloud_conn"
+	};
+	return slot < PROF_SLOT_COUNT ? names[slot] : "?";
+}
+
+// Compact JSON summary: {"slot":[count,avg us,max us],...,"gap":us,"jit":[...],"lat":[...],"boot":[ms,...]}
+size_t Profiler::summary(char *buf, size_t len) {
+	size_t pos = 0;
+
+	pos += snprintf(buf + pos, len > pos ? len - pos : 0, "{");
+	for (uint8_t i = 0; i < PROF_SLOT_COUNT; i++) {
+		const Histogram *h = &slots[i];
+		if (h->count == 0) continue;
+		pos += snprintf(buf + pos, len > pos ? len - pos : 0, "\"%s\":[%lu,%lu,%lu],",
+			slotName(i), h->count, (uint32_t)(h->sumUs / h->count), h->maxUs);
+	}
+	pos += snprintf(buf + pos, len > pos ? len - pos : 0, "\"gap\":%lu,\"jit\":[%lu,%lu],\"lat\":[%lu,%lu],",
+		maxLoopGapUs,
+		sampleJitter.count ? (uint32_t)(sampleJitter.sumUs / sampleJitter.count) : 0, sampleJitter.maxUs,
+		sampleLatency.count ? (uint32_t)(sampleLatency.sumUs / sampleLatency.count) : 0, sampleLatency.maxUs);
+	pos += snprintf(buf + pos, len > pos ? len - pos : 0, "\"boot\":[%lu,%lu,%lu,%lu,%lu]}",
+		bootMs[BOOT_FIRST_SAMPLE], bootMs[BOOT_FIRST_FRAME], bootMs[BOOT_SENSORS_READY], bootMs[BOOT_GPS_READY],
+		bootMs[BOOT_GPS_FIX]);
+
+	return pos < len ? pos : len - 1;
+}
+
+// Full dump with histograms, e.g. to Serial
+void Profiler::dump(Print &out) {
+	out.printlnf("=== TIMING (us) === max loop gap: %lu", maxLoopGapUs);
+	out.printlnf("Boot (ms from ignition): first sample %lu, first frame %lu, sensors ready %lu, GPS ready %lu, GPS fix %lu",
+		bootMs[BOOT_FIRST_SAMPLE], bootMs[BOOT_FIRST_FRAME], bootMs[BOOT_SENSORS_READY], bootMs[BOOT_GPS_READY],
+		bootMs[BOOT_GPS_FIX]);
+	for (uint8_t i = 0; i < PROF_SLOT_COUNT + 2; i++) {
+		const Histogram *h;
+		const char *name;
+		if (i < PROF_SLOT_COUNT) {
+			h = &slots[i];
+			name = slotName(i);
+		}
+		else if (i == PROF_SLOT_COUNT) {
+			h = &sampleJitter;
+			name = "sample_jitter";
+		}
+		else {
+			h = &sampleLatency;
+			name = "sample_latency";
+		}
+		if (h->count == 0) continue;
+
+		out.printf("%-14s n=%lu avg=%lu max=%lu |", name, h->count,
+			(uint32_t)(h->sumUs / h->count), h->maxUs);
+		for (uint8_t b = 0; b < PROF_BUCKETS; b++) {
+			if (h->buckets[b] > 0) out.printf(" <%lu:%lu", 2UL << b, h->buckets[b]);
+		}
+		out.println();
+	}
+}
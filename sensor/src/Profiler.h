@@ -0,0 +1,106 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Cycle counter based timing of states and drivers, with
+			  latency histograms, loop gap and sample jitter tracking, and
+			  time from ignition to first sample and display frame
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+// Timed slots. State slots must follow the order of State in AirFleetMain.cpp
+enum ProfSlot {
+	PROF_STATE_INIT,
+	PROF_STATE_IDLE,
+	PROF_STATE_SAMPLE,
+	PROF_STATE_PUBLISH,
+	PROF_STATE_SLEEP,
+	PROF_STATE_LEVELS,
+	PROF_STATE_UPLOAD,
+	PROF_LCD,
+	PROF_SEN50,
+	PROF_HTU31,
+	PROF_MICS,
+	PROF_L86,
+	PROF_RECIRC,		// From I2C read to recirculation output
+	PROF_BLE_CONNECT,
+	PROF_CLOUD_CONNECT,
+	PROF_SLOT_COUNT
+};
+
+// Boot milestones, ms from ignition
+enum BootMark {
+	BOOT_FIRST_SAMPLE,		// First sample with any sensor reading
+	BOOT_FIRST_FRAME,		// First frame on the display
+	BOOT_SENSORS_READY,		// All I2C sensors up
+	BOOT_GPS_READY,			// GPS module configured
+	BOOT_GPS_FIX,			// First valid position, time to first fix
+	BOOT_MARK_COUNT
+};
+
+// Histogram buckets: bucket i holds durations in [2^i, 2^(i+1)) us
+#define PROF_BUCKETS	24
+
+// Start of a timed span: cycle counter in the low word, millis() in the high
+// word. Spans longer than the cycle counter can hold, e.g. a connect or the
+// SLEEP state, are timed by millis().
+typedef uint64_t ProfTicks;
+
+class Profiler {
+	public:
+		Profiler();
+
+		void begin();
+		ProfTicks start();
+		void stop(ProfSlot slot, ProfTicks startTicks);
+		void loopMark();
+		void loopResume();
+		void sampleTimer();
+		void sampleStart();
+		void reset();
+		void bootStart(system_tick_t ignition);
+		void bootMark(BootMark mark);
+
+		size_t summary(char *buf, size_t len);
+		void dump(Print &out);
+
+		uint32_t getMaxLoopGapUs();
+
+	private:
+		struct Histogram {
+			uint32_t count;
+			uint64_t sumUs;
+			uint32_t maxUs;
+			uint32_t buckets[PROF_BUCKETS];
+		};
+
+		void record(Histogram *hist, uint32_t us);
+		uint32_t elapsedUs(ProfTicks startTicks);
+		static const char *slotName(uint8_t slot);
+
+		Histogram slots[PROF_SLOT_COUNT];
+		uint32_t ticksPerUs;
+		system_tick_t wrapMs;	// Longest span timed by the cycle counter
+
+		// Main loop
+		ProfTicks lastLoopTicks;
+		uint32_t maxLoopGapUs;
+
+		// Sample timer: jitter between samples, and latency from timer to SAMPLE
+		volatile ProfTicks timerTicks;
+		uint32_t lastSampleMillis;
+		Histogram sampleJitter;
+		Histogram sampleLatency;
+
+		// Boot milestones of the latest ignition, 0 until reached
+		system_tick_t bootIgnition;
+		volatile uint32_t bootMs[BOOT_MARK_COUNT];
+};
+
+extern Profiler profiler;
+
+#endif
@@ -0,0 +1,222 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   WiFi/cloud session manager
+*/
+
+#include "Radio.h"
+#include "Profiler.h"
+#include "Energy.h"
+
+Radio::Radio() {
+	state = OFF;
+	stateTime = 0;
+	sessionStart = 0;
+	lingerUntil = 0;
+	failTime = 0;
+	opDeadline = 0;
+	op = false;
+
+	connectCostMs = RADIO_CONNECT_COST_MS;
+	lastConnectMs = 0;
+	sessions = 0;
+	failures = 0;
+	timeouts = 0;
+	sessionUploads = 0;
+	uploads = 0;
+	onMs = 0;
+}
+
+// Enforces timeouts. Call on every pass of the main loop.
+void Radio::loop() {
+	system_tick_t now = millis();
+
+	switch (state) {
+		case OFF:
+			break;
+
+		case CONNECTING:
+			if (now - stateTime >= RADIO_CONNECT_TIMEOUT_MS) {
+#ifdef AIRFLEET_DEBUG
+				Log.error("RADIO connect timeout");
+#endif
+				failures++;
+				failTime = now;
+				drop();
+			}
+			break;
+
+		case CONNECTED:
+			if (op && (int32_t)(now - opDeadline) >= 0) {
+				// Operation did not complete in time
+#ifdef AIRFLEET_DEBUG
+				Log.error("RADIO operation timeout");
+#endif
+				timeouts++;
+				op = false;
+				release(0);
+			}
+			else if (!Particle.connected()) {
+				// Lost link
+				op = false;
+				failures++;
+				failTime = now;
+				drop();
+			}
+			break;
+
+		case LINGER:
+			if ((int32_t)(now - lingerUntil) >= 0 || !Particle.connected()) drop();
+			break;
+	}
+}
+
+// Returns true when connected to cloud, otherwise starts connecting
+bool Radio::request() {
+	system_tick_t now = millis();
+
+	switch (state) {
+		case OFF: {
+#ifdef AIRFLEET_DEBUG
+			Log.info("RADIO connecting");
+#endif
+			ProfTicks ticks = profiler.start();
+			WiFi.on();
+			WiFi.connect();
+			Particle.connect();
+			profiler.stop(PROF_CLOUD_CONNECT, ticks);
+
+			state = CONNECTING;
+			energy.set(ENERGY_WIFI, ENERGY_WIFI_CONNECTING);
+			stateTime = now;
+			sessionStart = now;
+			sessionUploads = 0;
+			sessions++;
+			return false;
+		}
+
+		case CONNECTING:
+			if (!WiFi.ready() || !Particle.connected()) return false;
+
+			// Connect cost, moving average with weight 1/4
+			lastConnectMs = now - stateTime;
+			connectCostMs = (3 * connectCostMs + lastConnectMs) / 4;
+			state = CONNECTED;
+			energy.set(ENERGY_WIFI, ENERGY_WIFI_CONNECTED);
+			stateTime = now;
+
+#ifdef AIRFLEET_DEBUG
+			Log.info("RADIO connected in %lu ms", lastConnectMs);
+#endif
+			return true;
+
+		case LINGER:
+			state = CONNECTED;
+			stateTime = now;
+			return Particle.connected();
+
+		case CONNECTED:
+			return Particle.connected();
+	}
+	return false;
+}
+
+// Caller is done. Keeps link until next expected use, if that's cheaper
+// than reconnecting, otherwise drops it.
+void Radio::release(system_tick_t nextUseMs) {
+	if (state != CONNECTED || op) return;
+
+	if (nextUseMs > 0 && keepLink(nextUseMs)) {
+		state = LINGER;
+		stateTime = millis();
+		lingerUntil = stateTime + nextUseMs + RADIO_LINGER_MARGIN_MS;
+		return;
+	}
+
+	drop();
+}
+
+// Keeping the link idle costs RADIO_IDLE_MA for nextUseMs, reconnecting
+// costs RADIO_CONNECT_MA for connectCostMs
+bool Radio::keepLink(system_tick_t nextUseMs) {
+	return (uint64_t)nextUseMs * RADIO_IDLE_MA < (uint64_t)connectCostMs * RADIO_CONNECT_MA;
+}
+
+// Number of samples to collect before connecting. 1 when the link is
+// cheap enough to keep up, otherwise as many as fit in the max. batch age.
+size_t Radio::batchSize(system_tick_t intervalMs) {
+	if (intervalMs == 0 || keepLink(intervalMs)) return 1;
+
+	size_t size = RADIO_BATCH_MAX_AGE_MS / intervalMs;
+	if (size < 1) size = 1;
+	if (size > JOURNAL_SIZE / 2) size = JOURNAL_SIZE / 2;
+	return size;
+}
+
+// Returns true if queued samples should be uploaded now
+bool Radio::wantsUpload(size_t depth, system_tick_t oldestAgeMs, system_tick_t intervalMs) {
+	if (depth == 0) return false;
+	if (state != OFF) return true;
+
+	// Back off after failed connect
+	if (failTime != 0 && millis() - failTime < RADIO_RETRY_MS) return false;
+
+	return depth >= batchSize(intervalMs) || oldestAgeMs >= RADIO_BATCH_MAX_AGE_MS;
+}
+
+// Starts an operation, e.g. waiting for a webhook response
+void Radio::beginOp(system_tick_t timeoutMs) {
+	op = true;
+	opDeadline = millis() + timeoutMs;
+}
+
+void Radio::endOp() {
+	op = false;
+}
+
+bool Radio::opActive() {
+	return op;
+}
+
+void Radio::countUpload() {
+	uploads++;
+	sessionUploads++;
+	energy.countUpload();
+}
+
+bool Radio::isOn() {
+	return state != OFF;
+}
+
+void Radio::off() {
+	op = false;
+	drop();
+}
+
+void Radio::drop() {
+	if (state == OFF) return;
+
+	system_tick_t sessionMs = millis() - sessionStart;
+	onMs += sessionMs;
+
+#ifdef AIRFLEET_DEBUG
+	Log.info("RADIO disconnecting, session: %lu ms, uploads: %lu, connect: %lu ms (avg %lu ms)",
+		sessionMs, sessionUploads, lastConnectMs, connectCostMs);
+#endif
+
+	Particle.disconnect();
+	WiFi.off();
+	state = OFF;
+	energy.set(ENERGY_WIFI, ENERGY_WIFI_OFF);
+	stateTime = millis();
+}
+
+// JSON with session statistics
+size_t Radio::summary(char *buf, size_t len) {
+	int n = snprintf(buf, len,
+		"{\"sessions\":%lu,\"failures\":%lu,\"timeouts\":%lu,\"connect_ms\":%lu,"
+		"\"on_ms\":%lu,\"uploads\":%lu,\"ms_per_upload\":%lu}",
+		sessions, failures, timeouts, connectCostMs,
+		(uint32_t)onMs, uploads, uploads ? (uint32_t)(onMs / uploads) : 0);
+	return n < 0 ? 0 : ((size_t)n < len ? n : len - 1);
+}
@@ -0,0 +1,66 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   WiFi/cloud session manager. Measures what a connect costs and
+			  decides whether to keep the link up between publishes, or to
+			  batch samples and drop it.
+*/
+
+#ifndef RADIO_H
+#define RADIO_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+class Radio {
+	public:
+		Radio();
+
+		void loop();
+		bool request();
+		void release(system_tick_t nextUseMs);
+		void off();
+		bool isOn();
+
+		bool wantsUpload(size_t depth, system_tick_t oldestAgeMs, system_tick_t intervalMs);
+		size_t batchSize(system_tick_t intervalMs);
+
+		void beginOp(system_tick_t timeoutMs);
+		void endOp();
+		bool opActive();
+
+		void countUpload();
+
+		size_t summary(char *buf, size_t len);
+
+	private:
+		enum State {
+			OFF,
+			CONNECTING,
+			CONNECTED,
+			LINGER
+		};
+		State state;
+
+		bool keepLink(system_tick_t nextUseMs);
+		void drop();
+
+		system_tick_t stateTime;		// Time of entering current state
+		system_tick_t sessionStart;		// Time radio was turned on
+		system_tick_t lingerUntil;
+		system_tick_t failTime;			// Time of last failed connect
+		system_tick_t opDeadline;
+		bool op;
+
+		// Statistics
+		system_tick_t connectCostMs;	// Moving average of connect time
+		system_tick_t lastConnectMs;
+		uint32_t sessions;
+		uint32_t failures;
+		uint32_t timeouts;
+		uint32_t sessionUploads;
+		uint32_t uploads;
+		uint64_t onMs;					// Total radio on time
+};
+
+#endif
@@ -0,0 +1,155 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Cabin recirculation output
+*/
+
+#include "Recirc.h"
+#include "Fixed.h"
+
+// Samples to look ahead for the trend prediction
+#define RECIRC_AHEAD_SAMPLES	((float)RECIRC_PREDICT_MS / SAMPLE_INTERVAL_MS)
+
+void Recirc::Trend::reset() {
+	primed = false;
+	level = 0;
+	slope = 0;
+}
+
+void Recirc::Trend::add(float x) {
+	if (isnan(x)) return;
+	if (!primed) {
+		level = x;
+		slope = 0;
+		primed = true;
+		return;
+	}
+	float prev = level;
+	level = RECIRC_ALPHA * x + (1 - RECIRC_ALPHA) * (level + slope);
+	slope = RECIRC_BETA * (level - prev) + (1 - RECIRC_BETA) * slope;
+}
+
+float Recirc::Trend::ahead(float samples) {
+	// Only rising trends predict, a falling one must not hold the intake closed
+	return slope > 0 ? level + slope * samples : level;
+}
+
+Recirc::Recirc() {
+	pmTrend.reset();
+	co2Trend.reset();
+	aheadPm = NAN;
+	aheadCo2 = NAN;
+	closed = false;
+	reason = RECIRC_NONE;
+	changedAt = 0;
+	ventUntil = 0;
+	confirm = 0;
+	changes = 0;
+	trendCloses = 0;
+	hotspotCloses = 0;
+	vents = 0;
+}
+
+// Historical levels where we are heading, NAN when unknown. Used from the
+// next update().
+void Recirc::forecast(float pm, float co2) {
+	aheadPm = pm;
+	aheadCo2 = co2;
+}
+
+void Recirc::begin() {
+	pinMode(RECIRC_PIN, OUTPUT);
+	digitalWrite(RECIRC_PIN, !RECIRC_ACTIVE_LEVEL);
+}
+
+// Call right after PM and CO2 are read, NAN for a missing reading.
+// Returns true when the output changed.
+bool Recirc::update(float pm, float co2) {
+	pmTrend.add(pm);
+	co2Trend.add(co2);
+
+	system_tick_t now = millis();
+	bool held = now - changedAt < RECIRC_MIN_HOLD_MS;
+
+	if (closed) {
+		// Let fresh air into the cabin now and then
+		if (now - changedAt >= RECIRC_MAX_CLOSED_MS) {
+			ventUntil = now + RECIRC_VENT_MS;
+			vents++;
+			set(false, RECIRC_NONE);
+			return true;
+		}
+
+		// Open when everything is below the off level, and not rising towards on
+		if (held) return false;
+		if (pmTrend.level >= RECIRC_PM_OFF || co2Trend.level >= RECIRC_CO2_OFF) return false;
+		if (pmTrend.ahead(RECIRC_AHEAD_SAMPLES) >= RECIRC_PM_ON) return false;
+		if (co2Trend.ahead(RECIRC_AHEAD_SAMPLES) >= RECIRC_CO2_ON) return false;
+		if (aheadPm >= RECIRC_PM_ON || aheadCo2 >= RECIRC_CO2_ON) return false;
+		set(false, RECIRC_NONE);
+		return true;
+	}
+
+	// Closing is not held back by the minimum hold, only by venting
+	if ((int32_t)(ventUntil - now) > 0) return false;
+
+	RecircReason why = RECIRC_NONE;
+	if (pmTrend.primed && pmTrend.level >= RECIRC_PM_ON) why = RECIRC_PM;
+	else if (co2Trend.primed && co2Trend.level >= RECIRC_CO2_ON) why = RECIRC_CO2;
+	else if (pmTrend.primed && pmTrend.ahead(RECIRC_AHEAD_SAMPLES) >= RECIRC_PM_ON) why = RECIRC_PM_TREND;
+	else if (co2Trend.primed && co2Trend.ahead(RECIRC_AHEAD_SAMPLES) >= RECIRC_CO2_ON) why = RECIRC_CO2_TREND;
+	else if (aheadPm >= RECIRC_PM_ON || aheadCo2 >= RECIRC_CO2_ON) why = RECIRC_HOTSPOT;
+	if (why == RECIRC_NONE) {
+		confirm = 0;
+		return false;
+	}
+
+	// A single spike in the readings must not close, the forecast is not noisy
+	if (why != RECIRC_HOTSPOT && ++confirm < RECIRC_CONFIRM_SAMPLES) return false;
+
+	if (why == RECIRC_PM_TREND || why == RECIRC_CO2_TREND) trendCloses++;
+	if (why == RECIRC_HOTSPOT) hotspotCloses++;
+	set(true, why);
+	return true;
+}
+
+// Opens intake and forgets trends, e.g. when ignition is off
+void Recirc::off() {
+	if (closed) set(false, RECIRC_NONE);
+	pmTrend.reset();
+	co2Trend.reset();
+	aheadPm = NAN;
+	aheadCo2 = NAN;
+	ventUntil = millis();
+}
+
+void Recirc::set(bool close, RecircReason why) {
+	digitalWrite(RECIRC_PIN, close ? RECIRC_ACTIVE_LEVEL : !RECIRC_ACTIVE_LEVEL);
+	closed = close;
+	reason = why;
+	changedAt = millis();
+	confirm = 0;
+	changes++;
+}
+
+bool Recirc::isClosed() {
+	return closed;
+}
+
+RecircReason Recirc::getReason() {
+	return reason;
+}
+
+uint32_t Recirc::getChanges() {
+	return changes;
+}
+
+size_t Recirc::summary(char *buf, size_t len) {
+	int n = snprintf(buf, len,
+		"{\"closed\":%d,\"reason\":%d,\"changes\":%lu,\"trend_closes\":%lu,\"hotspot_closes\":%lu,\"vents\":%lu,"
+		"\"pm\":%s,\"pm_slope\":%s,\"co2\":%ld,\"co2_slope\":%s}",
+		closed, reason, (unsigned long)changes, (unsigned long)trendCloses, (unsigned long)hotspotCloses, (unsigned long)vents,
+		FixedText(lroundf(pmTrend.level * 10), 1).text, FixedText(lroundf(pmTrend.slope * 100), 2).text,
+		lroundf(co2Trend.level), FixedText(lroundf(co2Trend.slope * 10), 1).text);
+	return n < 0 ? 0 : ((size_t)n < len ? n : len - 1);
+}
@@ -0,0 +1,69 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Cabin recirculation output, closes the car's air intake on
+			  high PM or CO2 at the intake. Hysteresis on levels, and a
+			  trend prediction to close before a plume arrives.
+*/
+
+#ifndef RECIRC_H
+#define RECIRC_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+// Why the intake was last closed
+enum RecircReason {
+	RECIRC_NONE,
+	RECIRC_PM,
+	RECIRC_CO2,
+	RECIRC_PM_TREND,
+	RECIRC_CO2_TREND,
+	RECIRC_HOTSPOT
+};
+
+class Recirc {
+	public:
+		Recirc();
+
+		void begin();
+		void forecast(float pm, float co2);
+		bool update(float pm, float co2);
+		void off();
+		bool isClosed();
+		RecircReason getReason();
+		uint32_t getChanges();
+
+		size_t summary(char *buf, size_t len);
+
+	private:
+		// Holt's linear trend: smoothed level and slope per sample
+		struct Trend {
+			bool primed;
+			float level;
+			float slope;
+
+			void reset();
+			void add(float x);
+			float ahead(float samples);
+		};
+
+		void set(bool close, RecircReason why);
+
+		Trend pmTrend;
+		Trend co2Trend;
+		float aheadPm;		// Known levels on the road ahead
+		float aheadCo2;
+		bool closed;
+		RecircReason reason;
+		system_tick_t changedAt;
+		system_tick_t ventUntil;
+		uint8_t confirm;		// Updates in a row that called for closing
+
+		uint32_t changes;
+		uint32_t trendCloses;
+		uint32_t hotspotCloses;
+		uint32_t vents;
+};
+
+#endif
@@ -0,0 +1,203 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Rolling statistics of a sensor value with fixed memory and O(1)
+			  updates
+*/
+
+#include "RollingStats.h"
+#include "Fixed.h"
+
+// Smoothing factors, values arrive every SAMPLE_INTERVAL_MS
+static const float alpha[STATS_HORIZONS] = {
+	1.f - expf(-(float)SAMPLE_INTERVAL_MS / STATS_EWMA_FAST_MS),
+	1.f - expf(-(float)SAMPLE_INTERVAL_MS / STATS_EWMA_MID_MS),
+	1.f - expf(-(float)SAMPLE_INTERVAL_MS / STATS_EWMA_SLOW_MS)
+};
+
+P2Quantile::P2Quantile(float p) : p(p) {
+	reset();
+}
+
+void P2Quantile::reset() {
+	count = 0;
+}
+
+void P2Quantile::add(float x) {
+	// Collect the first five values as initial markers
+	if (count < 5) {
+		size_t i = count++;
+		while (i > 0 && q[i - 1] > x) {
+			q[i] = q[i - 1];
+			i--;
+		}
+		q[i] = x;
+		if (count == 5) {
+			for (size_t j = 0; j < 5; j++) n[j] = j;
+			np[0] = 0;
+			np[1] = 2 * p;
+			np[2] = 4 * p;
+			np[3] = 2 + 2 * p;
+			np[4] = 4;
+			dn[0] = 0;
+			dn[1] = p / 2;
+			dn[2] = p;
+			dn[3] = (1 + p) / 2;
+			dn[4] = 1;
+		}
+		return;
+	}
+	count++;
+
+	// Find cell of x, extending the extremes
+	size_t k;
+	if (x < q[0]) {
+		q[0] = x;
+		k = 0;
+	}
+	else if (x >= q[4]) {
+		q[4] = x;
+		k = 3;
+	}
+	else {
+		for (k = 0; k < 3; k++) {
+			if (x < q[k + 1]) break;
+		}
+	}
+	for (size_t i = k + 1; i < 5; i++) n[i]++;
+	for (size_t i = 0; i < 5; i++) np[i] += dn[i];
+
+	// Move middle markers towards their desired positions
+	for (size_t i = 1; i < 4; i++) {
+		float d = np[i] - n[i];
+		if ((d >= 1 && n[i + 1] - n[i] > 1) || (d <= -1 && n[i - 1] - n[i] < -1)) {
+			int32_t s = d >= 0 ? 1 : -1;
+
+			// Piecewise parabolic prediction, linear if it leaves the neighbours
+			float qp = q[i] + (float)s / (n[i + 1] - n[i - 1]) *
+				((n[i] - n[i - 1] + s) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+				(n[i + 1] - n[i] - s) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+			if (q[i - 1] < qp && qp < q[i + 1]) {
+				q[i] = qp;
+			}
+			else {
+				q[i] += s * (q[i + s] - q[i]) / (n[i + s] - n[i]);
+			}
+			n[i] += s;
+		}
+	}
+}
+
+float P2Quantile::get() const {
+	if (count == 0) return 0;
+	if (count < 5) return q[(size_t)(p * (count - 1) + .5f)];
+	return q[2];
+}
+
+SlidingExtreme::SlidingExtreme(bool max) : max(max) {
+	reset();
+}
+
+void SlidingExtreme::reset() {
+	head = 0;
+	size = 0;
+}
+
+// Drops values that can no longer be the extreme, so the deque is monotonic
+// and the front is the extreme of the window
+void SlidingExtreme::add(float x, uint32_t seq) {
+	while (size > 0) {
+		float back = values[(head + size - 1) % STATS_WINDOW];
+		if (max ? back > x : back < x) break;
+		size--;
+	}
+	if (size > 0 && seq - seqs[head] >= STATS_WINDOW) {
+		head = (head + 1) % STATS_WINDOW;
+		size--;
+	}
+	size_t tail = (head + size) % STATS_WINDOW;
+	values[tail] = x;
+	seqs[tail] = seq;
+	size++;
+}
+
+float SlidingExtreme::get() const {
+	return size > 0 ? values[head] : 0;
+}
+
+RollingStats::RollingStats() : low(false), high(true), median(.5f), upper(.95f) {
+	reset();
+}
+
+void RollingStats::reset() {
+	for (size_t i = 0; i < STATS_HORIZONS; i++) average[i] = 0;
+	low.reset();
+	high.reset();
+	median.reset();
+	upper.reset();
+	count = 0;
+}
+
+void RollingStats::update(float x) {
+	if (isnan(x)) return;
+
+	for (size_t i = 0; i < STATS_HORIZONS; i++) {
+		average[i] = count == 0 ? x : average[i] + alpha[i] * (x - average[i]);
+	}
+	low.add(x, count);
+	high.add(x, count);
+	median.add(x);
+	upper.add(x);
+	count++;
+}
+
+// EWMAs of all horizons, to carry them across a reset
+void RollingStats::getAverages(float *averages) const {
+	for (size_t i = 0; i < STATS_HORIZONS; i++) averages[i] = average[i];
+}
+
+// Continues EWMAs from earlier averages, if nothing has been added yet.
+// Window and percentiles start over.
+void RollingStats::seed(const float *averages) {
+	if (count != 0) return;
+	for (size_t i = 0; i < STATS_HORIZONS; i++) {
+		if (isnan(averages[i])) return;
+	}
+	for (size_t i = 0; i < STATS_HORIZONS; i++) average[i] = averages[i];
+	count = 1;
+}
+
+float RollingStats::ewma(StatsHorizon horizon) const {
+	return average[horizon];
+}
+
+float RollingStats::min() const {
+	return low.get();
+}
+
+float RollingStats::max() const {
+	return high.get();
+}
+
+float RollingStats::p50() const {
+	return median.get();
+}
+
+float RollingStats::p95() const {
+	return upper.get();
+}
+
+uint32_t RollingStats::getCount() const {
+	return count;
+}
+
+size_t RollingStats::summary(char *buf, size_t len) {
+	int n = snprintf(buf, len,
+		"{\"fast\":%s,\"mid\":%s,\"slow\":%s,\"min\":%s,\"max\":%s,"
+		"\"p50\":%s,\"p95\":%s,\"n\":%lu}",
+		FixedText(lroundf(average[STATS_FAST] * 10), 1).text, FixedText(lroundf(average[STATS_MID] * 10), 1).text,
+		FixedText(lroundf(average[STATS_SLOW] * 10), 1).text, FixedText(lroundf(min() * 10), 1).text,
+		FixedText(lroundf(max() * 10), 1).text, FixedText(lroundf(p50() * 10), 1).text,
+		FixedText(lroundf(p95() * 10), 1).text, count);
+	return n < 0 ? 0 : ((size_t)n < len ? n : len - 1);
+}
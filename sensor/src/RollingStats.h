@@ -0,0 +1,85 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Rolling statistics of a sensor value with fixed memory and O(1)
+			  updates: EWMAs at several horizons, min/max over a sliding window
+			  and approximate percentiles. No raw history is kept.
+*/
+
+#ifndef ROLLING_STATS_H
+#define ROLLING_STATS_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+enum StatsHorizon {
+	STATS_FAST,
+	STATS_MID,
+	STATS_SLOW,
+	STATS_HORIZONS
+};
+
+// P-square quantile estimator, Jain & Chlamtac 1985. Five markers follow
+// the min, p/2, p, (1+p)/2 and max quantiles.
+class P2Quantile {
+	public:
+		P2Quantile(float p = 0.5);
+
+		void reset();
+		void add(float x);
+		float get() const;
+
+	private:
+		float p;
+		float q[5];		// Marker heights
+		float np[5];	// Desired marker positions
+		float dn[5];	// Increments of desired positions
+		int32_t n[5];	// Actual marker positions
+		uint32_t count;
+};
+
+// Min or max over the last STATS_WINDOW values, using a monotonic deque
+class SlidingExtreme {
+	public:
+		SlidingExtreme(bool max = true);
+
+		void reset();
+		void add(float x, uint32_t seq);
+		float get() const;
+
+	private:
+		bool max;
+		float values[STATS_WINDOW];
+		uint32_t seqs[STATS_WINDOW];
+		size_t head;
+		size_t size;
+};
+
+class RollingStats {
+	public:
+		RollingStats();
+
+		void reset();
+		void update(float x);
+		void getAverages(float *averages) const;
+		void seed(const float *averages);
+
+		float ewma(StatsHorizon horizon) const;
+		float min() const;
+		float max() const;
+		float p50() const;
+		float p95() const;
+		uint32_t getCount() const;
+
+		size_t summary(char *buf, size_t len);
+
+	private:
+		float average[STATS_HORIZONS];
+		SlidingExtreme low;
+		SlidingExtreme high;
+		P2Quantile median;
+		P2Quantile upper;
+		uint32_t count;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   JSON and binary codecs for Sample
+*/
+
+#include <string.h>
+#include "Sample.h"
+#include "Fixed.h"
+
+size_t sampleJson(const Sample &sample, char *buf, size_t len) {
+	if (len < SAMPLE_JSON_LEN + 1) return 0;
+
+	char *p = buf;
+	*p++ = '{';
+#define SAMPLE_JSON_WRITE(name, type, decimals, kind, sql) \
+	memcpy(p, "\"" #name "\":", sizeof(#name) + 2); \
+	p = fixedWrite(p + sizeof(#name) + 2, (int64_t)sample.name, decimals); \
+	*p++ = ',';
+	SAMPLE_FIELDS(SAMPLE_JSON_WRITE)
+#undef SAMPLE_JSON_WRITE
+	p[-1] = '}';
+	*p = 0;
+	return p - buf;
+}
+
+size_t sampleEncode(const Sample &sample, uint8_t *buf, size_t len) {
+	if (len < SAMPLE_BINARY_LEN) return 0;
+
+	uint8_t *p = buf;
+	*p++ = SAMPLE_SCHEMA_VERSION;
+#define SAMPLE_ENCODE(name, type, decimals, kind, sql) { \
+		uint64_t v = (uint64_t)sample.name; \
+		for (size_t i = 0; i < sizeof(type); i++) { \
+			*p++ = v & 0xFF; \
+			v >>= 8; \
+		} \
+	}
+	SAMPLE_FIELDS(SAMPLE_ENCODE)
+#undef SAMPLE_ENCODE
+	return p - buf;
+}
+
+bool sampleDecode(const uint8_t *buf, size_t len, Sample *sample) {
+	if (len < SAMPLE_BINARY_LEN || buf[0] != SAMPLE_SCHEMA_VERSION) return false;
+
+	const uint8_t *p = buf + 1;
+#define SAMPLE_DECODE(name, type, decimals, kind, sql) { \
+		uint64_t v = 0; \
+		for (size_t i = 0; i < sizeof(type); i++) { \
+			v |= (uint64_t)*p++ << (8 * i); \
+		} \
+		sample->name = (type)v; \
+	}
+	SAMPLE_FIELDS(SAMPLE_DECODE)
+#undef SAMPLE_DECODE
+	return true;
+}
+
+// Value from an older layout in the decimals of the current one
+static int64_t sampleRescale(int64_t v, uint8_t from, uint8_t to) {
+	for (; from < to; from++) v *= 10;
+	for (; from > to; from--) v = (v + (v < 0 ? -5 : 5)) / 10;
+	return v;
+}
+
+// Any layout in SAMPLE_LAYOUTS. Fields an older layout lacks are 0.
+bool sampleDecodeAny(const uint8_t *buf, size_t len, Sample *sample) {
+	size_t need = len > 0 ? sampleBinaryLen(buf[0]) : 0;
+	if (need == 0 || len < need) return false;
+	if (buf[0] == SAMPLE_SCHEMA_VERSION) return sampleDecode(buf, len, sample);
+
+	memset(sample, 0, sizeof(*sample));
+	const uint8_t *p = buf + 1;
+#define SAMPLE_DECODE_OLD(name, type, decimals, kind, sql) { \
+		uint64_t v = 0; \
+		for (size_t i = 0; i < sizeof(type); i++) { \
+			v |= (uint64_t)*p++ << (8 * i); \
+		} \
+		sample->name = (decltype(sample->name))sampleRescale((int64_t)(type)v, decimals, SAMPLE_DECIMALS_##name); \
+	}
+#define SAMPLE_LAYOUT_DECODE(version, fields) case version: fields(SAMPLE_DECODE_OLD) return true;
+	switch (buf[0]) {
+		SAMPLE_LAYOUTS(SAMPLE_LAYOUT_DECODE)
+		default: return false;
+	}
+#undef SAMPLE_LAYOUT_DECODE
+#undef SAMPLE_DECODE_OLD
+}
@@ -0,0 +1,82 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Sample struct and codecs, expanded from SampleSchema.h.
+			  Output length is fixed by the schema, no format strings are
+			  parsed at runtime.
+*/
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <limits>
+#include "SampleSchema.h"
+
+// One sample, fields as fixed point integers
+struct __attribute__((packed)) Sample {
+#define SAMPLE_MEMBER(name, type, decimals, kind, sql) type name;
+	SAMPLE_FIELDS(SAMPLE_MEMBER)
+#undef SAMPLE_MEMBER
+};
+
+// Decimals of each field, SAMPLE_DECIMALS_pm1 etc.
+enum {
+#define SAMPLE_DECIMALS(name, type, decimals, kind, sql) SAMPLE_DECIMALS_##name = decimals,
+	SAMPLE_FIELDS(SAMPLE_DECIMALS)
+#undef SAMPLE_DECIMALS
+};
+
+// Longest text of a fixed point value of type T
+template <typename T>
+constexpr size_t sampleDigits(uint8_t decimals) {
+	return (std::numeric_limits<T>::digits10 + 1 > decimals + 1 ? std::numeric_limits<T>::digits10 + 1 : decimals + 1)
+		+ (std::numeric_limits<T>::is_signed ? 1 : 0)
+		+ (decimals > 0 ? 1 : 0);
+}
+
+// Version byte + fields, little endian
+constexpr size_t SAMPLE_BINARY_LEN = 1
+#define SAMPLE_BINARY_FIELD(name, type, decimals, kind, sql) + sizeof(type)
+	SAMPLE_FIELDS(SAMPLE_BINARY_FIELD)
+#undef SAMPLE_BINARY_FIELD
+	;
+
+// Record length of a layout in SAMPLE_LAYOUTS, 0 for an unknown version
+constexpr size_t sampleBinaryLen(uint8_t version) {
+	switch (version) {
+#define SAMPLE_LAYOUT_LEN(version, fields) case version: return 1 fields(SAMPLE_BINARY_FIELD);
+#define SAMPLE_BINARY_FIELD(name, type, decimals, kind, sql) + sizeof(type)
+		SAMPLE_LAYOUTS(SAMPLE_LAYOUT_LEN)
+#undef SAMPLE_BINARY_FIELD
+#undef SAMPLE_LAYOUT_LEN
+		default: return 0;
+	}
+}
+
+// Longest record of any layout, for read buffers
+constexpr size_t sampleBinaryMaxLen() {
+	size_t len = 0;
+	for (unsigned v = 0; v < 256; v++) {
+		if (sampleBinaryLen(v) > len) len = sampleBinaryLen(v);
+	}
+	return len;
+}
+constexpr size_t SAMPLE_BINARY_MAX_LEN = sampleBinaryMaxLen();
+
+static_assert(sampleBinaryLen(SAMPLE_SCHEMA_VERSION) == SAMPLE_BINARY_LEN, "Current layout in SAMPLE_LAYOUTS");
+
+// Longest JSON object, without zero termination. Per field: "name":value,
+constexpr size_t SAMPLE_JSON_LEN = 1
+#define SAMPLE_JSON_FIELD(name, type, decimals, kind, sql) + sizeof(#name) + 3 + sampleDigits<type>(decimals)
+	SAMPLE_FIELDS(SAMPLE_JSON_FIELD)
+#undef SAMPLE_JSON_FIELD
+	;
+
+size_t sampleJson(const Sample &sample, char *buf, size_t len);
+size_t sampleEncode(const Sample &sample, uint8_t *buf, size_t len);
+bool sampleDecode(const uint8_t *buf, size_t len, Sample *sample);
+bool sampleDecodeAny(const uint8_t *buf, size_t len, Sample *sample);
+
+#endif
@@ -0,0 +1,198 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Every published sample, kept in flash
+*/
+
+#include "SampleLog.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define SAMPLE_LOG_OLD_FILE		SAMPLE_LOG_FILE ".old"
+#define SAMPLE_LOG_ARCHIVE_FILE	SAMPLE_LOG_FILE ".archive"
+
+SampleLog::SampleLog() {
+	fd = -1;
+	for (uint8_t i = 0; i < LOG_FILES; i++) files[i] = { 0, 0 };
+	suspended = false;
+	appendErrors = 0;
+	readFd = -1;
+	readFile = LOG_FILES;
+	readLeft = 0;
+	readArchive = false;
+}
+
+const char *SampleLog::path(uint8_t file) {
+	switch (file) {
+		case LOG_ARCHIVE: return SAMPLE_LOG_ARCHIVE_FILE;
+		case LOG_PREVIOUS: return SAMPLE_LOG_OLD_FILE;
+		default: return SAMPLE_LOG_FILE;
+	}
+}
+
+// Schema version from the first record, and records in file. A version
+// not in SAMPLE_LAYOUTS has no readable records.
+SampleLog::FileInfo SampleLog::inspect(uint8_t file) {
+	FileInfo info = { 0, 0 };
+	int f = open(path(file), O_RDONLY);
+	if (f < 0) return info;
+	off_t size = lseek(f, 0, SEEK_END);
+	if (size > 0 && (lseek(f, 0, SEEK_SET) != 0 || ::read(f, &info.version, 1) != 1)) info.version = 0;
+	close(f);
+	size_t len = sampleBinaryLen(info.version);
+	if (len > 0) info.count = size / len;
+	return info;
+}
+
+// Moves the previous file to the archive when it holds an older schema
+// version, so it is kept until exported. Returns false when the archive
+// is taken by an earlier update, then the previous file must stay too.
+bool SampleLog::keepPrevious() {
+	if (files[LOG_PREVIOUS].count == 0 || files[LOG_PREVIOUS].version == SAMPLE_SCHEMA_VERSION) return true;
+	if (files[LOG_ARCHIVE].count > 0) return false;
+	rename(path(LOG_PREVIOUS), path(LOG_ARCHIVE));
+	files[LOG_ARCHIVE] = files[LOG_PREVIOUS];
+	files[LOG_PREVIOUS] = { 0, 0 };
+	return true;
+}
+
+// Opens current file for appending. Records of an older schema version are
+// moved aside rather than appended to. If there is no room for them, logging
+// is suspended until an export, instead of deleting either.
+void SampleLog::begin() {
+	if (fd >= 0) close(fd);
+	fd = -1;
+	for (uint8_t i = 0; i < LOG_FILES; i++) files[i] = inspect(i);
+	suspended = false;
+
+	uint8_t version = files[LOG_CURRENT].version;
+	if (version != 0 && version != SAMPLE_SCHEMA_VERSION) {
+		if (!keepPrevious()) {
+			suspended = true;
+			return;
+		}
+		rename(path(LOG_CURRENT), path(LOG_PREVIOUS));
+		files[LOG_PREVIOUS] = files[LOG_CURRENT];
+		files[LOG_CURRENT] = { 0, 0 };
+	}
+
+	// Drop a partly written record at the end
+	fd = open(SAMPLE_LOG_FILE, O_RDWR | O_CREAT, 0666);
+	if (fd >= 0) ftruncate(fd, files[LOG_CURRENT].count * SAMPLE_BINARY_LEN);
+	if (fd >= 0) close(fd);
+	fd = open(SAMPLE_LOG_FILE, O_WRONLY | O_CREAT | O_APPEND, 0666);
+}
+
+// Synced at once, appends come at the publish interval and a record that
+// only sits in the LittleFS cache is lost on a reset or brown-out
+bool SampleLog::append(const Sample &sample) {
+	if (fd < 0) return false;
+	if ((files[LOG_CURRENT].count + 1) * SAMPLE_BINARY_LEN > SAMPLE_LOG_MAX) rotate();
+
+	uint8_t record[SAMPLE_BINARY_LEN];
+	sampleEncode(sample, record, sizeof(record));
+	if (fd < 0 || write(fd, record, sizeof(record)) != (ssize_t)sizeof(record)) {
+		appendErrors++;
+		return false;
+	}
+	fsync(fd);
+	files[LOG_CURRENT].version = SAMPLE_SCHEMA_VERSION;
+	files[LOG_CURRENT].count++;
+	return true;
+}
+
+// Current file becomes the previous one, and a new one is started
+void SampleLog::rotate() {
+	if (fd >= 0) close(fd);
+	fd = -1;
+	if (readFd >= 0) {
+		close(readFd);
+		readFd = -1;
+		readFile = LOG_FILES;
+	}
+	if (!keepPrevious()) {
+		suspended = true;
+		return;
+	}
+	rename(SAMPLE_LOG_FILE, SAMPLE_LOG_OLD_FILE);
+	files[LOG_PREVIOUS] = files[LOG_CURRENT];
+	files[LOG_CURRENT] = { 0, 0 };
+	fd = open(SAMPLE_LOG_FILE, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+}
+
+// Reader sees every record appended so far
+void SampleLog::rewind() {
+	if (fd >= 0) fsync(fd);
+	if (readFd >= 0) close(readFd);
+	readFd = -1;
+	readFile = LOG_ARCHIVE;
+	readLeft = 0;
+	readArchive = false;
+}
+
+// Opens the next file with records, unless one is open and has more.
+// Returns false when all files are read.
+bool SampleLog::nextFile() {
+	while (readFile < LOG_FILES) {
+		if (readFd < 0) {
+			readLeft = files[readFile].count;
+			if (readLeft > 0) readFd = open(path(readFile), O_RDONLY);
+			if (readFd >= 0) return true;
+		}
+		else if (readLeft > 0) {
+			return true;
+		}
+		else {
+			close(readFd);
+			readFd = -1;
+		}
+		if (readFile == LOG_ARCHIVE) readArchive = true;
+		readFile++;
+	}
+	return false;
+}
+
+// Schema version of the next record, 0 at the end
+uint8_t SampleLog::readVersion() {
+	return nextFile() ? files[readFile].version : 0;
+}
+
+// Next record, into a buffer of SAMPLE_BINARY_MAX_LEN. Returns its length,
+// 0 at the end.
+size_t SampleLog::read(uint8_t *record) {
+	while (nextFile()) {
+		size_t len = sampleBinaryLen(files[readFile].version);
+		if (::read(readFd, record, len) == (ssize_t)len) {
+			readLeft--;
+			return len;
+		}
+		readLeft = 0;
+	}
+	return 0;
+}
+
+// Host has every record since the last rewind(), so the archive can go.
+// Logging resumes, if it was waiting for that.
+void SampleLog::exported() {
+	if (!readArchive || files[LOG_ARCHIVE].count == 0) return;
+	unlink(SAMPLE_LOG_ARCHIVE_FILE);
+	files[LOG_ARCHIVE] = { 0, 0 };
+	if (suspended) begin();
+}
+
+uint32_t SampleLog::getCount() {
+	uint32_t count = 0;
+	for (uint8_t i = 0; i < LOG_FILES; i++) count += files[i].count;
+	return count;
+}
+
+size_t SampleLog::summary(char *buf, size_t len) {
+	uint32_t bytes = 0;
+	for (uint8_t i = 0; i < LOG_FILES; i++) bytes += files[i].count * sampleBinaryLen(files[i].version);
+	int n = snprintf(buf, len, "{\"records\":%lu,\"bytes\":%lu,\"archived\":%lu,\"suspended\":%d,\"errors\":%lu}",
+		(unsigned long)getCount(), (unsigned long)bytes, (unsigned long)files[LOG_ARCHIVE].count,
+		suspended, (unsigned long)appendErrors);
+	return n < 0 ? 0 : ((size_t)n < len ? n : len - 1);
+}
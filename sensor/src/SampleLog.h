@@ -0,0 +1,67 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Every published sample, kept in flash in binary form, so days
+			  of data can be pulled over USB at the depot or for calibration
+			  runs. Fixed size records in two files: the current one, and
+			  the previous one it was rotated to when full. Records of an
+			  older schema version are moved aside to an archive file
+			  after a firmware update, and kept until an export is acknowledged.
+*/
+
+#ifndef SAMPLE_LOG_H
+#define SAMPLE_LOG_H
+
+#include "Particle.h"
+#include "Settings.h"
+#include "Sample.h"
+
+class SampleLog {
+	public:
+		SampleLog();
+
+		void begin();
+		bool append(const Sample &sample);
+
+		// Reader, oldest record first. Records are in the layout of
+		// readVersion(), see SAMPLE_LAYOUTS.
+		void rewind();
+		uint8_t readVersion();
+		size_t read(uint8_t *record);
+		void exported();
+
+		uint32_t getCount();
+		size_t summary(char *buf, size_t len);
+
+	private:
+		// Log files, oldest first
+		enum LogFile {
+			LOG_ARCHIVE,
+			LOG_PREVIOUS,
+			LOG_CURRENT,
+			LOG_FILES
+		};
+
+		struct FileInfo {
+			uint8_t version;	// 0 when empty or unknown
+			uint32_t count;
+		};
+
+		static const char *path(uint8_t file);
+		static FileInfo inspect(uint8_t file);
+		bool keepPrevious();
+		void rotate();
+		bool nextFile();
+
+		int fd;
+		FileInfo files[LOG_FILES];
+		bool suspended;			// Older records waiting for an export, see begin()
+		uint32_t appendErrors;
+
+		int readFd;
+		uint8_t readFile;		// LogFile, LOG_FILES when done
+		uint32_t readLeft;		// Records left in readFile
+		bool readArchive;		// Archive was read to the end
+};
+
+#endif
@@ -0,0 +1,87 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   The one list of fields in a sample. Firmware struct, JSON and
+			  binary codecs are expanded from it, and tools/schema generates
+			  the server side validation and table from the same list.
+			  Only depends on stdint, so host tools can include it.
+*/
+
+#ifndef SAMPLE_SCHEMA_H
+#define SAMPLE_SCHEMA_H
+
+#include <stdint.h>
+
+// Bump when fields are added, removed, reordered or rescaled, first byte of
+// binary samples
+#define SAMPLE_SCHEMA_VERSION 4
+
+// How the server treats a field
+enum SampleKind {
+	SAMPLE_VALUE,	// Stored as is
+	SAMPLE_LEVEL,	// Stored, and averaged into levels sent back to the sensor
+	SAMPLE_TIME		// UTC epoch ms, primary key
+};
+
+// Bits of the flags field, set when a reading was taken before the sensor
+// had warmed up or settled
+#define SAMPLE_FLAG_PM_UNSETTLED	0x01
+#define SAMPLE_FLAG_CV_UNSETTLED	0x02	// VOC and CO2
+
+// X(name, type, decimals, kind, sql)
+// Values are stored as fixed point integers: value * 10^decimals. Drivers
+// return readings in these units, so a sample is never a float.
+#define SAMPLE_FIELDS(X) \
+	X(pm1,  uint16_t, 1, SAMPLE_LEVEL, "decimal(10,1) UNSIGNED DEFAULT NULL") \
+	X(pm25, uint16_t, 1, SAMPLE_LEVEL, "decimal(10,1) UNSIGNED DEFAULT NULL") \
+	X(pm4,  uint16_t, 1, SAMPLE_LEVEL, "decimal(10,1) UNSIGNED DEFAULT NULL") \
+	X(pm10, uint16_t, 1, SAMPLE_LEVEL, "decimal(10,1) UNSIGNED DEFAULT NULL") \
+	X(temp, int16_t,  2, SAMPLE_VALUE, "decimal(10,2) DEFAULT NULL") \
+	X(humi, uint16_t, 2, SAMPLE_VALUE, "decimal(10,2) UNSIGNED DEFAULT NULL") \
+	X(voc,  uint16_t, 0, SAMPLE_VALUE, "int UNSIGNED DEFAULT NULL") \
+	X(co2,  uint16_t, 0, SAMPLE_LEVEL, "int UNSIGNED DEFAULT NULL") \
+	X(lat,  int32_t,  7, SAMPLE_VALUE, "decimal(10,7) DEFAULT NULL") \
+	X(lng,  int32_t,  7, SAMPLE_VALUE, "decimal(10,7) DEFAULT NULL") \
+	X(batt, uint16_t, 3, SAMPLE_VALUE, "decimal(10,3) UNSIGNED DEFAULT NULL") \
+	X(flags, uint8_t, 0, SAMPLE_VALUE, "tinyint UNSIGNED NOT NULL DEFAULT 0") \
+	X(time, uint64_t, 0, SAMPLE_TIME,  "datetime(3) NOT NULL")
+
+// Earlier layouts that may still be in the sample log after a firmware
+// update, so it can be exported and decoded. When bumping the version,
+// copy the list here and add it to SAMPLE_LAYOUTS.
+#define SAMPLE_FIELDS_V2(X) \
+	X(pm1,  uint16_t, 1, SAMPLE_LEVEL, "") \
+	X(pm25, uint16_t, 1, SAMPLE_LEVEL, "") \
+	X(pm4,  uint16_t, 1, SAMPLE_LEVEL, "") \
+	X(pm10, uint16_t, 1, SAMPLE_LEVEL, "") \
+	X(temp, int16_t,  1, SAMPLE_VALUE, "") \
+	X(humi, uint16_t, 1, SAMPLE_VALUE, "") \
+	X(voc,  uint16_t, 0, SAMPLE_VALUE, "") \
+	X(co2,  uint16_t, 0, SAMPLE_LEVEL, "") \
+	X(lat,  int32_t,  6, SAMPLE_VALUE, "") \
+	X(lng,  int32_t,  6, SAMPLE_VALUE, "") \
+	X(flags, uint8_t, 0, SAMPLE_VALUE, "") \
+	X(time, uint64_t, 0, SAMPLE_TIME,  "")
+
+#define SAMPLE_FIELDS_V3(X) \
+	X(pm1,  uint16_t, 1, SAMPLE_LEVEL, "") \
+	X(pm25, uint16_t, 1, SAMPLE_LEVEL, "") \
+	X(pm4,  uint16_t, 1, SAMPLE_LEVEL, "") \
+	X(pm10, uint16_t, 1, SAMPLE_LEVEL, "") \
+	X(temp, int16_t,  2, SAMPLE_VALUE, "") \
+	X(humi, uint16_t, 2, SAMPLE_VALUE, "") \
+	X(voc,  uint16_t, 0, SAMPLE_VALUE, "") \
+	X(co2,  uint16_t, 0, SAMPLE_LEVEL, "") \
+	X(lat,  int32_t,  7, SAMPLE_VALUE, "") \
+	X(lng,  int32_t,  7, SAMPLE_VALUE, "") \
+	X(flags, uint8_t, 0, SAMPLE_VALUE, "") \
+	X(time, uint64_t, 0, SAMPLE_TIME,  "")
+
+// X(version, fields), every layout the log reader and decoder know.
+// Version 1 predates the sample log.
+#define SAMPLE_LAYOUTS(X) \
+	X(2, SAMPLE_FIELDS_V2) \
+	X(3, SAMPLE_FIELDS_V3) \
+	X(SAMPLE_SCHEMA_VERSION, SAMPLE_FIELDS)
+
+#endif
@@ -0,0 +1,102 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Event queue and deadline timers for the main loop
+*/
+
+#include "Scheduler.h"
+#include "Trace.h"
+
+Scheduler::Scheduler() {
+	wakeQueue = NULL;
+	pending = 0;
+	wakeups = 0;
+	memset(deadline, 0, sizeof(deadline));
+	memset(armed, 0, sizeof(armed));
+}
+
+void Scheduler::begin() {
+	os_queue_create(&wakeQueue, sizeof(uint8_t), EV_COUNT, NULL);
+}
+
+// Clears pending events and deadlines
+void Scheduler::reset() {
+	pending = 0;
+	memset(armed, 0, sizeof(armed));
+}
+
+// Marks event pending and wakes the main thread. Safe from any thread.
+// Posting an event that is already pending is a no-op, so events never
+// overwrite each other.
+void Scheduler::post(Event ev) {
+	if (ev >= EV_COUNT) return;
+	uint32_t bit = 1UL << ev;
+	if (pending.fetch_or(bit) & bit) return;
+
+	uint8_t token = ev;
+	if (wakeQueue != NULL) os_queue_put(wakeQueue, &token, 0, NULL);
+}
+
+// Posts event after delayMs. Replaces earlier deadline for same event.
+// Main thread only.
+void Scheduler::schedule(Event ev, system_tick_t delayMs) {
+	if (ev >= EV_COUNT) return;
+	deadline[ev] = millis() + delayMs;
+	armed[ev] = true;
+}
+
+void Scheduler::cancel(Event ev) {
+	if (ev >= EV_COUNT) return;
+	armed[ev] = false;
+	pending.fetch_and(~(1UL << ev));
+}
+
+bool Scheduler::isScheduled(Event ev) {
+	if (ev >= EV_COUNT) return false;
+	return armed[ev] || (pending.load() & (1UL << ev));
+}
+
+// Blocks until an event is pending and returns it. Returns at least every
+// SCHEDULER_MAX_WAIT_MS with EV_NONE, so loop() can return and Device OS
+// can run cloud callbacks on the application thread.
+Event Scheduler::wait() {
+	system_tick_t now = millis();
+	system_tick_t next = SCHEDULER_MAX_WAIT_MS;
+
+	// Drop old wake tokens, the pending bits are what counts. A post()
+	// after this point leaves a token, so the wait below returns at once.
+	uint8_t token;
+	while (os_queue_take(wakeQueue, &token, 0, NULL) == 0);
+
+	// Expired deadlines become pending
+	for (uint8_t i = 0; i < EV_COUNT; i++) {
+		if (!armed[i]) continue;
+		int32_t left = (int32_t)(deadline[i] - now);
+		if (left <= 0) {
+			armed[i] = false;
+			pending.fetch_or(1UL << i);
+		}
+		else if ((system_tick_t)left < next) {
+			next = left;
+		}
+	}
+
+	// Sleep until next deadline or post()
+	if (pending.load() == 0) {
+		os_queue_take(wakeQueue, &token, next, NULL);
+		wakeups++;
+		return EV_NONE;
+	}
+
+	// Highest priority pending event
+	uint32_t p = pending.load();
+	uint8_t ev = __builtin_ctz(p);
+	pending.fetch_and(~(1UL << ev));
+	TRACE(EVENT, ev);
+	return (Event)ev;
+}
+
+// Number of times the main thread has woken from waiting
+uint32_t Scheduler::getWakeups() {
+	return wakeups;
+}
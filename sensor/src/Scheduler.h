@@ -0,0 +1,59 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Event queue and deadline timers for the main loop. Events
+			  can be posted from any thread, and the main thread sleeps
+			  until the next event or deadline.
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "Particle.h"
+#include "Settings.h"
+
+#include <atomic>
+
+// Events, in priority order: when several are due, the lowest index is
+// handled first
+enum Event {
+	EV_IGNITION,	// Ignition changed
+	EV_SAMPLE,		// Take sample
+	EV_BURST,		// Burst capture sample
+	EV_BOOT,		// Poll sensors after ignition, until all are up
+	EV_WARMUP,		// Start sensors ahead of next sample
+	EV_PUBLISH,		// Queue sample for upload
+	EV_UPLOAD,		// Upload queued samples
+	EV_LEVELS,		// Request past levels from cloud
+	EV_RADIO,		// Radio session housekeeping
+	EV_LCD,			// BLE LCD housekeeping
+	EV_SENSORS,		// I2C sensor housekeeping
+	EV_EXPORT,		// Sample log export over USB
+	EV_TRACE,		// Drain trace log
+	EV_COUNT,
+	EV_NONE = EV_COUNT
+};
+
+class Scheduler {
+	public:
+		Scheduler();
+
+		void begin();
+		void reset();
+		void post(Event ev);
+		void schedule(Event ev, system_tick_t delayMs);
+		void cancel(Event ev);
+		bool isScheduled(Event ev);
+		Event wait();
+
+		uint32_t getWakeups();
+
+	private:
+		os_queue_t wakeQueue;
+		std::atomic<uint32_t> pending;
+		system_tick_t deadline[EV_COUNT];
+		bool armed[EV_COUNT];
+		uint32_t wakeups;
+};
+
+#endif
@@ -5,9 +5,13 @@
 */
 
 #include "Sen50.h"
+#include "Energy.h"
+#include "Trace.h"
+#include "SensorCrc.h"
 
 Sen50::Sen50() {
-	return;
+	started = false;
+	onTime = 0;
 }
 
 void Sen50::loop() {
@@ -18,17 +22,38 @@ void Sen50::on() {
     // Start measurement
 	uint8_t buf[] = { 0x00, 0x21 };
 	writeToDevice(buf, 2);
-	delay(50);
+
+	// No more commands until first result is due, see isReady()
+	started = true;
+	onTime = millis();
+	energy.set(ENERGY_SEN50, ENERGY_SEN50_MEASURING);
 }
 
 void Sen50::off() {
     // Stop measurement
 	uint8_t buf[] = { 0x01, 0x04 };
 	writeToDevice(buf, 2);
+	started = false;
+	energy.set(ENERGY_SEN50, ENERGY_SEN50_IDLE);
+}
+
+// First result is available about a second after start measurement
+bool Sen50::isReady() {
+	return started && millis() - onTime >= SEN50_STARTUP_MS;
 }
 
-// Returns samples in factor x10
-int8_t Sen50::getSample(float_t *pm) {
+// Fan at speed and PM readings stable
+bool Sen50::isSettled() {
+	return started && millis() - onTime >= SEN50_SETTLE_MS;
+}
+
+// Returns samples in 0.1 ug/m3, as the sensor sends them
+int8_t Sen50::getSample(uint16_t *pm) {
+	if (!isReady()) {
+		memset(pm, 0, 4 * sizeof(uint16_t));
+		return -1;
+	}
+
 	// Read measured values
 	uint8_t buf[] = { 0x03, 0xC4 };
 	writeToDevice(buf, 2);
@@ -39,10 +64,10 @@ int8_t Sen50::getSample(float_t *pm) {
 	readFromDevice(result, 24);
 
 	// Parse results
-	pm[0] = parseSample(result, 0) / 10.; // PM1
-	pm[1] = parseSample(result, 3) / 10.; // PM2.5
-	pm[2] = parseSample(result, 6) / 10.; // PM4
-	pm[3] = parseSample(result, 9) / 10.; // PM10
+	pm[0] = parseSample(result, 0); // PM1
+	pm[1] = parseSample(result, 3); // PM2.5
+	pm[2] = parseSample(result, 6); // PM4
+	pm[3] = parseSample(result, 9); // PM10
 
 	// Check for data error
 	if (pm[0] == 0 || pm[1] == 0 || pm[2] == 0 || pm[3] == 0) {
@@ -73,29 +98,10 @@ uint16_t Sen50::parseSample(uint8_t *buf, size_t offset) {
 	uint16_t result = (buf[offset] << 8) | buf[offset + 1];
 	
 	// Check CRC - return 0 on error
-	if (buf[offset+2] != calcCRC(result)) return 0;
+	if (buf[offset+2] != sensirionCrc8(buf + offset, 2, 0xFF)) {
+		TRACE(SENSOR_CRC, SEN50_ADR);
+		return 0;
+	}
 
 	return result;
-}
-
-// CRC for Sensirion SEN50
-uint8_t Sen50::calcCRC(uint16_t pm) {
-	// uint16_t to uint8_t[2] conversion
-	uint8_t data[2];
-	data[0] = (pm >> 8) & 0xFF;
-	data[1] = pm & 0xFF;
-
-	// Calc CRC
-    unsigned char crc = 0xFF;
-    for(int i = 0; i < 2; i++) {
-        crc ^= data[i];
-        for (unsigned char bit = 8; bit > 0; --bit) {
-            if(crc & 0x80) {
-                crc = (crc << 1) ^ 0x31u;
-            } else {
-                crc = (crc << 1);
-            }
-        }
-    }
-    return crc;
 }
\ No newline at end of file
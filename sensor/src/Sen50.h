@@ -10,6 +10,9 @@
 #include "Particle.h"
 #include "Settings.h"
 
+// Fan only runs ahead of samples when the interval leaves time to stop it
+#define SEN50_DUTY_CYCLE	(SAMPLE_INTERVAL_MS >= SEN50_SETTLE_MS + SEN50_MIN_OFF_MS)
+
 class Sen50 {
 	public:
 		Sen50();
@@ -17,13 +20,17 @@ class Sen50 {
 		void on();
 		void off();
 		void loop();
-		int8_t getSample(float_t *pm);
+		bool isReady();
+		bool isSettled();
+		int8_t getSample(uint16_t *pm);
 
 	private:
+		bool started;
+		system_tick_t onTime;
+
 		void writeToDevice(uint8_t *buf, size_t len);
 		void readFromDevice(uint8_t *buf, size_t len);
 		uint16_t parseSample(uint8_t *buf, size_t offset);
-		uint8_t calcCRC(uint16_t pm);
 };
 
 #endif
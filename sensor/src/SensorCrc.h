@@ -0,0 +1,37 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Checksums of the I2C sensors. Only depends on stdint, so host
+			  tools can include it.
+*/
+
+#ifndef SENSOR_CRC_H
+#define SENSOR_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-8, polynomial 0x31, MSB first. SEN50 starts at 0xFF, HTU31 at 0x00.
+inline uint8_t sensirionCrc8(const uint8_t *data, size_t len, uint8_t crc) {
+	for (size_t i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (uint8_t bit = 8; bit > 0; --bit) {
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x31u : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+// MiCS-VZ-89TE: complement of the sum with end-around carry
+// https://www.sgxsensortech.com/content/uploads/2017/03/I2C-Datasheet-MiCS-VZ-89TE-rev-H-ed170214-Read-Only.pdf
+inline uint8_t micsChecksum(const uint8_t *data, size_t len) {
+	uint16_t sum = 0;
+	for (size_t i = 0; i < len; i++) {
+		sum += data[i];
+	}
+	uint8_t crc = (uint8_t)sum;
+	crc += sum / 0x0100;
+	return 0xFF - crc;
+}
+
+#endif
@@ -13,6 +13,14 @@
 // Uncomment to enable debug mode
 #define AIRFLEET_DEBUG
 
+// Uncomment to enable binary trace log, see Trace.h. Cheap enough to leave on.
+#define AIRFLEET_TRACE
+#define TRACE_RECORDS             256     // RAM ring, power of 2, 36 bytes each
+#define TRACE_OUTPUT              TRACE_TO_FILE  // Or TRACE_TO_SERIAL
+#define TRACE_FILE                "/trace.bin"
+#define TRACE_FILE_MAX            262144  // Rotated to TRACE_FILE.old when full
+#define TRACE_DRAIN_MS            1000
+
 // Sample interval
 #define SAMPLE_INTERVAL_MS        5000
 
@@ -23,20 +31,112 @@
 // Request levels interval
 #define LEVELS_INTERVAL_MS        3600000
 
+// Samples waiting for upload
+#define JOURNAL_SIZE              16
+#define JOURNAL_RECORD_LEN        256
+
+// Radio session manager. Link is kept up between uploads when
+// idle current x time to next upload < connect current x connect time.
+#define RADIO_CONNECT_TIMEOUT_MS  30000
+#define RADIO_LEVELS_TIMEOUT_MS   15000
+#define RADIO_RETRY_MS            60000   // Back off after failed connect
+#define RADIO_CONNECT_COST_MS     8000    // Initial guess, measured after first connect
+#define RADIO_CONNECT_MA          200
+#define RADIO_IDLE_MA             60
+#define RADIO_LINGER_MARGIN_MS    5000
+#define RADIO_BATCH_MAX_AGE_MS    300000  // Max. time a sample waits for upload
+#define RADIO_POLL_MS             250     // Housekeeping while radio is on
+#define RADIO_IDLE_POLL_MS        5000    // Housekeeping while radio is off
+
+// Energy ledger, supply current per state in mA. WiFi uses RADIO_*_MA,
+// L86 the L86_*_MA currents.
+#define ENERGY_MCU_RUN_MA         30.
+#define ENERGY_MCU_SLEEP_MA       0.1     // Ultra low power sleep
+#define ENERGY_BLE_ACTIVE_MA      10.     // Scanning or connecting
+#define ENERGY_BLE_CONNECTED_MA   3.
+#define ENERGY_SEN50_MEASURING_MA 70.     // Fan running
+#define ENERGY_SEN50_IDLE_MA      2.6
+
+// Main loop scheduler
+#define SCHEDULER_MAX_WAIT_MS     250     // Max. time loop() blocks, for cloud callbacks
+#define SENSORS_POLL_MS           1000    // I2C sensor housekeeping
+#define BOOT_POLL_MS              10      // Sensor readiness after ignition
+#define BOOT_TIMEOUT_MS           5000    // Give up waiting for sensors, and publish
+
 // CO2 and PM scale for bar graph
 #define CO2_MIN                   400.
 #define CO2_MAX                   1000.
 #define PM_MIN                    0.
 #define PM_MAX                    5.
 
+// Rolling statistics of PM and CO2
+#define STATS_WINDOW              120     // Samples in min/max window
+#define STATS_EWMA_FAST_MS        60000   // Bar graph and alerts
+#define STATS_EWMA_MID_MS         900000
+#define STATS_EWMA_SLOW_MS        3600000
+#define STATS_ALERT_CLEAR         0.9     // Alert clears below this fraction of max
+
+// Cabin recirculation relay
+#define RECIRC_PIN                D5
+#define RECIRC_ACTIVE_LEVEL       HIGH    // Output level that closes the intake
+#define RECIRC_PM_ON              25.     // Close at max PM part, ug/m3
+#define RECIRC_PM_OFF             15.
+#define RECIRC_CO2_ON             1200.   // Close at CO2, ppm
+#define RECIRC_CO2_OFF            900.
+#define RECIRC_ALPHA              0.3     // Level smoothing, 1 = raw readings
+#define RECIRC_BETA               0.4     // Slope smoothing
+#define RECIRC_PREDICT_MS         15000   // Close if trend reaches on level within
+#define RECIRC_CONFIRM_SAMPLES    2       // Readings in a row that must call for closing
+#define RECIRC_MIN_HOLD_MS        30000   // Min. time closed before opening
+#define RECIRC_MAX_CLOSED_MS      900000  // Open for cabin fresh air after
+#define RECIRC_VENT_MS            60000
+
+// Hotspot map, historical levels per geohash cell
+#define HOTSPOT_FILE              "/hotspots.bin"
+#define HOTSPOT_MAX_CELLS         4096    // 8 bytes each in flash
+#define HOTSPOT_PAGE              24      // Cells per update from server, must match hotspots.php
+#define HOTSPOT_MERGE_CELLS       256     // Buffered in RAM during a sync, merged into flash when full or done
+#define HOTSPOT_SYNC_MS           21600000
+#define HOTSPOT_LOOKAHEAD_S       60      // Look this far ahead along the track
+
+// Log of published samples in flash, exported over USB by tools/journal_export
+#define SAMPLE_LOG_FILE           "/samples.bin"
+#define SAMPLE_LOG_MAX            524288  // Per file, two files are kept
+#define USB_EXPORT_POLL_MS        250     // Check USB serial for export command
+#define USB_EXPORT_SLICE_MS       50      // Max. time in loop() per pass while exporting
+
+// Burst capture around short exposure events, uploaded as airfleet_burst.
+// The SEN50 fan runs all trip while enabled.
+#define BURST_CAPTURE             1
+#define BURST_INTERVAL_MS         1000
+#define BURST_PRE_SAMPLES         30      // Kept before trigger
+#define BURST_POST_SAMPLES        30      // Captured after trigger
+#define BURST_PM_LEVEL            50.     // Trigger when max PM part rises above, ug/m3
+#define BURST_PM_RISE             20.     // or rises this much within BURST_RISE_SAMPLES
+#define BURST_CO2_LEVEL           2000    // ppm
+#define BURST_CO2_RISE            300
+#define BURST_RISE_SAMPLES        5
+#define BURST_HOLDOFF_MS          300000  // Min. time between triggers
+#define BURST_QUEUE               2       // Bursts held for upload, 2 kB each
+#define BURST_PART_SAMPLES        15      // Per publish
+
 // I2C speed
 #define I2C_SPEED                  CLOCK_SPEED_100KHZ
 
-// Ignition / battery-voltage
+// Ignition / battery-voltage. Ignition is on above IGNITION_ON_V and off below
+// IGNITION_OFF_V, e.g. 13.2 and 12.8 for a 12 V car that charges while running.
 #define VIN_REF_PIN                A5
 #define VIN_REF_FACTOR             16.5/4095.
 #define IGNITION_ON_V              0.
-#define IGNITION_CHECK_INTERVAL    15000
+#define IGNITION_OFF_V             0.
+#define IGNITION_DEBOUNCE_MS       5000    // Level must hold this long, rides through engine cranking
+#define IGNITION_CHECK_INTERVAL    15000   // Wakeup from sleep to check
+// Digital ignition sense, if wired, wakes at once. Must be a pin of its own,
+// not one of the I2C, L86 (RESET, FORCE_ON, PPS) or recirc pins.
+//#define IGNITION_WAKE_PIN          D6
+#define BATTERY_SAMPLE_MS          100
+#define BATTERY_OVERSAMPLE         8       // ADC reads per sample
+#define BATTERY_FILTER_SHIFT       3       // Low pass weight 1/8, about 0.8 s
 
 // BLE LCD
 #define BLE_LCD_SERVICE_UUID	   "46dec950-753c-44e3-abc3-bdfd08d63cfe"
@@ -44,23 +144,77 @@
 #define BLE_LCD_SET_CURSOR_UUID    "520be753-2bb6-455e-b449-558a4555687e"
 #define BLE_LCD_PRINT_UUID		   "520be753-2cc6-455e-b449-558a4555687e"
 #define BLE_LCD_FLASH_UUID		   "520be753-2dd6-455e-b449-558a4555687e"
+#define BLE_LCD_EEPROM_ADR         0        // Bonded display address
+#define BLE_LCD_DIRECT_ATTEMPTS    3        // Direct reconnects before scanning
+#define BLE_LCD_RETRY_MS           500
+#define BLE_LCD_SCAN_TIMEOUT       300      // x 10 ms
+#define BLE_LCD_CONN_INTERVAL      12       // x 1.25 ms
+#define BLE_LCD_CONN_TIMEOUT       200      // x 10 ms, supervision timeout
+#define BLE_LCD_IDLE_POLL_MS       1000     // Connection check while ready
+#define BLE_LCD_POLL_MS            20       // While connecting or pairing
 
 // HTU31 temperature and humidity sensor
 #define HTU31_ADR                   0x40
+#define HTU31_RESET_MS              15      // Soft reset time
 
 // L86 GPS module
 #define L86_RESET_PIN               D3
 #define L86_FORCEON_PIN             D2
 #define L86_SERIAL                  Serial1
 #define L86_BAUDRATE                115200
+#define L86_SERIAL_RX_BUFFER        64      // Size of UART RX buffer in Device OS
+#define L86_BOOT_TIMEOUT_MS         2000    // Max. wait for a valid sentence after reset or baud change
+#define L86_EEPROM_ADR              16      // Last fix, for hot start assistance
+#define L86_THREAD_PERIOD_MS        2       // UART drain interval
+#define L86_THREAD_PRIORITY         (OS_THREAD_PRIORITY_DEFAULT + 2)
+#define L86_THREAD_STACK_SIZE       2048
+#define L86_RING_SIZE               1024    // Power of 2
+#define L86_SENTENCE_LEN            128
+#define L86_FIX_INTERVAL_MS         200     // 5 Hz, L86 supports 100-10000
+#define L86_FIX_LATENCY_MS          50      // From fix to RMC sentence received
+//#define L86_PPS_PIN                 D4      // 1PPS output, if connected
+
+// Time base, millis() to GPS UTC
+#define TIMEBASE_STEP_MS            500     // Step instead of slew when off by more
+#define TIMEBASE_SLEW_DIV           4       // Correct 1/x of error per fix
+#define TIMEBASE_DRIFT_SPAN_MS      60000   // Measure millis() rate over this span
+#define TIMEBASE_MAX_DRIFT_PPM      500
+
+// GPS Kalman filter (variances in m^2, (m/s)^2 and (m/s^2)^2)
+#define GPS_FILTER_POS_VAR          9.
+#define GPS_FILTER_VEL_VAR          0.25
+#define GPS_FILTER_ACCEL_VAR        4.
+#define GPS_FILTER_MIN_COURSE_SPEED 2.      // km/t, below this course is ignored
+#define GPS_FILTER_RESET_S          5.      // Restart filter after gap in fixes
+#define GPS_FILTER_ORIGIN_M         10000.  // Move local plane origin after this
+#define GPS_FILTER_MAX_EXTRAPOLATE_MS 2000
 //#define L86_DEBUG_SPEED             36.
-#define L86_DISTANCE_BY_SPEED
-//#define L86_DISTANCE_BY_HAVERSINE
+#define L86_DISTANCE_KERNEL         DISTANCE_EQUIRECT // See Distance.h
+#define DISTANCE_STATIONARY_KMH     3.      // Below this, position jitter is ignored
+#define DISTANCE_JITTER_M           15.
+#define DISTANCE_SCALE_REFRESH_DEG  0.01    // Recompute equirect scale after moving this far N/S
+
+// L86 power modes: full tracking while moving, AlwaysLocate when stopped,
+// periodic standby when idling long. Currents from the L86 datasheet.
+#define L86_MOVING_KMH              5.      // Full tracking at or above this speed
+#define L86_ALWAYSLOCATE_AFTER_MS   30000   // Stopped this long: AlwaysLocate
+#define L86_PERIODIC_AFTER_MS       300000  // Stopped this long: periodic standby
+#define L86_PERIODIC_RUN_MS         5000    // Periodic: on time, 1000-518400000
+#define L86_PERIODIC_SLEEP_MS       25000   // Periodic: standby time, also max. delay to notice driving off
+#define L86_SLOW_FIX_INTERVAL_MS    1000    // Fix interval outside full tracking
+#define L86_FULL_MA                 20.
+#define L86_ALWAYSLOCATE_MA         3.
+#define L86_STANDBY_MA              1.
+#define L86_BACKUP_MA               0.007
 
 // MiCS CO2/VOC sensor
 #define MICS_ADR                    0x70
+#define MICS_WARMUP_MS              900000  // Heater warm-up after power up
 
 // Sensirion SEN50 particle sensor
 #define SEN50_ADR                   0x69
+#define SEN50_STARTUP_MS            1000    // From start measurement to first result
+#define SEN50_SETTLE_MS             10000   // From start measurement to stable PM readings
+#define SEN50_MIN_OFF_MS            10000   // Stop fan between samples if it can be off this long
 
 #endif
\ No newline at end of file
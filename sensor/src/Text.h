@@ -0,0 +1,127 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Fixed-capacity text buffer living on the stack, used instead
+			  of String in the sample path to avoid heap allocations
+*/
+
+#ifndef TEXT_H
+#define TEXT_H
+
+#include "Particle.h"
+
+// Read-only view of characters, not necessarily zero terminated
+struct TextSpan {
+	const char *data;
+	size_t len;
+
+	TextSpan() : data(""), len(0) {}
+	TextSpan(const char *str) : data(str), len(strlen(str)) {}
+	TextSpan(const char *str, size_t len) : data(str), len(len) {}
+
+	TextSpan sub(size_t offset, size_t count) const {
+		if (offset > len) offset = len;
+		if (count > len - offset) count = len - offset;
+		return TextSpan(data + offset, count);
+	}
+	bool operator==(const TextSpan &other) const {
+		return len == other.len && memcmp(data, other.data, len) == 0;
+	}
+	bool operator!=(const TextSpan &other) const {
+		return !(*this == other);
+	}
+};
+
+// Text with room for N characters + zero termination. Appends beyond
+// capacity are truncated.
+template <size_t N>
+class Text {
+	public:
+		Text() : len(0) {
+			buf[0] = 0;
+		}
+		Text(const char *str) : len(0) {
+			buf[0] = 0;
+			append(str);
+		}
+
+		void clear() {
+			len = 0;
+			buf[0] = 0;
+		}
+
+		Text &append(char c) {
+			if (len < N) buf[len++] = c;
+			buf[len] = 0;
+			return *this;
+		}
+		Text &append(const TextSpan &span) {
+			size_t n = span.len;
+			if (n > N - len) n = N - len;
+			memcpy(buf + len, span.data, n);
+			len += n;
+			buf[len] = 0;
+			return *this;
+		}
+		Text &append(const char *str) {
+			return append(TextSpan(str));
+		}
+		template <size_t M>
+		Text &append(const Text<M> &text) {
+			return append(text.span());
+		}
+
+		// Appends integer, right aligned to width
+		Text &appendInt(int32_t val, uint8_t width = 0) {
+			char tmp[12];
+			size_t n = 0;
+			uint32_t u = val < 0 ? (uint32_t)(-(val + 1)) + 1 : (uint32_t)val;
+			do {
+				tmp[n++] = '0' + (u % 10);
+				u /= 10;
+			} while (u > 0);
+			if (val < 0) tmp[n++] = '-';
+			while (width > n) {
+				append(' ');
+				width--;
+			}
+			while (n > 0) append(tmp[--n]);
+			return *this;
+		}
+
+		Text &appendUInt64(uint64_t val) {
+			char tmp[20];
+			size_t n = 0;
+			do {
+				tmp[n++] = '0' + (val % 10);
+				val /= 10;
+			} while (val > 0);
+			while (n > 0) append(tmp[--n]);
+			return *this;
+		}
+
+		const char *c_str() const {
+			return buf;
+		}
+		size_t length() const {
+			return len;
+		}
+		static constexpr size_t capacity() {
+			return N;
+		}
+		TextSpan span() const {
+			return TextSpan(buf, len);
+		}
+		TextSpan sub(size_t offset, size_t count) const {
+			return span().sub(offset, count);
+		}
+		operator TextSpan() const {
+			return span();
+		}
+
+	private:
+		char buf[N + 1];
+		size_t len;
+};
+
+#endif
@@ -0,0 +1,220 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Maps millis() to GPS UTC as epoch milliseconds
+*/
+
+#include "TimeBase.h"
+
+// Shared instance, disciplined by the GPS thread
+TimeBase timeBase;
+
+volatile system_tick_t TimeBase::ppsMillis = 0;
+volatile uint32_t TimeBase::ppsCount = 0;
+
+TimeBase::TimeBase() {
+	anchor.synced = false;
+	anchor.utcMs = 0;
+	anchor.millis = 0;
+	anchor.driftPpm = 0;
+	anchorSeq = 0;
+	driftUtcMs = 0;
+	driftMillis = 0;
+}
+
+void TimeBase::begin() {
+#ifdef L86_PPS_PIN
+	pinMode(L86_PPS_PIN, INPUT);
+	attachInterrupt(L86_PPS_PIN, ppsInterrupt, RISING);
+#endif
+}
+
+// Rising edge of 1PPS marks the start of a UTC second
+void TimeBase::ppsInterrupt() {
+	ppsMillis = millis();
+	ppsCount++;
+}
+
+// Main thread: keeps system clock in line with GPS time
+void TimeBase::loop() {
+	if (!isSynced()) return;
+
+	time_t utc = (time_t)(now() / 1000);
+	if (!Time.isValid() || abs((int32_t)(Time.now() - utc)) > 1) {
+		Time.setTime(utc);
+
+#ifdef AIRFLEET_DEBUG
+		Log.info("TIME system clock set from GPS");
+#endif
+	}
+}
+
+// GPS thread: called with UTC of a fix and the millis() its sentence arrived
+void TimeBase::discipline(uint64_t utcMs, system_tick_t arrivalMillis) {
+	if (utcMs == 0) return;
+
+	// Local time of the fix. 1PPS is exact when the fix is on a whole second.
+	system_tick_t local = arrivalMillis - L86_FIX_LATENCY_MS;
+	system_tick_t pps = ppsMillis;
+	if (utcMs % 1000 == 0 && ppsCount > 0 && arrivalMillis - pps < 1000) local = pps;
+
+	Anchor a;
+	getAnchor(&a);
+
+	if (!a.synced) {
+		a.synced = true;
+		a.utcMs = utcMs;
+		a.millis = local;
+		a.driftPpm = 0;
+		driftUtcMs = utcMs;
+		driftMillis = local;
+		setAnchor(&a);
+		return;
+	}
+
+	// Slew towards measured time, step if too far off
+	int64_t error = (int64_t)utcMs - (int64_t)project(&a, local);
+	if (error > TIMEBASE_STEP_MS || error < -TIMEBASE_STEP_MS) {
+		a.utcMs = utcMs;
+		driftUtcMs = utcMs;
+		driftMillis = local;
+	}
+	else {
+		a.utcMs = project(&a, local) + error / TIMEBASE_SLEW_DIV;
+	}
+	a.millis = local;
+
+	// Rate of millis() against UTC, measured over long intervals
+	system_tick_t span = local - driftMillis;
+	if (span >= TIMEBASE_DRIFT_SPAN_MS) {
+		int64_t diff = (int64_t)(utcMs - driftUtcMs) - (int64_t)span;
+		int32_t ppm = (int32_t)(diff * 1000000 / span);
+		if (ppm > TIMEBASE_MAX_DRIFT_PPM) ppm = TIMEBASE_MAX_DRIFT_PPM;
+		if (ppm < -TIMEBASE_MAX_DRIFT_PPM) ppm = -TIMEBASE_MAX_DRIFT_PPM;
+		a.driftPpm = (3 * a.driftPpm + ppm) / 4;
+		driftUtcMs = utcMs;
+		driftMillis = local;
+	}
+
+	setAnchor(&a);
+}
+
+bool TimeBase::isSynced() {
+	Anchor a;
+	getAnchor(&a);
+	return a.synced;
+}
+
+// UTC epoch ms at given millis(), 0 if not synced
+uint64_t TimeBase::toUtc(system_tick_t millis) {
+	Anchor a;
+	getAnchor(&a);
+	if (!a.synced) return 0;
+	return project(&a, millis);
+}
+
+// millis() at given UTC epoch ms, 0 if not synced
+system_tick_t TimeBase::toMillis(uint64_t utcMs) {
+	Anchor a;
+	getAnchor(&a);
+	if (!a.synced) return 0;
+	int64_t delta = (int64_t)utcMs - (int64_t)a.utcMs;
+	delta -= delta * a.driftPpm / 1000000;
+	return a.millis + (int32_t)delta;
+}
+
+uint64_t TimeBase::now() {
+	return toUtc(millis());
+}
+
+int32_t TimeBase::getDriftPpm() {
+	Anchor a;
+	getAnchor(&a);
+	return a.driftPpm;
+}
+
+uint32_t TimeBase::getPpsCount() {
+	return ppsCount;
+}
+
+uint64_t TimeBase::project(const Anchor *a, system_tick_t millis) {
+	int32_t elapsed = (int32_t)(millis - a->millis);
+	return a->utcMs + elapsed + (int64_t)elapsed * a->driftPpm / 1000000;
+}
+
+// Sequence lock, same scheme as L86 fix snapshots
+void TimeBase::getAnchor(Anchor *out) {
+	uint32_t seq;
+	do {
+		seq = anchorSeq.load(std::memory_order_acquire);
+		if (seq & 1) continue;
+		*out = anchor;
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((seq & 1) || seq != anchorSeq.load(std::memory_order_relaxed));
+}
+
+void TimeBase::setAnchor(const Anchor *in) {
+	uint32_t seq = anchorSeq.load(std::memory_order_relaxed);
+	anchorSeq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	anchor = *in;
+	std::atomic_thread_fence(std::memory_order_release);
+	anchorSeq.store(seq + 2, std::memory_order_release);
+}
+
+// Epoch ms from UTC date. Days from civil algorithm:
+// Ref: https://howardhinnant.github.io/date_algorithms.html#days_from_civil
+uint64_t TimeBase::epochMs(uint16_t year, uint8_t month, uint8_t day, uint32_t timeOfDayMs) {
+	int32_t y = year - (month <= 2);
+	int32_t era = y / 400;
+	uint32_t yoe = y - era * 400;
+	uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	int32_t days = era * 146097 + (int32_t)doe - 719468;
+	return (uint64_t)days * 86400000ULL + timeOfDayMs;
+}
+
+// Civil from days, inverse of epochMs()
+void TimeBase::civil(uint64_t utcMs, int32_t *year, uint8_t *month, uint8_t *day, uint32_t *secOfDay) {
+	int32_t days = utcMs / 86400000ULL;
+	*secOfDay = (utcMs % 86400000ULL) / 1000;
+	days += 719468;
+	int32_t era = days / 146097;
+	uint32_t doe = days - era * 146097;
+	uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	uint32_t mp = (5 * doy + 2) / 153;
+	*day = doy - (153 * mp + 2) / 5 + 1;
+	*month = mp < 10 ? mp + 3 : mp - 9;
+	*year = yoe + era * 400 + (*month <= 2);
+}
+
+// Formats yyyy-mm-dd hh:mm:ss
+void TimeBase::format(uint64_t utcMs, DateTimeText *text) {
+	int32_t year;
+	uint8_t month, day;
+	uint32_t sec;
+	civil(utcMs, &year, &month, &day, &sec);
+
+	text->clear();
+	text->appendInt(year).append('-');
+	if (month < 10) text->append('0');
+	text->appendInt(month).append('-');
+	if (day < 10) text->append('0');
+	text->appendInt(day).append(' ');
+	ClockText clock;
+	formatClock(utcMs, &clock);
+	text->append(clock).append(':');
+	if (sec % 60 < 10) text->append('0');
+	text->appendInt(sec % 60);
+}
+
+// Formats hh:mm
+void TimeBase::formatClock(uint64_t utcMs, ClockText *text) {
+	uint32_t min = (utcMs % 86400000ULL) / 60000;
+	text->clear();
+	if (min / 60 < 10) text->append('0');
+	text->appendInt(min / 60).append(':');
+	if (min % 60 < 10) text->append('0');
+	text->appendInt(min % 60);
+}
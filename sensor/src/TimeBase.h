@@ -0,0 +1,71 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Maps millis() to GPS UTC as epoch milliseconds. Disciplined
+			  by RMC sentences, or by the L86 1PPS output when connected.
+			  Timestamps are kept as integers and only formatted for display
+			  and logging.
+*/
+
+#ifndef TIME_BASE_H
+#define TIME_BASE_H
+
+#include "Particle.h"
+#include "Settings.h"
+#include "Text.h"
+
+#include <atomic>
+
+// yyyy-mm-dd hh:mm:ss
+typedef Text<19> DateTimeText;
+
+// hh:mm
+typedef Text<5> ClockText;
+
+class TimeBase {
+	public:
+		TimeBase();
+
+		void begin();
+		void loop();
+		void discipline(uint64_t utcMs, system_tick_t arrivalMillis);
+		bool isSynced();
+		uint64_t toUtc(system_tick_t millis);
+		system_tick_t toMillis(uint64_t utcMs);
+		uint64_t now();
+		int32_t getDriftPpm();
+		uint32_t getPpsCount();
+
+		static uint64_t epochMs(uint16_t year, uint8_t month, uint8_t day, uint32_t timeOfDayMs);
+		static void civil(uint64_t utcMs, int32_t *year, uint8_t *month, uint8_t *day, uint32_t *secOfDay);
+		static void format(uint64_t utcMs, DateTimeText *text);
+		static void formatClock(uint64_t utcMs, ClockText *text);
+
+	private:
+		struct Anchor {
+			bool synced;
+			uint64_t utcMs;			// UTC at anchor
+			system_tick_t millis;	// millis() at anchor
+			int32_t driftPpm;		// millis() rate error against UTC
+		};
+
+		void getAnchor(Anchor *out);
+		void setAnchor(const Anchor *in);
+		static uint64_t project(const Anchor *a, system_tick_t millis);
+		static void ppsInterrupt();
+
+		// Written by GPS thread, read by any thread through a sequence lock
+		Anchor anchor;
+		std::atomic<uint32_t> anchorSeq;
+
+		// GPS thread only: anchor used for drift measurement
+		uint64_t driftUtcMs;
+		system_tick_t driftMillis;
+
+		static volatile system_tick_t ppsMillis;
+		static volatile uint32_t ppsCount;
+};
+
+extern TimeBase timeBase;
+
+#endif
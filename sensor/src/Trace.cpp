@@ -0,0 +1,168 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Binary trace log
+*/
+
+#include "Trace.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define TRACE_MASK		(TRACE_RECORDS - 1)
+#define TRACE_OLD_FILE	TRACE_FILE ".old"
+
+static_assert((TRACE_RECORDS & TRACE_MASK) == 0, "TRACE_RECORDS must be a power of 2");
+
+TraceLog traceLog;
+
+TraceLog::TraceLog() : head(0) {
+	for (size_t i = 0; i < TRACE_RECORDS; i++) slots[i].seq.store(0, std::memory_order_relaxed);
+	tail = 0;
+	drained = 0;
+	lost = 0;
+	pendingLost = 0;
+	fd = -1;
+	fileBytes = 0;
+}
+
+// Opens trace file, appending to what the last ignition left
+void TraceLog::begin() {
+#if TRACE_OUTPUT == TRACE_TO_FILE
+	fd = open(TRACE_FILE, O_WRONLY | O_CREAT | O_APPEND, 0666);
+	if (fd >= 0) fileBytes = lseek(fd, 0, SEEK_END);
+#endif
+}
+
+// Any thread. Claims the next slot, so writers never wait for each other or
+// for the drain. When the ring is full the oldest record is overwritten.
+void TraceLog::write(uint8_t event, const uint32_t *args, uint8_t argc) {
+	uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+	Slot &slot = slots[index & TRACE_MASK];
+
+	slot.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.us = micros();
+	slot.event = event;
+	slot.argc = argc;
+	for (uint8_t i = 0; i < argc; i++) slot.args[i] = args[i];
+	slot.seq.store(index + 1, std::memory_order_release);
+}
+
+size_t TraceLog::encode(const Slot &slot, uint8_t *buf) {
+	size_t len = 0;
+	buf[len++] = TRACE_SYNC;
+	buf[len++] = slot.event;
+	buf[len++] = slot.argc;
+	memcpy(buf + len, &slot.us, sizeof(slot.us));
+	len += sizeof(slot.us);
+	memcpy(buf + len, slot.args, slot.argc * sizeof(uint32_t));
+	len += slot.argc * sizeof(uint32_t);
+
+	uint8_t sum = 0;
+	for (size_t i = 0; i < len; i++) sum += buf[i];
+	buf[len++] = sum;
+	return len;
+}
+
+// Writes to the trace output without blocking. Returns false if it can't
+// take the whole record now.
+bool TraceLog::output(const uint8_t *buf, size_t len) {
+#if TRACE_OUTPUT == TRACE_TO_FILE
+	if (fd < 0) return false;
+
+	// Keep the previous file, so there is always at least TRACE_FILE_MAX of history
+	if (fileBytes + len > TRACE_FILE_MAX) {
+		close(fd);
+		rename(TRACE_FILE, TRACE_OLD_FILE);
+		fd = open(TRACE_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		fileBytes = 0;
+		if (fd < 0) return false;
+	}
+	if (::write(fd, buf, len) != (ssize_t)len) return false;
+	fileBytes += len;
+	return true;
+#else
+	if (!Serial.isConnected() || Serial.availableForWrite() < (int)len) return false;
+	Serial.write(buf, len);
+	return true;
+#endif
+}
+
+// Main thread: moves completed records to the trace output, oldest first.
+// The file is synced after each drain that wrote to it, so a sleep or a
+// brown-out keeps it. Returns number of records written.
+size_t TraceLog::drain() {
+	uint8_t buf[TRACE_HEADER_LEN + TRACE_MAX_ARGS * sizeof(uint32_t) + 1];
+	size_t count = 0;
+	bool wrote = false;
+
+	// Writers lapped us, skip to the oldest record still in the ring
+	uint32_t h = head.load(std::memory_order_acquire);
+	if (h - tail > TRACE_RECORDS) {
+		lost += h - tail - TRACE_RECORDS;
+		pendingLost += h - tail - TRACE_RECORDS;
+		tail = h - TRACE_RECORDS;
+	}
+
+	if (pendingLost > 0) {
+		Slot note;
+		note.us = micros();
+		note.event = TRACE_LOST;
+		note.argc = 1;
+		note.args[0] = pendingLost;
+		if (!output(buf, encode(note, buf))) return 0;
+		pendingLost = 0;
+		wrote = true;
+	}
+
+	while (tail != h) {
+		Slot &slot = slots[tail & TRACE_MASK];
+		uint32_t seq = slot.seq.load(std::memory_order_acquire);
+		if (seq != tail + 1) {
+			// Still being written
+			if ((int32_t)(seq - (tail + 1)) < 0) break;
+
+			// Overwritten by a newer record
+			lost++;
+			pendingLost++;
+			tail++;
+			continue;
+		}
+
+		Slot copy;
+		copy.us = slot.us;
+		copy.event = slot.event;
+		copy.argc = slot.argc < TRACE_MAX_ARGS ? slot.argc : TRACE_MAX_ARGS;
+		memcpy(copy.args, slot.args, copy.argc * sizeof(uint32_t));
+
+		// Overwritten while copying
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.seq.load(std::memory_order_relaxed) != seq) {
+			lost++;
+			pendingLost++;
+			tail++;
+			continue;
+		}
+
+		if (!output(buf, encode(copy, buf))) break;
+		tail++;
+		drained++;
+		count++;
+		wrote = true;
+	}
+
+#if TRACE_OUTPUT == TRACE_TO_FILE
+	if (wrote && fd >= 0) fsync(fd);
+#else
+	(void)wrote;
+#endif
+	return count;
+}
+
+size_t TraceLog::summary(char *buf, size_t len) {
+	int n = snprintf(buf, len,
+		"{\"written\":%lu,\"drained\":%lu,\"lost\":%lu,\"fileBytes\":%lu}",
+		head.load(std::memory_order_relaxed), drained, lost, fileBytes);
+	return n < 0 ? 0 : ((size_t)n < len ? n : len - 1);
+}
@@ -0,0 +1,88 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Binary trace log. TRACE() stores an event ID, micros() and the
+			  raw arguments in a lock-free RAM ring, from any thread or timer
+			  callback, in about the time of a few stores. Nothing is
+			  formatted on the device: the main loop drains the ring to USB
+			  serial or flash, and tools/trace_decode turns it into text or a
+			  timeline. Events are listed in TraceEvents.h.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "Particle.h"
+#include "Settings.h"
+#include "TraceEvents.h"
+
+#include <atomic>
+
+// Trace output
+#define TRACE_TO_SERIAL		0
+#define TRACE_TO_FILE		1
+
+class TraceLog {
+	public:
+		TraceLog();
+
+		void begin();
+
+		// Use TRACE(), which compiles away without AIRFLEET_TRACE
+		template <TraceEvent event, typename... Args>
+		void log(Args... args) {
+			static_assert(sizeof...(args) == traceArgCount(traceFormats[event]),
+				"TRACE() arguments do not match format in TraceEvents.h");
+			const uint32_t raw[] = { arg(args)..., 0 };
+			write(event, raw, sizeof...(args));
+		}
+
+		size_t drain();
+		size_t summary(char *buf, size_t len);
+
+	private:
+		struct Slot {
+			std::atomic<uint32_t> seq;		// Record number + 1 when written, 0 while writing
+			uint32_t us;
+			uint8_t event;
+			uint8_t argc;
+			uint32_t args[TRACE_MAX_ARGS];
+		};
+
+		static uint32_t arg(float value) {
+			uint32_t raw;
+			memcpy(&raw, &value, sizeof(raw));
+			return raw;
+		}
+		static uint32_t arg(double value) {
+			return arg((float)value);
+		}
+		template <typename T>
+		static uint32_t arg(T value) {
+			return (uint32_t)value;
+		}
+
+		void write(uint8_t event, const uint32_t *args, uint8_t argc);
+		static size_t encode(const Slot &slot, uint8_t *buf);
+		bool output(const uint8_t *buf, size_t len);
+
+		Slot slots[TRACE_RECORDS];
+		std::atomic<uint32_t> head;		// Records claimed by writers
+		uint32_t tail;					// Next record to drain
+		uint32_t drained;
+		uint32_t lost;					// Overwritten before they were drained
+		uint32_t pendingLost;			// Lost, not yet reported in the stream
+
+		int fd;
+		uint32_t fileBytes;
+};
+
+extern TraceLog traceLog;
+
+#ifdef AIRFLEET_TRACE
+#define TRACE(event, ...)	traceLog.log<TRACE_##event>(__VA_ARGS__)
+#else
+#define TRACE(event, ...)	((void)0)
+#endif
+
+#endif
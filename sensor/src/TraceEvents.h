@@ -0,0 +1,90 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Trace events, shared by the firmware and the host decoder.
+
+			  X(name, track, format)
+
+			  name:    event, TRACE_<name> in firmware
+			  track:   events on a named track are spans, each lasting until
+			           the next event on the same track. "" for instant events.
+			  format:  printf format for the raw arguments, formatted by the
+			           decoder only. %d, %u, %x take 32 bit integers, %f a
+			           float, %.Nq a fixed point integer with N decimals. No
+			           strings, at most TRACE_MAX_ARGS arguments.
+
+			  Add new events at the end, so old traces still decode.
+*/
+
+#ifndef TRACE_EVENTS_H
+#define TRACE_EVENTS_H
+
+#include <stdint.h>
+
+#define TRACE_EVENTS(X) \
+	X(START,          "",      "unix time %u, millis %u") \
+	X(LOST,           "",      "%u records lost") \
+	X(STATE,          "state", "state %u") \
+	X(EVENT,          "",      "event %u") \
+	X(SAMPLE_PM_FLOAT, "",     "PM1: %.1f, PM2.5: %.1f, PM4: %.1f, PM10: %.1f") \
+	X(SAMPLE_TH_FLOAT, "",     "temperature: %.1f, humidity: %.1f") \
+	X(SAMPLE_CV,      "",      "VOC: %u, CO2: %u") \
+	X(SAMPLE_GPS_FLOAT, "",    "lat: %f, lng: %f, speed: %.1f, km: %.3f") \
+	X(SAMPLE_ERR,     "",      "results pm: %u, th: %u, cv: %u, gps: %u") \
+	X(BATTERY_FLOAT,  "",      "battery: %.1fV") \
+	X(SENSOR_CRC,     "",      "CRC error on I2C address 0x%x") \
+	X(GPS_FIX,        "",      "valid: %d, lat: %f, lng: %f, speed: %.1f, course: %.1f") \
+	X(GPS_CMD,        "",      "$PMTK%u sent, checksum %x") \
+	X(GPS_CRC,        "",      "NMEA CRC error, %u so far") \
+	X(GPS_MODE,       "gps",   "power mode %u") \
+	X(GPS_TTFF,       "",      "first fix after %u ms") \
+	X(BLE_STATE,      "ble",   "state %u") \
+	X(BLE_DIRECT_FAIL, "",     "direct connect failed (%u)") \
+	X(BLE_RESTORE,    "",      "restored print: %u, flash: %u") \
+	X(BLE_FIRST_FRAME, "",     "first frame after %u ms") \
+	X(SAMPLE_PM,      "",      "PM1: %.1q, PM2.5: %.1q, PM4: %.1q, PM10: %.1q") \
+	X(SAMPLE_TH,      "",      "temperature: %.2q, humidity: %.2q") \
+	X(SAMPLE_GPS,     "",      "lat: %.7q, lng: %.7q, speed: %.1q, km: %.3q") \
+	X(BATTERY,        "",      "battery: %.3qV") \
+	X(IGNITION,       "",      "ignition %u at %.3qV")
+
+#define TRACE_ENUM(name, track, format) TRACE_##name,
+enum TraceEvent : uint8_t {
+	TRACE_EVENTS(TRACE_ENUM)
+	TRACE_EVENT_COUNT
+};
+#undef TRACE_ENUM
+
+#define TRACE_MAX_ARGS	6
+
+// Arguments taken by a format, checked against each TRACE() at compile time
+constexpr uint8_t traceArgCount(const char *format) {
+	uint8_t count = 0;
+	for (const char *c = format; *c; c++) {
+		if (*c != '%') continue;
+		if (c[1] == '%') c++;
+		else count++;
+	}
+	return count;
+}
+
+#define TRACE_FORMAT(name, track, format) format,
+constexpr const char *traceFormats[] = { TRACE_EVENTS(TRACE_FORMAT) };
+#undef TRACE_FORMAT
+
+/*
+	Stream format, little endian. Records start with a sync byte, so the
+	decoder can find them between log text on USB serial, and end with the
+	sum of the preceding bytes.
+
+	uint8_t   TRACE_SYNC
+	uint8_t   event
+	uint8_t   argument count
+	uint32_t  micros()
+	uint32_t  arguments[count]
+	uint8_t   checksum
+*/
+#define TRACE_SYNC		0xA5
+#define TRACE_HEADER_LEN	7
+
+#endif
@@ -0,0 +1,162 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Bulk export of the sample log over USB serial
+*/
+
+#include "UsbExport.h"
+
+UsbExport::UsbExport(SampleLog &log) : log(log) {
+	mode = EXPORT_IDLE;
+	lineLen = 0;
+	fromMs = 0;
+	toMs = 0;
+	skip = 0;
+	index = 0;
+	version = 0;
+	benchLeft = 0;
+	bytes = 0;
+	startedAt = 0;
+	ackWanted = false;
+	ackIndex = 0;
+	exports = 0;
+	lastBytes = 0;
+	lastMs = 0;
+}
+
+// Reads commands, and sends chunks for up to USB_EXPORT_SLICE_MS. Returns
+// true while an export is running, so the caller comes back at once.
+bool UsbExport::loop() {
+	while (Serial.available() > 0) {
+		int c = Serial.read();
+		if (c == '\r' || c == '\n') {
+			line[lineLen] = 0;
+			if (lineLen > 0) command(line);
+			lineLen = 0;
+		}
+		else if (lineLen < sizeof(line) - 1) {
+			line[lineLen++] = (char)c;
+		}
+	}
+
+	system_tick_t start = millis();
+	while (mode != EXPORT_IDLE && millis() - start < USB_EXPORT_SLICE_MS) {
+		if (!Serial.isConnected()) {
+			finish();
+			break;
+		}
+		sendChunk();
+	}
+	return mode != EXPORT_IDLE;
+}
+
+// A new command replaces a running export, which is how the host resumes
+void UsbExport::command(const char *str) {
+	char *end;
+	if (strncmp(str, "AFK ", 4) == 0) {
+		// Host has every record, so those kept from before an update can go
+		uint32_t acked = strtoul(str + 4, &end, 10);
+		if (ackWanted && acked >= ackIndex) log.exported();
+		ackWanted = false;
+		return;
+	}
+
+	ackWanted = false;
+	if (strncmp(str, "AFX ", 4) == 0) {
+		fromMs = strtoull(str + 4, &end, 10);
+		toMs = strtoull(end, &end, 10);
+		skip = strtoul(end, &end, 10);
+		index = 0;
+		log.rewind();
+		mode = EXPORT_SAMPLES;
+
+		// Layout of the oldest record, which may be from before an update
+		version = log.readVersion();
+		if (version == 0) version = SAMPLE_SCHEMA_VERSION;
+		uint8_t *payload = frame + EXPORT_HEADER_LEN;
+		payload[0] = version;
+		payload[1] = sampleBinaryLen(version);
+		bytes = 0;
+		startedAt = millis();
+		sendFrame(EXPORT_HEADER, skip, 2);
+	}
+	else if (strncmp(str, "AFB ", 4) == 0) {
+		benchLeft = strtoul(str + 4, &end, 10);
+		index = 0;
+		mode = EXPORT_BENCH;
+		memset(frame + EXPORT_HEADER_LEN, 0x55, EXPORT_MAX_PAYLOAD);
+		bytes = 0;
+		startedAt = millis();
+	}
+}
+
+// Next DATA frame, or END when there is nothing left
+void UsbExport::sendChunk() {
+	uint8_t *payload = frame + EXPORT_HEADER_LEN;
+	size_t len = 0;
+
+	if (mode == EXPORT_BENCH) {
+		if (benchLeft == 0) {
+			sendFrame(EXPORT_END, index, 0);
+			finish();
+			return;
+		}
+		len = benchLeft < EXPORT_MAX_PAYLOAD ? benchLeft : EXPORT_MAX_PAYLOAD;
+		sendFrame(EXPORT_DATA, index, len);
+		index += len;
+		benchLeft -= len;
+		return;
+	}
+
+	// New layout from here on, a DATA frame only holds one
+	uint8_t next = log.readVersion();
+	if (next != 0 && next != version) {
+		version = next;
+		payload[0] = version;
+		payload[1] = sampleBinaryLen(version);
+		sendFrame(EXPORT_HEADER, index < skip ? skip : index, 2);
+		return;
+	}
+
+	uint32_t first = 0;
+	size_t recordLen = sampleBinaryLen(version);
+	Sample sample;
+	while (len + recordLen <= EXPORT_MAX_PAYLOAD && log.readVersion() == version && log.read(payload + len)) {
+		if (!sampleDecodeAny(payload + len, recordLen, &sample)) continue;
+		if (sample.time < fromMs || (toMs != 0 && sample.time >= toMs)) continue;
+		if (index++ < skip) continue;
+		if (len == 0) first = index - 1;
+		len += recordLen;
+	}
+
+	if (len > 0) {
+		sendFrame(EXPORT_DATA, first, len);
+	}
+	else {
+		sendFrame(EXPORT_END, index, 0);
+		ackWanted = fromMs == 0 && toMs == 0;
+		ackIndex = index;
+		finish();
+	}
+}
+
+// Frame around payload already in place after the header
+void UsbExport::sendFrame(uint8_t type, uint32_t index, uint16_t len) {
+	size_t n = exportFrame(type, index, frame + EXPORT_HEADER_LEN, len, frame);
+	Serial.write(frame, n);
+	bytes += n;
+}
+
+void UsbExport::finish() {
+	mode = EXPORT_IDLE;
+	exports++;
+	lastBytes = bytes;
+	lastMs = millis() - startedAt;
+}
+
+size_t UsbExport::summary(char *buf, size_t len) {
+	int n = snprintf(buf, len, "{\"exports\":%lu,\"bytes\":%lu,\"ms\":%lu,\"kBps\":%lu}",
+		(unsigned long)exports, (unsigned long)lastBytes, (unsigned long)lastMs,
+		(unsigned long)(lastMs > 0 ? lastBytes / lastMs : 0));
+	return n < 0 ? 0 : ((size_t)n < len ? n : len - 1);
+}
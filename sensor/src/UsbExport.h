@@ -0,0 +1,67 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Bulk export of the sample log over USB serial, at USB speed
+			  instead of one publish per second. Framed with a CRC per chunk,
+			  so the host can resume from the last good record after an
+			  error. Protocol in ExportProtocol.h, host side in
+			  tools/journal_export.
+*/
+
+#ifndef USB_EXPORT_H
+#define USB_EXPORT_H
+
+#include "Particle.h"
+#include "Settings.h"
+#include "SampleLog.h"
+#include "ExportProtocol.h"
+
+class UsbExport {
+	public:
+		UsbExport(SampleLog &log);
+
+		bool loop();
+		size_t summary(char *buf, size_t len);
+
+	private:
+		enum Mode {
+			EXPORT_IDLE,
+			EXPORT_SAMPLES,
+			EXPORT_BENCH
+		};
+
+		void command(const char *str);
+		void sendChunk();
+		void sendFrame(uint8_t type, uint32_t index, uint16_t len);
+		void finish();
+
+		SampleLog &log;
+		Mode mode;
+
+		// Command line from host
+		char line[64];
+		size_t lineLen;
+
+		// Current export
+		uint64_t fromMs;
+		uint64_t toMs;			// 0 = open end
+		uint32_t skip;
+		uint32_t index;			// Records in range seen so far
+		uint8_t version;		// Schema version of records being sent
+		uint32_t benchLeft;		// Bytes
+		uint32_t bytes;
+		system_tick_t startedAt;
+
+		// Whole log sent, waiting for the host's AFK before anything is deleted
+		bool ackWanted;
+		uint32_t ackIndex;
+
+		uint8_t frame[EXPORT_HEADER_LEN + EXPORT_MAX_PAYLOAD + EXPORT_CRC_LEN];
+
+		// Last finished export
+		uint32_t exports;
+		uint32_t lastBytes;
+		system_tick_t lastMs;
+};
+
+#endif
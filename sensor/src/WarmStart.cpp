@@ -0,0 +1,68 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Hot state kept in retained SRAM
+*/
+
+#include "WarmStart.h"
+#include "Crc32.h"
+
+#define WARM_STATE_MAGIC	0x57524D31	// "WRM1"
+
+// No initialiser, so startup code leaves it alone after a reset
+retained WarmState warmState;
+
+WarmStart warmStart;
+
+WarmStart::WarmStart() {
+	warm = false;
+	saves = 0;
+}
+
+// setup(): true if retained state survived, otherwise it is cleared for a cold boot
+bool WarmStart::begin() {
+	warm = warmState.magic == WARM_STATE_MAGIC
+		&& warmState.version == WARM_STATE_VERSION
+		&& warmState.size == sizeof(WarmState)
+		&& warmState.crc == crc32((const uint8_t *)&warmState, offsetof(WarmState, crc));
+
+	if (warm) {
+		warmState.resumes++;
+	}
+	else {
+		memset(&warmState, 0, sizeof(warmState));
+		warmState.magic = WARM_STATE_MAGIC;
+		warmState.version = WARM_STATE_VERSION;
+		warmState.size = sizeof(WarmState);
+	}
+	save();
+
+#ifdef AIRFLEET_DEBUG
+	Log.info("WARM %s start, %lu resumes", warm ? "warm" : "cold", warmState.resumes);
+#endif
+
+	return warm;
+}
+
+// Seals fields written since last save
+void WarmStart::save() {
+	warmState.savedAt = Time.isValid() ? Time.now() : 0;
+	warmState.crc = crc32((const uint8_t *)&warmState, offsetof(WarmState, crc));
+	saves++;
+}
+
+bool WarmStart::isWarm() {
+	return warm;
+}
+
+// Seconds since state was saved, UINT32_MAX if unknown
+uint32_t WarmStart::getAgeS() {
+	if (warmState.savedAt == 0 || !Time.isValid() || (uint32_t)Time.now() < warmState.savedAt) return UINT32_MAX;
+	return Time.now() - warmState.savedAt;
+}
+
+size_t WarmStart::summary(char *buf, size_t len) {
+	int n = snprintf(buf, len, "{\"warm\":%d,\"resumes\":%lu,\"saves\":%lu,\"bytes\":%u}",
+		warm, warmState.resumes, saves, (unsigned)sizeof(WarmState));
+	return n < 0 ? 0 : ((size_t)n < len ? n : len - 1);
+}
@@ -0,0 +1,74 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Hot state kept in retained SRAM, so a reset (firmware update,
+			  watchdog, crash) resumes where the trip was instead of starting
+			  cold. Saved with a CRC at each publish and before sleep, and
+			  only trusted at boot if layout version, size and CRC match.
+			  After power loss the CRC fails and we boot cold.
+*/
+
+#ifndef WARM_START_H
+#define WARM_START_H
+
+#include "Particle.h"
+#include "Settings.h"
+#include "BleLcd.h"
+#include "RollingStats.h"
+
+// Bump when WarmState changes, so an old layout is never read as new
+#define WARM_STATE_VERSION	1
+
+// Retained SRAM on the Photon 2
+#define WARM_STATE_MAX		3068
+
+struct WarmState {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t size;
+	uint32_t savedAt;			// Unix time of save, 0 if clock was not set
+	uint32_t resumes;			// Warm starts since last cold boot
+
+	// Last frame on the display, before the sleep message
+	uint8_t lcd[BLE_LCD_FRAME_LEN];
+	uint8_t flash[BLE_LCD_FLASH_LEN];
+
+	// Last valid GPS fix, for hot start assistance
+	double latitude;
+	double longitude;
+	uint64_t fixUtcMs;			// 0 if none
+
+	// Rolling averages, see RollingStats
+	float pmAverage[STATS_HORIZONS];
+	float co2Average[STATS_HORIZONS];
+
+	// Past levels from cloud
+	float pastAverage[5];
+	uint32_t levelsAt;			// Unix time they were received, 0 if never
+
+	uint32_t crc;				// Of everything above
+};
+
+static_assert(sizeof(WarmState) <= WARM_STATE_MAX, "WarmState does not fit retained SRAM");
+
+extern WarmState warmState;
+
+class WarmStart {
+	public:
+		WarmStart();
+
+		bool begin();
+		void save();
+		bool isWarm();
+		uint32_t getAgeS();
+
+		size_t summary(char *buf, size_t len);
+
+	private:
+		bool warm;
+		uint32_t saves;
+};
+
+extern WarmStart warmStart;
+
+#endif
@@ -0,0 +1,135 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Cost and accuracy of the distance kernels in Distance.h, on
+			  random 5-50 m hops. Error is against Vincenty on WGS84.
+
+			  g++ -std=gnu++17 -O2 -I../host -I../../sensor/src distance_bench.cpp ../../sensor/src/Distance.cpp -o distance_bench
+			  ./distance_bench [latitude]
+
+			  Timings are for the host. On the Photon 2 double precision is
+			  done in software, so the float kernels gain a lot more there.
+*/
+
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "Particle.h"
+#include "Distance.h"
+
+system_tick_t hostMillis = 0;
+uint8_t hostPins[32];
+
+#define HOPS	100000
+#define ROUNDS	20
+
+struct Hop {
+	double lat1, lng1, lat2, lng2;
+};
+
+static volatile double sink;
+
+template <typename F>
+static double nsPerHop(const std::vector<Hop> &hops, F kernel) {
+	auto start = std::chrono::steady_clock::now();
+	double sum = 0;
+	for (int r = 0; r < ROUNDS; r++) {
+		for (const Hop &h : hops) sum += kernel(h);
+	}
+	auto end = std::chrono::steady_clock::now();
+	sink = sum;
+	return std::chrono::duration<double, std::nano>(end - start).count() / ((double)ROUNDS * hops.size());
+}
+
+template <typename F>
+static void report(const char *name, const std::vector<Hop> &hops, const std::vector<double> &ref, F kernel) {
+	double maxErr = 0;
+	double sumErr = 0;
+	double maxRel = 0;
+	for (size_t i = 0; i < hops.size(); i++) {
+		double err = fabs(kernel(hops[i]) - ref[i]);
+		sumErr += err;
+		if (err > maxErr) maxErr = err;
+		if (err / ref[i] > maxRel) maxRel = err / ref[i];
+	}
+	printf("%-22s %8.1f ns/hop   mean err %7.4f m   max err %7.4f m   max rel %.2e\n",
+		name, nsPerHop(hops, kernel), sumErr / hops.size(), maxErr, maxRel);
+}
+
+int main(int argc, char **argv) {
+	double latitude = argc > 1 ? atof(argv[1]) : 55.7;
+
+	// Random hops near the latitude, any direction
+	srand(1);
+	std::vector<Hop> hops(HOPS);
+	std::vector<double> ref(HOPS);
+	for (size_t i = 0; i < HOPS; i++) {
+		Hop &h = hops[i];
+		h.lat1 = latitude + (rand() / (double)RAND_MAX - .5) * 0.5;
+		h.lng1 = 12. + (rand() / (double)RAND_MAX - .5) * 0.5;
+		double meters = 5. + 45. * rand() / (double)RAND_MAX;
+		double bearing = 2. * M_PI * rand() / (double)RAND_MAX;
+		h.lat2 = h.lat1 + meters * cos(bearing) / 111132.;
+		h.lng2 = h.lng1 + meters * sin(bearing) / (111320. * cos(h.lat1 * M_PI / 180.));
+		ref[i] = distanceVincenty(h.lat1, h.lng1, h.lat2, h.lng2);
+	}
+
+	printf("%d hops of 5-50 m around latitude %.1f\n\n", HOPS, latitude);
+
+	// Scale as the odometer caches it, refreshed every DISTANCE_SCALE_REFRESH_DEG
+	DistanceScale scale;
+	distanceScale(latitude, &scale);
+	report("equirect, cached scale", hops, ref, [&](const Hop &h) {
+		if (fabs(h.lat1 - scale.latitude) > DISTANCE_SCALE_REFRESH_DEG) distanceScale(h.lat1, &scale);
+		return (double)distanceEquirect(scale, h.lat1, h.lng1, h.lat2, h.lng2);
+	});
+	report("equirect, fresh scale", hops, ref, [](const Hop &h) {
+		DistanceScale s;
+		distanceScale(h.lat1, &s);
+		return (double)distanceEquirect(s, h.lat1, h.lng1, h.lat2, h.lng2);
+	});
+	report("haversine, float", hops, ref, [](const Hop &h) {
+		return (double)distanceHaversine(h.lat1, h.lng1, h.lat2, h.lng2);
+	});
+	report("haversine, double pow", hops, ref, [](const Hop &h) {
+		// As previously in L86.cpp
+		double dLat = (h.lat1 - h.lat2) * M_PI / 180.0;
+		double dLon = (h.lng1 - h.lng2) * M_PI / 180.0;
+		double a = pow(sin(dLat / 2), 2) + pow(sin(dLon / 2), 2) *
+			cos(h.lat1 * M_PI / 180.0) * cos(h.lat2 * M_PI / 180.0);
+		return 6371000. * 2 * asin(sqrt(a));
+	});
+	report("vincenty", hops, ref, [](const Hop &h) {
+		return distanceVincenty(h.lat1, h.lng1, h.lat2, h.lng2);
+	});
+
+	// Parked for 10 min at 5 Hz with a few meters of position noise
+	printf("\nOdometer parked 10 min, 3 m noise:\n");
+	{
+		srand(2);
+		double lat = latitude, lng = 12., meters = 0.;
+		for (system_tick_t ms = 0; ms < 600000; ms += 200) {
+			double n = 3. * (rand() / (double)RAND_MAX - .5);
+			double e = 3. * (rand() / (double)RAND_MAX - .5);
+			rand();
+			meters += distanceVincenty(lat, lng, latitude + n / 111132., 12. + e / 64000.);
+			lat = latitude + n / 111132.;
+			lng = 12. + e / 64000.;
+		}
+		printf("%-22s %8.3f km\n", "unfiltered", meters / 1000.);
+	}
+	static const char *names[] = { "speed", "equirect", "haversine", "vincenty" };
+	for (int k = DISTANCE_SPEED; k <= DISTANCE_VINCENTY; k++) {
+		Odometer odometer((DistanceKernel)k);
+		srand(2);
+		for (system_tick_t ms = 0; ms < 600000; ms += 200) {
+			double n = 3. * (rand() / (double)RAND_MAX - .5);
+			double e = 3. * (rand() / (double)RAND_MAX - .5);
+			float speed = 1.5f * rand() / RAND_MAX;
+			odometer.add(latitude + n / 111132., 12. + e / 64000., speed, ms);
+		}
+		printf("%-22s %8.3f km, %lu fixes rejected\n", names[k], odometer.getKm(), (unsigned long)odometer.getRejected());
+	}
+
+	return 0;
+}
@@ -0,0 +1,185 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Replays a trip through the energy ledger and the GPS power
+			  policy, to compare policies before they ship. Currents are
+			  the firmware's, from Settings.h.
+
+			  g++ -std=gnu++17 -I../host -I../../sensor/src energy_sim.cpp ../../sensor/src/Energy.cpp ../../sensor/src/GpsPower.cpp -o energy_sim
+			  ./energy_sim trace.csv     CSV lines: ms,speed km/h (empty speed = no fix)
+			  ./energy_sim               Built-in trip with city driving, a long idle and a motorway leg
+
+			  Late = time moving at L86_MOVING_KMH or more while not in full
+			  tracking, i.e. fixes the odometer and map did not get.
+*/
+
+#include <stdlib.h>
+#include <vector>
+#include "Particle.h"
+#include "Energy.h"
+#include "GpsPower.h"
+
+system_tick_t hostMillis = 0;
+uint8_t hostPins[32];
+
+#define STEP_MS			200		// L86_FIX_INTERVAL_MS
+#define BLE_CONNECT_MS	3000	// Display found and connected
+#define UPLOAD_MS		2000	// Connected time per session
+
+struct Point {
+	system_tick_t ms;
+	float speed;			// NAN = no fix
+};
+
+struct GpsPolicy {
+	const char *name;
+	system_tick_t alwaysLocateAfterMs;
+	system_tick_t periodicAfterMs;
+};
+
+struct RadioPolicy {
+	const char *name;
+	system_tick_t sessionEveryMs;	// Upload queued samples this often
+};
+
+static bool load(const char *path, std::vector<Point> *trace) {
+	FILE *f = fopen(path, "r");
+	if (!f) return false;
+	char line[64];
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] < '0' || line[0] > '9') continue;	// Header or comment
+		const char *speed = strchr(line, ',');
+		if (!speed) continue;
+		speed++;
+		while (*speed == ' ') speed++;
+		bool fix = *speed != 0 && *speed != '\n' && *speed != '\r';
+		trace->push_back({ (system_tick_t)strtoul(line, NULL, 10), fix ? strtof(speed, NULL) : NAN });
+	}
+	fclose(f);
+	return true;
+}
+
+// 60 min: 40 s to first fix, city driving with lights, 12 min idling
+// parked, motorway, city again
+static void demo(std::vector<Point> *trace) {
+	srand(1);
+	for (system_tick_t ms = 0; ms < 3600000; ms += STEP_MS) {
+		float t = ms / 1000.f;
+		float speed;
+		if (t < 40) speed = NAN;
+		else if (t < 900) speed = fmodf(t, 120) < 40 ? 0 : 40;		// Lights every 2 min
+		else if (t < 1620) speed = 0;								// Idling parked
+		else if (t < 3000) speed = t < 1680 ? (t - 1620) * 2 : 110;	// Motorway
+		else speed = fmodf(t, 90) < 30 ? 0 : 35;
+		if (!isnan(speed)) speed = fmaxf(0, speed + (rand() % 100) / 50.f - 1);
+		trace->push_back({ ms, speed });
+	}
+}
+
+static void run(const std::vector<Point> &trace, const GpsPolicy &gps, const RadioPolicy &radio) {
+	EnergyLedger ledger;
+	GpsPowerPolicy policy(gps.alwaysLocateAfterMs, gps.periodicAfterMs);
+	hostMillis = 0;
+	ledger.tripStart();
+	ledger.set(ENERGY_SEN50, ENERGY_SEN50_MEASURING);
+	ledger.set(ENERGY_BLE, ENERGY_BLE_ACTIVE);
+	ledger.set(ENERGY_GPS, ENERGY_GPS_FULL);
+	policy.reset(0);
+
+	GpsPowerMode mode = GPS_MODE_FULL;
+	system_tick_t modeSince = 0;
+	system_tick_t lateMs = 0;
+	bool valid = false;
+	float speed = 0;
+	uint32_t queued = 0;
+	system_tick_t nextPublish = 0;
+	system_tick_t nextSession = radio.sessionEveryMs;
+	system_tick_t sessionStart = 0;
+	bool session = false;
+
+	for (const Point &p : trace) {
+		hostMillis = p.ms;
+
+		// No fixes during standby windows of periodic mode
+		bool heard = mode != GPS_MODE_PERIODIC ||
+			(p.ms - modeSince) % (L86_PERIODIC_RUN_MS + L86_PERIODIC_SLEEP_MS) < L86_PERIODIC_RUN_MS;
+		if (heard) {
+			valid = !isnan(p.speed);
+			speed = valid ? p.speed : 0;
+		}
+		if (!isnan(p.speed) && p.speed >= L86_MOVING_KMH && mode != GPS_MODE_FULL) lateMs += STEP_MS;
+
+		// L86::loop() runs every SENSORS_POLL_MS
+		if (p.ms % SENSORS_POLL_MS == 0) {
+			GpsPowerMode next = policy.update(valid, speed, p.ms);
+			if (next != mode) {
+				mode = next;
+				modeSince = p.ms;
+				ledger.set(ENERGY_GPS, mode);
+			}
+		}
+
+		if (p.ms >= BLE_CONNECT_MS) ledger.set(ENERGY_BLE, ENERGY_BLE_CONNECTED);
+
+		// Samples queued every publish interval, uploaded per radio policy
+		if (p.ms >= nextPublish) {
+			queued++;
+			nextPublish += PUBLISH_INTERVAL_MS;
+		}
+		if (!session && p.ms >= nextSession && queued > 0) {
+			session = true;
+			sessionStart = p.ms;
+			ledger.set(ENERGY_WIFI, ENERGY_WIFI_CONNECTING);
+		}
+		if (session && p.ms - sessionStart >= RADIO_CONNECT_COST_MS) {
+			ledger.set(ENERGY_WIFI, ENERGY_WIFI_CONNECTED);
+			while (queued > 0) {
+				ledger.countUpload();
+				queued--;
+			}
+		}
+		if (session && p.ms - sessionStart >= RADIO_CONNECT_COST_MS + UPLOAD_MS) {
+			session = false;
+			ledger.set(ENERGY_WIFI, ENERGY_WIFI_OFF);
+			nextSession = p.ms + radio.sessionEveryMs;
+		}
+	}
+
+	printf("%-12s %-10s", gps.name, radio.name);
+	for (uint8_t i = 0; i < ENERGY_SUBSYSTEMS; i++) printf(" %7.1f", ledger.tripMah((EnergySubsystem)i));
+	printf(" %8.1f %6lu %9.3f %7.1f\n", ledger.tripMah(), (unsigned long)ledger.tripUploads(),
+		ledger.tripUploads() ? ledger.tripMah() / ledger.tripUploads() : 0.f, lateMs / 1000.f);
+}
+
+int main(int argc, char **argv) {
+	std::vector<Point> trace;
+	if (argc > 1) {
+		if (!load(argv[1], &trace)) {
+			fprintf(stderr, "Cannot read %s\n", argv[1]);
+			return 1;
+		}
+	}
+	else {
+		demo(&trace);
+	}
+	if (trace.empty()) return 1;
+
+	static const GpsPolicy gpsPolicies[] = {
+		{ "always full", 0xFFFFFFFF, 0xFFFFFFFF },
+		{ "firmware", L86_ALWAYSLOCATE_AFTER_MS, L86_PERIODIC_AFTER_MS },
+		{ "aggressive", 10000, 60000 }
+	};
+	static const RadioPolicy radioPolicies[] = {
+		{ "per sample", 0 },
+		{ "batched", RADIO_BATCH_MAX_AGE_MS }
+	};
+
+	printf("%lu min trip\n\n", (unsigned long)(trace.back().ms / 60000));
+	printf("%-12s %-10s", "gps", "radio");
+	for (uint8_t i = 0; i < ENERGY_SUBSYSTEMS; i++) printf(" %7s", EnergyLedger::name((EnergySubsystem)i));
+	printf(" %8s %6s %9s %7s\n", "mAh", "uploads", "mAh/upl", "late s");
+	for (const GpsPolicy &g : gpsPolicies) {
+		for (const RadioPolicy &r : radioPolicies) run(trace, g, r);
+	}
+	return 0;
+}
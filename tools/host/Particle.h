@@ -0,0 +1,57 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Minimal Device OS stand-in, so firmware modules can run on
+			  a host against simulated time and pins
+*/
+
+#ifndef HOST_PARTICLE_H
+#define HOST_PARTICLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+typedef uint32_t system_tick_t;
+
+enum PinMode { INPUT, OUTPUT };
+#define LOW		0
+#define HIGH	1
+#define D5		5
+
+// Simulated clock, advanced by the host program
+extern system_tick_t hostMillis;
+inline system_tick_t millis() { return hostMillis; }
+
+// Simulated pin levels
+extern uint8_t hostPins[32];
+inline void pinMode(uint16_t, PinMode) {}
+inline void digitalWrite(uint16_t pin, uint8_t value) { hostPins[pin] = value; }
+
+// System clock, not set until a module sets it
+struct HostTime {
+	time_t utc;
+	bool isValid() { return utc != 0; }
+	time_t now() { return utc; }
+	void setTime(time_t t) { utc = t; }
+};
+extern HostTime Time;
+
+// Log to stderr
+struct HostLog {
+	void info(const char *format, ...) {
+		va_list args;
+		va_start(args, format);
+		vfprintf(stderr, format, args);
+		va_end(args);
+		fputc('\n', stderr);
+	}
+};
+extern HostLog Log;
+
+#endif
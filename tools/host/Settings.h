@@ -0,0 +1,2 @@
+// Simulate with the example settings
+#include "../../sensor/src/Settings.example.h"
@@ -0,0 +1,264 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Pulls the sample log from a sensor over USB serial, see
+			  ExportProtocol.h. Resumes from the last good record on CRC
+			  errors or stalls, and reports throughput.
+
+			  g++ -std=gnu++17 -O2 -I../../sensor/src journal_export.cpp ../../sensor/src/Sample.cpp -o journal_export
+			  ./journal_export /dev/ttyACM0 > samples.csv
+			  ./journal_export -f json -o samples.json /dev/ttyACM0
+			  ./journal_export -from 1792310400000 -to 1792396800000 /dev/ttyACM0
+			  ./journal_export -b 4194304 /dev/ttyACM0       Throughput with dummy data
+
+			  Records of older schema versions, kept on the sensor from
+			  before a firmware update, are converted to the current one.
+
+			  -f json writes samples as the sensor publishes them, one per
+			  line, for webserver/php/airfleet/push_bulk.php:
+			  curl -H "API-KEY: ..." --data-binary @samples.json https://.../push_bulk.php
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+#include <chrono>
+#include <vector>
+#include "Sample.h"
+#include "ExportProtocol.h"
+#include "Fixed.h"
+
+#define TIMEOUT_MS		2000
+#define MAX_RETRIES		5
+
+static const char *fieldNames[] = {
+#define FIELD_NAME(name, type, decimals, kind, sql) #name,
+	SAMPLE_FIELDS(FIELD_NAME)
+#undef FIELD_NAME
+};
+
+static int openSerial(const char *path) {
+	int fd = open(path, O_RDWR | O_NOCTTY);
+	if (fd < 0) return -1;
+	struct termios tio;
+	if (tcgetattr(fd, &tio) == 0) {
+		cfmakeraw(&tio);
+		tio.c_cc[VMIN] = 0;
+		tio.c_cc[VTIME] = 0;
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	tcflush(fd, TCIOFLUSH);
+	return fd;
+}
+
+static void writeCsv(FILE *out, const Sample &s) {
+	bool first = true;
+#define FIELD_CSV(name, type, decimals, kind, sql) \
+	if (!first) fputc(',', out); \
+	fputs(FixedText((int64_t)s.name, decimals).text, out); \
+	first = false;
+	SAMPLE_FIELDS(FIELD_CSV)
+#undef FIELD_CSV
+	fputc('\n', out);
+}
+
+static void usage() {
+	fprintf(stderr, "journal_export [-f csv|json] [-o file] [-from ms] [-to ms] [-s skip] <device>\n");
+	fprintf(stderr, "journal_export -b bytes <device>\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	bool json = false;
+	const char *outPath = NULL;
+	unsigned long long fromMs = 0;
+	unsigned long long toMs = 0;
+	uint32_t skip = 0;
+	uint32_t benchBytes = 0;
+	const char *device = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) json = strcmp(argv[++i], "json") == 0;
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) outPath = argv[++i];
+		else if (strcmp(argv[i], "-from") == 0 && i + 1 < argc) fromMs = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-to") == 0 && i + 1 < argc) toMs = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) skip = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) benchBytes = strtoul(argv[++i], NULL, 10);
+		else if (argv[i][0] != '-' && !device) device = argv[i];
+		else usage();
+	}
+	if (!device) usage();
+
+	int fd = openSerial(device);
+	if (fd < 0) {
+		fprintf(stderr, "Can't open %s\n", device);
+		return 1;
+	}
+	FILE *out = outPath ? fopen(outPath, "w") : stdout;
+	if (!out) {
+		fprintf(stderr, "Can't write %s\n", outPath);
+		return 1;
+	}
+	if (!benchBytes && !json) {
+		for (size_t i = 0; i < sizeof(fieldNames) / sizeof(fieldNames[0]); i++) {
+			fprintf(out, "%s%s", i > 0 ? "," : "", fieldNames[i]);
+		}
+		fputc('\n', out);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	uint32_t received = 0;		// Records, or bytes when benchmarking
+	uint64_t wireBytes = 0;
+	uint32_t retries = 0;
+	uint32_t crcErrors = 0;
+	bool done = false;
+	uint32_t endIndex = 0;
+
+	while (!done && retries <= MAX_RETRIES) {
+		// (Re)start after what we have
+		char cmd[80];
+		if (benchBytes) snprintf(cmd, sizeof(cmd), "AFB %lu\n", (unsigned long)(benchBytes - received));
+		else snprintf(cmd, sizeof(cmd), "AFX %llu %llu %lu\n", fromMs, toMs, (unsigned long)(skip + received));
+		if (write(fd, cmd, strlen(cmd)) != (ssize_t)strlen(cmd)) break;
+
+		std::vector<uint8_t> buf;
+		size_t pos = 0;
+		uint32_t base = received;	// Benchmark data counts from 0 each time
+		bool started = benchBytes != 0;
+		bool restart = false;
+		size_t recordLen = SAMPLE_BINARY_LEN;
+		while (!done && !restart) {
+			// Frames in buffer
+			while (buf.size() - pos >= EXPORT_HEADER_LEN + EXPORT_CRC_LEN) {
+				const uint8_t *p = &buf[pos];
+				if (p[0] != 'A' || p[1] != 'F' || p[3] != EXPORT_PROTOCOL_VERSION) {
+					pos++;
+					continue;
+				}
+				uint16_t len = p[4] | (p[5] << 8);
+				if (len > EXPORT_MAX_PAYLOAD) {
+					pos++;
+					continue;
+				}
+				size_t frameLen = EXPORT_HEADER_LEN + len + EXPORT_CRC_LEN;
+				if (buf.size() - pos < frameLen) break;
+
+				uint32_t crc = 0;
+				for (uint8_t i = 0; i < 4; i++) crc |= (uint32_t)p[EXPORT_HEADER_LEN + len + i] << (8 * i);
+				if (crc != crc32(p, EXPORT_HEADER_LEN + len)) {
+					// Could be log text that looked like a frame, or a damaged one
+					crcErrors++;
+					pos++;
+					continue;
+				}
+
+				uint8_t type = p[2];
+				uint32_t index = p[6] | (p[7] << 8) | (p[8] << 16) | ((uint32_t)p[9] << 24);
+				const uint8_t *payload = p + EXPORT_HEADER_LEN;
+				pos += frameLen;
+				wireBytes += frameLen;
+
+				if (type == EXPORT_HEADER) {
+					if (sampleBinaryLen(payload[0]) == 0 || payload[1] != sampleBinaryLen(payload[0])) {
+						fprintf(stderr, "Sensor has schema version %u, this tool %u\n", payload[0], SAMPLE_SCHEMA_VERSION);
+						return 1;
+					}
+					started = index == skip + received;
+					if (started) recordLen = payload[1];
+				}
+				else if (type == EXPORT_DATA && started) {
+					// A gap means a frame was lost, so ask again from where we are
+					uint32_t expected = benchBytes ? received - base : skip + received;
+					if (index != expected) {
+						restart = true;
+						break;
+					}
+					if (benchBytes) {
+						received += len;
+						continue;
+					}
+					for (size_t i = 0; i + recordLen <= len; i += recordLen) {
+						Sample sample;
+						if (!sampleDecodeAny(payload + i, recordLen, &sample)) continue;
+						if (json) {
+							char text[SAMPLE_JSON_LEN + 1];
+							sampleJson(sample, text, sizeof(text));
+							fprintf(out, "%s\n", text);
+						}
+						else {
+							writeCsv(out, sample);
+						}
+						received++;
+					}
+				}
+				else if (type == EXPORT_END && started) {
+					done = true;
+					endIndex = index;
+				}
+				else if (type == EXPORT_ERROR) {
+					fprintf(stderr, "Sensor: %.*s\n", len, (const char *)payload);
+					return 1;
+				}
+			}
+			if (pos > 65536) {
+				buf.erase(buf.begin(), buf.begin() + pos);
+				pos = 0;
+			}
+			if (done || restart) break;
+
+			// More from device
+			fd_set fds;
+			FD_ZERO(&fds);
+			FD_SET(fd, &fds);
+			struct timeval tv = { TIMEOUT_MS / 1000, (TIMEOUT_MS % 1000) * 1000 };
+			if (select(fd + 1, &fds, NULL, NULL, &tv) <= 0) {
+				restart = true;
+				break;
+			}
+			uint8_t chunk[16384];
+			ssize_t n = read(fd, chunk, sizeof(chunk));
+			if (n <= 0) {
+				restart = true;
+				break;
+			}
+			buf.insert(buf.end(), chunk, chunk + n);
+		}
+
+		if (restart) {
+			retries++;
+			fprintf(stderr, "Resuming after %lu%s\n", (unsigned long)received, benchBytes ? " bytes" : " records");
+		}
+	}
+
+	double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	bool written = out != stdout ? fclose(out) == 0 : fflush(out) == 0;
+
+	// Only once every record is written out, the sensor may then delete
+	// the ones kept from before a firmware update
+	if (done && !benchBytes && written && skip + received == endIndex) {
+		char cmd[32];
+		snprintf(cmd, sizeof(cmd), "AFK %lu\n", (unsigned long)endIndex);
+		if (write(fd, cmd, strlen(cmd)) != (ssize_t)strlen(cmd)) fprintf(stderr, "Couldn't acknowledge export\n");
+	}
+	close(fd);
+
+	if (benchBytes) {
+		fprintf(stderr, "%lu bytes in %.2f s, %.2f MB/s payload, %.2f MB/s on the wire, %lu retries, %lu CRC errors\n",
+			(unsigned long)received, s, received / s / 1e6, wireBytes / s / 1e6,
+			(unsigned long)retries, (unsigned long)crcErrors);
+	}
+	else {
+		fprintf(stderr, "%lu records in %.2f s, %.0f records/s, %.2f MB/s on the wire, %lu retries, %lu CRC errors\n",
+			(unsigned long)received, s, received / s, wireBytes / s / 1e6,
+			(unsigned long)retries, (unsigned long)crcErrors);
+	}
+	if (!done) {
+		fprintf(stderr, "Incomplete, resume with -s %lu\n", (unsigned long)(skip + received));
+		return 1;
+	}
+	return 0;
+}
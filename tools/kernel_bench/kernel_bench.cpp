@@ -0,0 +1,328 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Microbenchmarks of the firmware's CPU kernels, built from the
+			  firmware sources against the host shim. Reports ns and heap
+			  allocations per operation, and writes JSON to compare commits.
+
+			  g++ -std=gnu++17 -O2 -I../host -I../../sensor/src kernel_bench.cpp ../../sensor/src/Nmea.cpp ../../sensor/src/TimeBase.cpp ../../sensor/src/Distance.cpp ../../sensor/src/LcdText.cpp ../../sensor/src/Sample.cpp -o kernel_bench
+			  ./kernel_bench                     Table of all kernels
+			  ./kernel_bench crc                 Only kernels with "crc" in the name
+			  ./kernel_bench -j > after.json     JSON, one kernel per line
+			  ./kernel_bench -c before.json      Table with change against a saved run
+
+			  Timings are for the host, so compare runs on the same machine.
+			  Allocations count malloc and new, which must stay 0 in the
+			  sample path.
+*/
+
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <new>
+#include "Particle.h"
+#include "Nmea.h"
+#include "Distance.h"
+#include "LcdText.h"
+#include "Sample.h"
+#include "SensorCrc.h"
+#include "Crc32.h"
+#include "ExportProtocol.h"
+
+system_tick_t hostMillis = 0;
+uint8_t hostPins[32];
+HostTime Time;
+HostLog Log;
+
+#define TARGET_NS	200e6	// Per measurement
+#define REPEATS		5		// Best of
+
+// Heap allocations, counted by the overrides below
+static uint64_t allocations = 0;
+
+#ifdef __GLIBC__
+// All of malloc, which new uses as well
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *malloc(size_t size) {
+	allocations++;
+	return __libc_malloc(size);
+}
+extern "C" void *calloc(size_t count, size_t size) {
+	allocations++;
+	return __libc_calloc(count, size);
+}
+extern "C" void *realloc(void *ptr, size_t size) {
+	allocations++;
+	return __libc_realloc(ptr, size);
+}
+#else
+void *operator new(size_t size) {
+	allocations++;
+	if (void *p = malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept {
+	free(ptr);
+}
+#endif
+
+// Keeps the compiler from optimising a result away
+template <typename T>
+static inline void keep(const T &value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+	std::string name;
+	uint64_t iterations;
+	double ns;			// Per op, best of REPEATS
+	double allocs;		// Per op
+};
+
+static std::vector<Result> results;
+static const char *filter = NULL;
+
+template <typename F>
+static double run(F &op, uint64_t iterations) {
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < iterations; i++) op(i);
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// op(i) is one operation, i lets it vary its input
+template <typename F>
+static void bench(const char *name, F op) {
+	if (filter && !strstr(name, filter)) return;
+
+	// Iterations for TARGET_NS, found by doubling from a run of at least 1 ms
+	uint64_t iterations = 1;
+	double ns;
+	while ((ns = run(op, iterations)) < 1e6) iterations *= 2;
+	iterations = (uint64_t)(iterations * TARGET_NS / ns) + 1;
+
+	Result r = { name, iterations, 0., 0. };
+	for (int i = 0; i < REPEATS; i++) {
+		uint64_t before = allocations;
+		ns = run(op, iterations) / iterations;
+		r.allocs = (double)(allocations - before) / iterations;
+		if (i == 0 || ns < r.ns) r.ns = ns;
+	}
+	results.push_back(r);
+}
+
+// ns per op by name from a saved -j run, one kernel per line
+static bool loadBaseline(const char *path, std::vector<Result> *baseline) {
+	FILE *f = fopen(path, "r");
+	if (!f) return false;
+	char line[512];
+	while (fgets(line, sizeof(line), f)) {
+		char name[128];
+		const char *p = strstr(line, "\"name\": \"");
+		const char *t = strstr(line, "\"real_time\": ");
+		if (!p || !t || sscanf(p + 9, "%127[^\"]", name) != 1) continue;
+		baseline->push_back({ name, 0, atof(t + 13), 0. });
+	}
+	fclose(f);
+	return true;
+}
+
+static void printJson() {
+	char date[32];
+	time_t now = time(NULL);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+	printf("{\n  \"context\": {\"date\": \"%s\", \"compiler\": \"%s\"},\n  \"benchmarks\": [\n", date, __VERSION__);
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result &r = results[i];
+		printf("    {\"name\": \"%s\", \"iterations\": %llu, \"real_time\": %.3f, \"time_unit\": \"ns\", \"allocs_per_iteration\": %.3f}%s\n",
+			r.name.c_str(), (unsigned long long)r.iterations, r.ns, r.allocs, i + 1 < results.size() ? "," : "");
+	}
+	printf("  ]\n}\n");
+}
+
+static void printTable(const std::vector<Result> *baseline) {
+	printf("%-28s %12s %10s %10s%s\n", "kernel", "iterations", "ns/op", "allocs/op", baseline ? "     before   change" : "");
+	for (const Result &r : results) {
+		printf("%-28s %12llu %10.2f %10.2f", r.name.c_str(), (unsigned long long)r.iterations, r.ns, r.allocs);
+		if (baseline) {
+			const Result *b = NULL;
+			for (const Result &o : *baseline) if (o.name == r.name) b = &o;
+			if (b && b->ns > 0) printf(" %10.2f %+7.1f%%", b->ns, (r.ns - b->ns) / b->ns * 100.);
+			else printf(" %10s", "-");
+		}
+		printf("\n");
+	}
+}
+
+int main(int argc, char **argv) {
+	bool json = false;
+	const char *baselinePath = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-j") == 0) json = true;
+		else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) baselinePath = argv[++i];
+		else if (argv[i][0] == '-') {
+			fprintf(stderr, "Usage: %s [-j] [-c before.json] [filter]\n", argv[0]);
+			return 1;
+		}
+		else filter = argv[i];
+	}
+
+	std::vector<Result> baseline;
+	if (baselinePath && !loadBaseline(baselinePath, &baseline)) {
+		fprintf(stderr, "Unable to read %s\n", baselinePath);
+		return 1;
+	}
+
+	// GPS: RMC sentences as the L86 sends them, checksums made here
+	static const char *bodies[4] = {
+		"GNRMC,105117.000,A,5626.2207,N,00922.2751,E,0.00,2.02,251124,,,A,V",
+		"GNRMC,105117.200,A,5626.2209,N,00922.2760,E,32.41,87.50,251124,,,A,V",
+		"GNRMC,105117.400,A,5540.1234,N,01234.5678,E,54.02,181.33,251124,,,A,V",
+		"GNRMC,105117.600,V,,,,,,,251124,,,N,V"
+	};
+	char sentences[4][96];
+	size_t lens[4];
+	TextSpan latitudes[4];
+	for (int i = 0; i < 4; i++) {
+		lens[i] = nmeaCommand(bodies[i], sentences[i], sizeof(sentences[i])) - 2;
+		nmeaField(sentences[i], lens[i], 3, &latitudes[i]);
+	}
+	latitudes[3] = latitudes[2];
+
+	bench("nmea/verify", [&](uint64_t i) {
+		keep(nmeaVerify(sentences[i & 3], lens[i & 3]));
+	});
+	bench("nmea/degrees", [&](uint64_t i) {
+		keep(nmeaDegrees(latitudes[i & 3]));
+	});
+	bench("nmea/parse_rmc", [&](uint64_t i) {
+		NmeaRmc rmc;
+		keep(nmeaParseRmc(sentences[i & 3], lens[i & 3], &rmc));
+		keep(rmc);
+	});
+
+	// I2C sensors: words with their CRC, as read per sample
+	uint8_t sen50Frame[24];
+	uint8_t htu31Frame[6];
+	uint8_t micsFrame[7] = { 80, 95, 0, 0, 0, 0, 0 };
+	for (int w = 0; w < 8; w++) {
+		sen50Frame[w * 3] = 0x01;
+		sen50Frame[w * 3 + 1] = 0x20 + w;
+		sen50Frame[w * 3 + 2] = sensirionCrc8(sen50Frame + w * 3, 2, 0xFF);
+	}
+	for (int w = 0; w < 2; w++) {
+		htu31Frame[w * 3] = 0x66;
+		htu31Frame[w * 3 + 1] = 0x10 + w;
+		htu31Frame[w * 3 + 2] = sensirionCrc8(htu31Frame + w * 3, 2, 0x00);
+	}
+	micsFrame[6] = micsChecksum(micsFrame, 6);
+	uint8_t beef[2] = { 0xBE, 0xEF };
+	if (sensirionCrc8(beef, 2, 0xFF) != 0x92) fprintf(stderr, "SEN50 CRC does not match the datasheet example\n");
+
+	bench("crc/sen50_word", [&](uint64_t i) {
+		keep(sensirionCrc8(sen50Frame + (i & 7) * 3, 2, 0xFF));
+	});
+	bench("crc/sen50_frame", [&](uint64_t) {
+		bool ok = true;
+		for (int w = 0; w < 8; w++) ok &= sen50Frame[w * 3 + 2] == sensirionCrc8(sen50Frame + w * 3, 2, 0xFF);
+		keep(ok);
+	});
+	bench("crc/htu31_frame", [&](uint64_t) {
+		bool ok = true;
+		for (int w = 0; w < 2; w++) ok &= htu31Frame[w * 3 + 2] == sensirionCrc8(htu31Frame + w * 3, 2, 0x00);
+		keep(ok);
+	});
+	bench("crc/mics_frame", [&](uint64_t) {
+		keep(micsFrame[6] == micsChecksum(micsFrame, 6));
+	});
+	static uint8_t payload[EXPORT_MAX_PAYLOAD];
+	for (size_t i = 0; i < sizeof(payload); i++) payload[i] = i * 7;
+	bench("crc/crc32_export_frame", [&](uint64_t) {
+		keep(crc32(payload, sizeof(payload)));
+	});
+
+	// LCD: level scale, and a line diffed against the frame on the display
+	bench("lcd/scale", [&](uint64_t i) {
+		LcdLine line;
+		line.append("PM  ");
+		lcdScale(&line, (float)(i & 63), 0., 50., 12., 16);
+		keep(line);
+	});
+	uint8_t frame[BLE_LCD_FRAME_LEN];
+	memset(frame, ' ', sizeof(frame));
+	static const char lines[2][BLE_LCD_WIDTH + 1] = { "CO2 [------   |   ] ", "CO2 [-------  |   ] " };
+	lcdUpdate(frame, BLE_LCD_WIDTH, (const uint8_t *)lines[0], BLE_LCD_WIDTH);
+	bench("lcd/update_unchanged", [&](uint64_t) {
+		keep(lcdUpdate(frame, BLE_LCD_WIDTH, (const uint8_t *)lines[0], BLE_LCD_WIDTH));
+	});
+	bench("lcd/update_changed", [&](uint64_t i) {
+		keep(lcdUpdate(frame, BLE_LCD_WIDTH, (const uint8_t *)lines[i & 1], BLE_LCD_WIDTH));
+	});
+
+	// Sample as queued in PUBLISH
+	Sample sample;
+	sample.pm1 = 52;
+	sample.pm25 = 87;
+	sample.pm4 = 101;
+	sample.pm10 = 113;
+	sample.temp = 2154;
+	sample.humi = 4630;
+	sample.voc = 231;
+	sample.co2 = 612;
+	sample.lat = 564370345;
+	sample.lng = 93712518;
+	sample.batt = 13812;
+	sample.flags = 0;
+	sample.time = 1732531877200ULL;
+	bench("sample/json", [&](uint64_t i) {
+		char buf[SAMPLE_JSON_LEN + 1];
+		sample.co2 = 400 + (i & 255);
+		keep(sampleJson(sample, buf, sizeof(buf)));
+		keep(buf);
+	});
+	bench("sample/json_snprintf_float", [&](uint64_t i) {
+		// As PUBLISH built it before sampleJson, for comparison
+		char buf[SAMPLE_JSON_LEN + 1];
+		sample.co2 = 400 + (i & 255);
+		keep(snprintf(buf, sizeof(buf),
+			"{\"pm1\":%.1f,\"pm25\":%.1f,\"pm4\":%.1f,\"pm10\":%.1f,\"temp\":%.2f,\"humi\":%.2f,\"voc\":%u,\"co2\":%u,\"lat\":%.7f,\"lng\":%.7f,\"time\":%llu}",
+			sample.pm1 / 10., sample.pm25 / 10., sample.pm4 / 10., sample.pm10 / 10., sample.temp / 100., sample.humi / 100.,
+			sample.voc, sample.co2, sample.lat / 1e7, sample.lng / 1e7, (unsigned long long)sample.time));
+		keep(buf);
+	});
+	bench("sample/encode", [&](uint64_t i) {
+		uint8_t buf[SAMPLE_BINARY_LEN];
+		sample.co2 = 400 + (i & 255);
+		keep(sampleEncode(sample, buf, sizeof(buf)));
+		keep(buf);
+	});
+
+	// Distance: one 5 Hz hop at 50 km/h
+	static const double hops[4][4] = {
+		{ 56.4370345, 9.3712518, 56.4370812, 9.3713702 },
+		{ 56.4370812, 9.3713702, 56.4371290, 9.3714861 },
+		{ 55.6761234, 12.5683371, 55.6761411, 12.5685380 },
+		{ 55.6761411, 12.5685380, 55.6760932, 12.5686511 }
+	};
+	DistanceScale scale;
+	distanceScale(hops[0][0], &scale);
+	bench("distance/haversine", [&](uint64_t i) {
+		const double *h = hops[i & 3];
+		keep(distanceHaversine(h[0], h[1], h[2], h[3]));
+	});
+	bench("distance/equirect", [&](uint64_t i) {
+		const double *h = hops[i & 1];
+		keep(distanceEquirect(scale, h[0], h[1], h[2], h[3]));
+	});
+	bench("distance/vincenty", [&](uint64_t i) {
+		const double *h = hops[i & 3];
+		keep(distanceVincenty(h[0], h[1], h[2], h[3]));
+	});
+
+	if (json) printJson();
+	else printTable(baselinePath ? &baseline : NULL);
+	return 0;
+}
@@ -0,0 +1,133 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Replays a PM/CO2 trace through the firmware's Recirc module and
+			  reports when the intake closes relative to the readings
+			  crossing the on level. Negative lead = closed after crossing.
+
+			  g++ -std=gnu++17 -I../host -I../../sensor/src recirc_sim.cpp ../../sensor/src/Recirc.cpp -o recirc_sim
+			  ./recirc_sim trace.csv     CSV lines: ms,pm,co2 (empty field = missing reading)
+			  ./recirc_sim               Built-in trace with a spike, a plume and a CO2 rise
+*/
+
+#include <stdlib.h>
+#include <vector>
+#include "Particle.h"
+#include "Recirc.h"
+
+system_tick_t hostMillis = 0;
+uint8_t hostPins[32];
+
+struct Reading {
+	system_tick_t ms;
+	float pm;
+	float co2;
+};
+
+static float field(const char *s) {
+	while (*s == ' ') s++;
+	if (*s == 0 || *s == ',' || *s == '\n' || *s == '\r') return NAN;
+	return strtof(s, NULL);
+}
+
+static bool load(const char *path, std::vector<Reading> *trace) {
+	FILE *f = fopen(path, "r");
+	if (!f) return false;
+	char line[128];
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] < '0' || line[0] > '9') continue;	// Header or comment
+		const char *pm = strchr(line, ',');
+		const char *co2 = pm ? strchr(pm + 1, ',') : NULL;
+		if (!co2) continue;
+		trace->push_back({ (system_tick_t)strtoul(line, NULL, 10), field(pm + 1), field(co2 + 1) });
+	}
+	fclose(f);
+	return true;
+}
+
+// 30 min: noise, a single PM spike, a plume ramping up over a minute, a slow CO2 rise
+static void demo(std::vector<Reading> *trace) {
+	srand(1);
+	for (system_tick_t ms = 0; ms < 1800000; ms += SAMPLE_INTERVAL_MS) {
+		float t = ms / 1000.f;
+		float pm = 5 + (rand() % 100) / 50.f;
+		float co2 = 450 + (rand() % 100) / 5.f;
+		if (t == 150) pm = 40;
+		if (t >= 300 && t < 360) pm += (t - 300) / 60 * 55;
+		else if (t >= 360 && t < 480) pm += 55;
+		else if (t >= 480 && t < 600) pm += 55 * (600 - t) / 120;
+		if (t >= 900 && t < 1200) co2 += (t - 900) / 300 * 1000;
+		else if (t >= 1200 && t < 1500) co2 += 1000 * (1500 - t) / 300;
+		trace->push_back({ ms, pm, co2 });
+	}
+}
+
+int main(int argc, char **argv) {
+	std::vector<Reading> trace;
+	if (argc > 1) {
+		if (!load(argv[1], &trace)) {
+			fprintf(stderr, "Unable to read %s\n", argv[1]);
+			return 1;
+		}
+	}
+	else {
+		demo(&trace);
+	}
+
+	Recirc recirc;
+	recirc.begin();
+
+	static const char *reasons[] = { "-", "pm", "co2", "pm_trend", "co2_trend", "hotspot" };
+	bool above = false;
+	bool pending = false;
+	system_tick_t crossedAt = 0;
+	system_tick_t closedAt = 0;
+	uint32_t crossings = 0;
+	uint32_t late = 0;
+	uint32_t closedMs = 0;
+
+	printf("%10s %8s %8s  %s\n", "ms", "pm", "co2", "event");
+	for (size_t i = 0; i < trace.size(); i++) {
+		const Reading &r = trace[i];
+		if (i > 0 && recirc.isClosed()) closedMs += r.ms - trace[i - 1].ms;
+		hostMillis = r.ms;
+
+		if (recirc.update(r.pm, r.co2)) {
+			printf("%10lu %8.1f %8.0f  %s %s\n", (unsigned long)r.ms, r.pm, r.co2,
+				recirc.isClosed() ? "close" : "open", reasons[recirc.getReason()]);
+			if (recirc.isClosed()) {
+				closedAt = r.ms;
+				if (pending) {
+					printf("%10s %8s %8s  lead %ld ms\n", "", "", "", -(long)(closedAt - crossedAt));
+					pending = false;
+				}
+			}
+		}
+
+		// Raw readings crossing the on level
+		bool now = r.pm >= RECIRC_PM_ON || r.co2 >= RECIRC_CO2_ON;
+		if (now && !above) {
+			crossings++;
+			crossedAt = r.ms;
+			if (recirc.isClosed()) {
+				printf("%10lu %8.1f %8.0f  crossing, lead %ld ms\n", (unsigned long)r.ms, r.pm, r.co2,
+					(long)(crossedAt - closedAt));
+			}
+			else {
+				printf("%10lu %8.1f %8.0f  crossing, not closed\n", (unsigned long)r.ms, r.pm, r.co2);
+				pending = true;
+				late++;
+			}
+		}
+		if (!now) pending = false;	// A spike that was over before closing
+		above = now;
+	}
+
+	char buf[200];
+	recirc.summary(buf, sizeof(buf));
+	printf("\nCrossings: %lu, closed late: %lu, closed %lu%% of the time\n%s\n",
+		(unsigned long)crossings, (unsigned long)late,
+		trace.empty() ? 0UL : (unsigned long)(100ULL * closedMs / (trace.back().ms - trace.front().ms + 1)),
+		buf);
+	return 0;
+}
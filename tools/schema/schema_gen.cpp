@@ -0,0 +1,143 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Generates server side sample schema from sensor/src/SampleSchema.h
+			  Build and run on host after changing the schema:
+			    g++ -std=c++17 -I../../sensor/src schema_gen.cpp -o schema_gen
+			    ./schema_gen php > ../../webserver/php/airfleet/schema.php
+			    ./schema_gen sql > ../../webserver/mysql/airfleet_log.sql
+			    ./schema_gen burst-sql > ../../webserver/mysql/airfleet_burst.sql
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+#include "SampleSchema.h"
+
+struct Field {
+	const char *name;
+	uint8_t bytes;
+	bool isSigned;
+	uint8_t decimals;
+	SampleKind kind;
+	const char *sql;
+};
+
+static const Field fields[] = {
+#define FIELD(name, type, decimals, kind, sql) { #name, sizeof(type), std::is_signed<type>::value, decimals, kind, sql },
+	SAMPLE_FIELDS(FIELD)
+#undef FIELD
+};
+static const size_t fieldCount = sizeof(fields) / sizeof(fields[0]);
+
+static void php() {
+	printf("<?php\n");
+	printf("    /*\n");
+	printf("        @brief      Sample fields, generated by tools/schema/schema_gen\n");
+	printf("                    from sensor/src/SampleSchema.h - do not edit\n");
+	printf("    */\n\n");
+
+	// JSON decoding turns 12.0 into 12, so decimals are optional
+	printf("    // Field => array(regex, bind type)\n");
+	printf("    $sample_fields = array(\n");
+	for (size_t i = 0; i < fieldCount; i++) {
+		const Field &f = fields[i];
+		const char *sign = f.isSigned ? "-?" : "";
+		printf("        \"%s\" => array(", f.name);
+		if (f.kind == SAMPLE_TIME) {
+			printf("\"/^[0-9]{13}$/\", \"s\")");
+		} else if (f.decimals > 0) {
+			printf("\"/^%s[0-9]+(\\\\.[0-9]+)?$/\", \"d\")", sign);
+		} else {
+			printf("\"/^%s[0-9]+$/\", \"i\")", sign);
+		}
+		printf("%s\n", i + 1 < fieldCount ? "," : "");
+	}
+	printf("    );\n\n");
+
+	printf("    // UTC epoch ms, stored as datetime(3)\n");
+	printf("    $time_fields = array(");
+	bool first = true;
+	for (size_t i = 0; i < fieldCount; i++) {
+		if (fields[i].kind != SAMPLE_TIME) continue;
+		printf("%s\"%s\"", first ? "" : ", ", fields[i].name);
+		first = false;
+	}
+	printf(");\n\n");
+
+	printf("    // Averaged and sent back to the sensor\n");
+	printf("    $level_fields = array(");
+	first = true;
+	for (size_t i = 0; i < fieldCount; i++) {
+		if (fields[i].kind != SAMPLE_LEVEL) continue;
+		printf("%s\"%s\"", first ? "" : ", ", fields[i].name);
+		first = false;
+	}
+	printf(");\n\n");
+
+	printf("    // Binary samples: version byte, then fields little endian\n");
+	printf("    $sample_version = %d;\n", SAMPLE_SCHEMA_VERSION);
+	printf("    // Field => array(bytes, signed, decimals)\n");
+	printf("    $sample_binary = array(\n");
+	for (size_t i = 0; i < fieldCount; i++) {
+		const Field &f = fields[i];
+		printf("        \"%s\" => array(%u, %s, %u)%s\n", f.name, f.bytes, f.isSigned ? "true" : "false", f.decimals,
+			i + 1 < fieldCount ? "," : "");
+	}
+	printf("    );\n");
+}
+
+static void sql() {
+	printf("-- @brief   SQL structure for AirFleet database\n");
+	printf("--          Generated by tools/schema/schema_gen from sensor/src/SampleSchema.h\n");
+	printf("-- @author  Thomas Stadel\n");
+	printf("-- @date    2024-11-27\n\n");
+
+	printf("CREATE TABLE `airfleet_log` (\n");
+	for (size_t i = 0; i < fieldCount; i++) {
+		printf("  `%s` %s%s\n", fields[i].name, fields[i].sql, i + 1 < fieldCount ? "," : "");
+	}
+	printf(") ENGINE=InnoDB DEFAULT CHARSET=latin1;\n\n");
+
+	printf("ALTER TABLE `airfleet_log`\n");
+	for (size_t i = 0; i < fieldCount; i++) {
+		if (fields[i].kind == SAMPLE_TIME) printf("  ADD PRIMARY KEY (`%s`);\n", fields[i].name);
+	}
+	printf("COMMIT;\n");
+}
+
+// Samples of bursts, see sensor/src/Burst.h
+static void burstSql() {
+	printf("-- @brief   SQL structure for AirFleet burst captures, stored by push_burst.php\n");
+	printf("--          Generated by tools/schema/schema_gen from sensor/src/SampleSchema.h\n");
+	printf("-- @author  Thomas Stadel\n");
+	printf("-- @date    2026-10-18\n\n");
+
+	printf("CREATE TABLE `airfleet_burst` (\n");
+	printf("  `burst` datetime(3) NOT NULL,\n");
+	printf("  `reason` tinyint UNSIGNED NOT NULL,\n");
+	for (size_t i = 0; i < fieldCount; i++) {
+		printf("  `%s` %s%s\n", fields[i].name, fields[i].sql, i + 1 < fieldCount ? "," : "");
+	}
+	printf(") ENGINE=InnoDB DEFAULT CHARSET=latin1;\n\n");
+
+	printf("ALTER TABLE `airfleet_burst`\n");
+	for (size_t i = 0; i < fieldCount; i++) {
+		if (fields[i].kind == SAMPLE_TIME) printf("  ADD PRIMARY KEY (`burst`, `%s`);\n", fields[i].name);
+	}
+	printf("COMMIT;\n");
+}
+
+int main(int argc, char **argv) {
+	if (argc == 2 && strcmp(argv[1], "php") == 0) {
+		php();
+	} else if (argc == 2 && strcmp(argv[1], "sql") == 0) {
+		sql();
+	} else if (argc == 2 && strcmp(argv[1], "burst-sql") == 0) {
+		burstSql();
+	} else {
+		fprintf(stderr, "Usage: %s php|sql|burst-sql\n", argv[0]);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,277 @@
+/*
+	@author:  Thomas Stadel
+	@date:    2026-10-18
+	@brief:   Decodes binary trace logs from the firmware, see Trace.h. Reads
+			  the trace file pulled from flash, or a USB serial capture with
+			  log text mixed in, which is skipped.
+
+			  g++ -std=gnu++17 -O2 -I../../sensor/src trace_decode.cpp -o trace_decode
+			  ./trace_decode trace.bin.old trace.bin     Text, one line per event
+			  ./trace_decode -j trace.bin > trace.json   Timeline for chrome://tracing or Perfetto
+
+			  Files are decoded in the order given. Time is seconds since the
+			  last START record (ignition), with UTC when the device knew it.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "TraceEvents.h"
+#include "Fixed.h"
+
+#define TRACE_NAME(name, track, format) #name,
+static const char *names[] = { TRACE_EVENTS(TRACE_NAME) };
+#undef TRACE_NAME
+
+#define TRACE_TRACK(name, track, format) track,
+static const char *tracks[] = { TRACE_EVENTS(TRACE_TRACK) };
+#undef TRACE_TRACK
+
+struct Record {
+	uint8_t event;
+	uint8_t argc;
+	uint32_t us;
+	uint32_t args[TRACE_MAX_ARGS];
+};
+
+// Formats raw arguments with the event's format. Length modifiers are
+// dropped, arguments are always 32 bits.
+static std::string format(const Record &r) {
+	if (r.event >= TRACE_EVENT_COUNT) {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "unknown event %u", r.event);
+		return buf;
+	}
+
+	std::string out;
+	const char *f = traceFormats[r.event];
+	uint8_t arg = 0;
+	while (*f) {
+		if (*f != '%') {
+			out += *f++;
+			continue;
+		}
+		if (f[1] == '%') {
+			out += '%';
+			f += 2;
+			continue;
+		}
+
+		// Copy flags, width and precision, skip length
+		char spec[16];
+		size_t len = 0;
+		spec[len++] = *f++;
+		while (*f && strchr("-+ #0123456789.", *f) && len < sizeof(spec) - 3) spec[len++] = *f++;
+		while (*f == 'l' || *f == 'h') f++;
+		char conv = *f ? *f++ : 'u';
+		spec[len++] = conv;
+		spec[len] = 0;
+
+		uint32_t raw = arg < r.argc ? r.args[arg] : 0;
+		arg++;
+
+		char buf[64];
+		if (conv == 'q') {
+			const char *dot = strchr(spec, '.');
+			*fixedWrite(buf, (int32_t)raw, dot ? atoi(dot + 1) : 0) = 0;
+		}
+		else if (strchr("feEgG", conv)) {
+			float value;
+			memcpy(&value, &raw, sizeof(value));
+			snprintf(buf, sizeof(buf), spec, (double)value);
+		}
+		else if (conv == 'd' || conv == 'i') {
+			snprintf(buf, sizeof(buf), spec, (int)(int32_t)raw);
+		}
+		else {
+			snprintf(buf, sizeof(buf), spec, (unsigned int)raw);
+		}
+		out += buf;
+	}
+	return out;
+}
+
+// Finds records in a byte stream, resyncing after anything that doesn't check out
+static size_t parse(const std::vector<uint8_t> &data, std::vector<Record> *records) {
+	size_t skipped = 0;
+	size_t i = 0;
+	while (i + TRACE_HEADER_LEN + 1 <= data.size()) {
+		const uint8_t *p = &data[i];
+		uint8_t argc = p[2];
+		size_t len = TRACE_HEADER_LEN + argc * 4 + 1;
+		if (p[0] != TRACE_SYNC || argc > TRACE_MAX_ARGS || i + len > data.size()) {
+			i++;
+			skipped++;
+			continue;
+		}
+
+		uint8_t sum = 0;
+		for (size_t j = 0; j < len - 1; j++) sum += p[j];
+		if (sum != p[len - 1]) {
+			i++;
+			skipped++;
+			continue;
+		}
+
+		Record r;
+		r.event = p[1];
+		r.argc = argc;
+		memcpy(&r.us, p + 3, 4);
+		memcpy(r.args, p + TRACE_HEADER_LEN, argc * 4);
+		records->push_back(r);
+		i += len;
+	}
+	return skipped + (data.size() - i);
+}
+
+static bool load(FILE *in, std::vector<uint8_t> *data) {
+	uint8_t buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), in)) > 0) data->insert(data->end(), buf, buf + n);
+	return !ferror(in);
+}
+
+// micros() wraps every 71 minutes
+struct Clock {
+	bool seen = false;
+	bool started = false;
+	uint32_t lastUs = 0;
+	uint64_t us = 0;			// Since START
+	uint64_t startUnixUs = 0;	// UTC at START, 0 if unknown
+
+	void update(const Record &r) {
+		if (r.event == TRACE_START) {
+			started = true;
+			us = 0;
+			startUnixUs = (uint64_t)r.args[0] * 1000000;
+		}
+		else if (seen) {
+			us += (uint32_t)(r.us - lastUs);
+		}
+		seen = true;
+		lastUs = r.us;
+	}
+};
+
+static void printText(const std::vector<Record> &records) {
+	Clock clock;
+	for (const Record &r : records) {
+		clock.update(r);
+
+		char utc[32] = "";
+		if (clock.startUnixUs != 0) {
+			uint64_t now = clock.startUnixUs + clock.us;
+			time_t secs = now / 1000000;
+			struct tm tm;
+			gmtime_r(&secs, &tm);
+			size_t n = strftime(utc, sizeof(utc), "%Y-%m-%d %H:%M:%S", &tm);
+			snprintf(utc + n, sizeof(utc) - n, ".%03u", (unsigned int)(now / 1000 % 1000));
+		}
+
+		printf("%12.6f  %-23s  %-16s  %s\n", clock.us / 1e6, utc,
+			r.event < TRACE_EVENT_COUNT ? names[r.event] : "?", format(r).c_str());
+	}
+}
+
+// Chrome trace event format. Events on a track become spans lasting until the
+// next event on that track, everything else is an instant on the "events" row.
+static void printTimeline(const std::vector<Record> &records) {
+	std::vector<std::string> rows = { "events" };
+	struct Open {
+		bool open;
+		uint64_t us;
+		std::string name;
+	};
+	std::vector<Open> open;
+	Clock clock;
+	uint64_t offset = 0;	// Each START continues after the previous ignition
+	uint64_t endUs = 0;
+	bool first = true;
+
+	auto row = [&](const char *track) {
+		for (size_t i = 0; i < rows.size(); i++) if (rows[i] == track) return i;
+		rows.push_back(track);
+		open.resize(rows.size());
+		return rows.size() - 1;
+	};
+	auto emit = [&](const char *json) {
+		printf("%s\n  %s", first ? "" : ",", json);
+		first = false;
+	};
+	auto close = [&](size_t tid, uint64_t us) {
+		if (tid >= open.size() || !open[tid].open) return;
+		char json[256];
+		snprintf(json, sizeof(json), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%llu,\"dur\":%llu}",
+			open[tid].name.c_str(), tid, (unsigned long long)open[tid].us, (unsigned long long)(us - open[tid].us));
+		emit(json);
+		open[tid].open = false;
+	};
+
+	open.resize(rows.size());
+	printf("{\"traceEvents\":[");
+	for (const Record &r : records) {
+		if (r.event == TRACE_START && clock.started) offset = endUs;
+		clock.update(r);
+		uint64_t us = offset + clock.us;
+		if (us > endUs) endUs = us;
+
+		std::string text = format(r);
+		const char *track = r.event < TRACE_EVENT_COUNT ? tracks[r.event] : "";
+		if (*track) {
+			size_t tid = row(track);
+			close(tid, us);
+			open[tid].open = true;
+			open[tid].us = us;
+			open[tid].name = text;
+		}
+		else {
+			char json[320];
+			snprintf(json, sizeof(json), "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":0,\"ts\":%llu,\"args\":{\"text\":\"%s\"}}",
+				r.event < TRACE_EVENT_COUNT ? names[r.event] : "?", (unsigned long long)us, text.c_str());
+			emit(json);
+		}
+	}
+	for (size_t tid = 0; tid < rows.size(); tid++) close(tid, endUs);
+
+	// Row names
+	for (size_t tid = 0; tid < rows.size(); tid++) {
+		char json[128];
+		snprintf(json, sizeof(json), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+			tid, rows[tid].c_str());
+		emit(json);
+	}
+	printf("\n]}\n");
+}
+
+int main(int argc, char **argv) {
+	bool timeline = false;
+	int arg = 1;
+	if (arg < argc && strcmp(argv[arg], "-j") == 0) {
+		timeline = true;
+		arg++;
+	}
+
+	std::vector<uint8_t> data;
+	if (arg >= argc) {
+		if (!load(stdin, &data)) return 1;
+	}
+	for (; arg < argc; arg++) {
+		FILE *in = fopen(argv[arg], "rb");
+		if (!in || !load(in, &data)) {
+			fprintf(stderr, "Can't read %s\n", argv[arg]);
+			return 1;
+		}
+		fclose(in);
+	}
+
+	std::vector<Record> records;
+	size_t skipped = parse(data, &records);
+	fprintf(stderr, "%zu records, %zu bytes skipped\n", records.size(), skipped);
+
+	if (timeline) printTimeline(records);
+	else printText(records);
+	return 0;
+}
@@ -0,0 +1,18 @@
+-- @brief   Historical levels per geohash cell, built by hotspots_build.php
+--          and served to sensors as deltas by hotspots.php. Rows with
+--          0 samples are removed cells, kept so sensors learn of it.
+-- @author  Thomas Stadel
+-- @date    2026-10-18
+
+CREATE TABLE `airfleet_hotspots` (
+  `cell` char(6) NOT NULL,
+  `pm` smallint UNSIGNED NOT NULL,
+  `co2` smallint UNSIGNED NOT NULL,
+  `samples` int UNSIGNED NOT NULL,
+  `version` int UNSIGNED NOT NULL
+) ENGINE=InnoDB DEFAULT CHARSET=latin1;
+
+ALTER TABLE `airfleet_hotspots`
+  ADD PRIMARY KEY (`cell`),
+  ADD KEY `version` (`version`, `cell`);
+COMMIT;
@@ -11,4 +11,8 @@
     $_db_username = "airfleet_user";
     $_db_password = "********";
     
-    $_api_token = "*********";
\ No newline at end of file
+    $_api_token = "*********";
+    // Hotspot map
+    $_hotspot_page = 24;            // Cells per response, must match HOTSPOT_PAGE in firmware
+    $_hotspot_days = 30;            // Samples averaged per cell
+    $_hotspot_min_samples = 10;     // Samples before a cell is published
@@ -0,0 +1,56 @@
+<?php
+    /*
+        @brief      Returns hotspot map cells changed since the sensor's cursor.
+                    Called by the "air-quality-hotspots" webhook with the event
+                    data as ?since=<version>,<cell>. Plain text, to fit a
+                    webhook response:
+                    <more>,<version>;<cell>,<pm x10>,<co2>;...
+                    A cell with 0,0 has been removed from the map.
+        @author     Thomas Stadel
+        @date       2026-10-18
+    */
+
+    // Include config
+    require_once("config.php");
+
+    // Validate client
+    if (empty($_SERVER["HTTP_API_KEY"]) or $_SERVER["HTTP_API_KEY"] != $_api_token) {
+        http_response_code(403);
+        die("Forbidden");
+    }
+
+    // Cursor: version and cell of the last cell the sensor has
+    $since = isset($_GET["since"]) ? $_GET["since"] : "0,";
+    if (!preg_match("/^([0-9]+),([0-9b-hjkmnp-z]{6})?$/", $since, $match)) die("Invalid cursor");
+    $version = intval($match[1]);
+    $cell = isset($match[2]) ? $match[2] : "";
+
+    // Connect to DB
+    $db = new mysqli($_db_hostname, $_db_username, $_db_password, $_db_database);
+    if ($db->connect_errno) die("DB error 1");
+
+    // One more than a page, to tell if more follow
+    $limit = $_hotspot_page + 1;
+    $stmt = $db->prepare("SELECT cell, pm, co2, version FROM airfleet_hotspots " .
+        "WHERE version > ? OR (version = ? AND cell > ?) " .
+        "ORDER BY version, cell LIMIT ?");
+    if (!$stmt) die("DB error 2");
+    if (!$stmt->bind_param("iisi", $version, $version, $cell, $limit)) die("DB error 3");
+    if (!$stmt->execute()) die("DB error 4");
+    $res = $stmt->get_result();
+
+    $cells = array();
+    $more = 0;
+    while ($row = $res->fetch_assoc()) {
+        if (count($cells) == $_hotspot_page) {
+            $more = 1;
+            break;
+        }
+        $cells[] = $row["cell"] . "," . $row["pm"] . "," . $row["co2"];
+        $version = intval($row["version"]);
+    }
+
+    // Headers
+    header("Content-type: text/plain");
+
+    echo($more . "," . $version . (count($cells) ? ";" . implode(";", $cells) : ""));
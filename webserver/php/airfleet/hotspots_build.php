@@ -0,0 +1,69 @@
+<?php
+    /*
+        @brief      Rebuilds hotspot map from logged samples, run from cron.
+                    Cells whose levels changed get a new version, so sensors
+                    only fetch what changed since they last synced. Cells
+                    that dropped out of the window or below the minimum
+                    samples are kept as 0,0 with a new version, which tells
+                    sensors to remove them.
+        @author     Thomas Stadel
+        @date       2026-10-18
+    */
+
+    // Include config
+    require_once("config.php");
+
+    // Command line only
+    if (php_sapi_name() != "cli") {
+        http_response_code(403);
+        die("Forbidden");
+    }
+
+    // Connect to DB
+    $db = new mysqli($_db_hostname, $_db_username, $_db_password, $_db_database);
+    if ($db->connect_errno) die("DB error 1\n");
+
+    // Next version
+    $res = $db->query("SELECT COALESCE(MAX(version), 0) + 1 AS version FROM airfleet_hotspots");
+    if (!$res or !$row = $res->fetch_assoc()) die("DB error 2\n");
+    $version = intval($row["version"]);
+
+    // Average per cell, PM as max part in 0.1 ug/m3, without readings taken
+    // before the sensors settled
+    $sql = "CREATE TEMPORARY TABLE airfleet_hotspots_new (" .
+            "c char(6) NOT NULL PRIMARY KEY, p smallint UNSIGNED NOT NULL, " .
+            "o smallint UNSIGNED NOT NULL, n int UNSIGNED NOT NULL" .
+        ") ENGINE=MEMORY DEFAULT CHARSET=latin1 " .
+        "SELECT ST_GeoHash(lng, lat, 6) AS c, " .
+            "ROUND(AVG(GREATEST(pm1, pm25, pm4, pm10)) * 10) AS p, " .
+            "ROUND(AVG(co2)) AS o, COUNT(*) AS n " .
+        "FROM airfleet_log " .
+        "WHERE time >= ? AND flags = 0 AND lat IS NOT NULL AND lng IS NOT NULL AND (lat != 0 OR lng != 0) " .
+        "GROUP BY c HAVING n >= ?";
+    if (!$stmt = $db->prepare($sql)) die("DB error 3\n");
+    $since = gmdate("Y-m-d H:i:s", strtotime("-$_hotspot_days days"));
+    if (!$stmt->bind_param("si", $since, $_hotspot_min_samples)) die("DB error 4\n");
+    if (!$stmt->execute()) die("DB error 5\n");
+
+    // Version only changes when levels moved enough to matter on the
+    // sensor, or a removed cell is back
+    $sql = "INSERT INTO airfleet_hotspots (cell, pm, co2, samples, version) " .
+        "SELECT c, p, o, n, ? FROM airfleet_hotspots_new " .
+        "ON DUPLICATE KEY UPDATE " .
+            "version = IF(samples = 0 OR ABS(CAST(pm AS SIGNED) - VALUES(pm)) >= 5 OR ABS(CAST(co2 AS SIGNED) - VALUES(co2)) >= 10, VALUES(version), version), " .
+            "pm = VALUES(pm), co2 = VALUES(co2), samples = VALUES(samples)";
+    if (!$stmt = $db->prepare($sql)) die("DB error 6\n");
+    if (!$stmt->bind_param("i", $version)) die("DB error 7\n");
+    if (!$stmt->execute()) die("DB error 8\n");
+    $updated = $stmt->affected_rows;
+
+    // Stale cells, sent as 0,0 so sensors drop them
+    $sql = "UPDATE airfleet_hotspots h LEFT JOIN airfleet_hotspots_new t ON t.c = h.cell " .
+        "SET h.pm = 0, h.co2 = 0, h.samples = 0, h.version = ? " .
+        "WHERE t.c IS NULL AND h.samples > 0";
+    if (!$stmt = $db->prepare($sql)) die("DB error 9\n");
+    if (!$stmt->bind_param("i", $version)) die("DB error 10\n");
+    if (!$stmt->execute()) die("DB error 11\n");
+    $removed = $stmt->affected_rows;
+
+    echo("Version $version, $updated rows affected, $removed cells removed\n");
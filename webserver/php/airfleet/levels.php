@@ -7,6 +7,7 @@
 
     // Include config
     require_once("config.php");
+    require_once("schema.php");
 
     // Validate client
     if (empty($_SERVER["HTTP_API_KEY"]) or $_SERVER["HTTP_API_KEY"] != $_api_token) {
@@ -18,9 +19,11 @@
     $db = new mysqli($_db_hostname, $_db_username, $_db_password, $_db_database);
     if ($db->connect_errno) die("DB error 1");
 
-    // Get average
-    $res = $db->query("SELECT AVG(co2) AS co2, AVG(pm1) AS pm1, AVG(pm25) AS pm25, AVG(pm4) AS pm4, AVG(pm10) AS pm10 " . 
-        "FROM airfleet_log WHERE time >= '" . date("Y-m-d H:i:s", strtotime("-1 day")) . "'");
+    // Get average, without readings taken before the sensors settled
+    $averages = array();
+    foreach ($level_fields as $field) $averages[] = "AVG($field) AS $field";
+    $res = $db->query("SELECT " . implode(", ", $averages) . " " .
+        "FROM airfleet_log WHERE flags = 0 AND time >= '" . gmdate("Y-m-d H:i:s", strtotime("-1 day")) . "'");
     if (!$res) die("DB error 2");
 
     // Get result row
@@ -8,6 +8,7 @@
 
     // Include config
     require_once("config.php");
+    require_once("schema.php");
 
     // Validate client
     if (empty($_SERVER["HTTP_API_KEY"]) or $_SERVER["HTTP_API_KEY"] != $_api_token) {
@@ -23,30 +24,23 @@
 
     // TODO: Add some authenticity
 
-    // Validate data
-    $expected_fields = array(
-        "pm1" => array("/^[0-9\.]+$/", "d"),
-        "pm25" => array("/^[0-9\.]+$/", "d"),
-        "pm4" => array("/^[0-9\.]+$/", "d"),
-        "pm10" => array("/^[0-9\.]+$/", "d"),
-        "temp" => array("/^[0-9\.]+$/", "d"),
-        "humi" => array("/^[0-9\.]+$/", "d"),
-        "voc" => array("/^[0-9]*$/", "i"),
-        "co2" => array("/^[0-9]*$/", "i"),
-        "lat" => array("/^[0-9\.]+$/", "d"),
-        "lng" => array("/^[0-9\.]+$/", "d"),
-        "time" => array("/^20[0-9]{2}-[0-9]{2}-[0-9]{2} [0-9]{2}:[0-9]{2}:[0-9]{2}$/", "s")
-    );
+    // Validate data against schema
     $fields = array();
     $values = array();
     $types = array();
-    foreach ($expected_fields as $field => $arr) {
+    foreach ($sample_fields as $field => $arr) {
+        if (!isset($data[$field])) continue;
         if (!preg_match($arr[0], $data[$field])) die("Invalid data in field: $field");
-        if (isset($data[$field]) and strlen($data[$field]) > 0) {
-            $fields[] = $field;
-            $values[] = $data[$field];
-            $types[] = $arr[1];
-        }
+        $fields[] = $field;
+        $values[] = $data[$field];
+        $types[] = $arr[1];
+    }
+
+    // Times arrive as UTC epoch ms, store with ms precision
+    foreach ($time_fields as $field) {
+        if (($i = array_search($field, $fields)) === false) die("Missing field: $field");
+        $t = intval($values[$i]);
+        $values[$i] = gmdate("Y-m-d H:i:s", intdiv($t, 1000)) . sprintf(".%03d", $t % 1000);
     }
     if (count($fields) == 0) die("No data to store");
 
@@ -0,0 +1,74 @@
+<?php
+    /*
+        @brief      Endpoint for bulk upload of samples exported over USB
+                    with tools/journal_export -f json. One sample per line,
+                    as in push.php. Samples already stored are skipped, so
+                    an upload can be repeated.
+        @author     Thomas Stadel
+        @date       2026-10-18
+    */
+
+    // Include config
+    require_once("config.php");
+    require_once("schema.php");
+
+    // Validate client
+    if (empty($_SERVER["HTTP_API_KEY"]) or $_SERVER["HTTP_API_KEY"] != $_api_token) {
+        http_response_code(403);
+        die("Forbidden");
+    }
+
+    // Connect to DB
+    $db = new mysqli($_db_hostname, $_db_username, $_db_password, $_db_database);
+    if ($db->connect_errno) die("DB error 1");
+
+    // One transaction for all, so a bad line stores nothing
+    $db->begin_transaction();
+    $statements = array();
+    $stored = 0;
+    $line_no = 0;
+    $input = fopen("php://input", "r");
+    while (($line = fgets($input)) !== false) {
+        $line_no++;
+        if (trim($line) == "") continue;
+        if (!$data = json_decode($line, true)) die("Unable to parse line $line_no");
+
+        // Validate data against schema
+        $fields = array();
+        $values = array();
+        $types = array();
+        foreach ($sample_fields as $field => $arr) {
+            if (!isset($data[$field])) continue;
+            if (!preg_match($arr[0], $data[$field])) die("Invalid data in field: $field, line $line_no");
+            $fields[] = $field;
+            $values[] = $data[$field];
+            $types[] = $arr[1];
+        }
+
+        // Times arrive as UTC epoch ms, store with ms precision
+        foreach ($time_fields as $field) {
+            if (($i = array_search($field, $fields)) === false) die("Missing field: $field, line $line_no");
+            $t = intval($values[$i]);
+            $values[$i] = gmdate("Y-m-d H:i:s", intdiv($t, 1000)) . sprintf(".%03d", $t % 1000);
+        }
+
+        // Prepare query, once per set of fields
+        $key = implode(",", $fields);
+        if (!isset($statements[$key])) {
+            $sql = "INSERT IGNORE INTO airfleet_log " .
+                "(" . $key . ") " .
+                "VALUES " .
+                "(" . implode(",", array_fill(0, count($fields), "?")) . ")";
+            if (!$statements[$key] = $db->prepare($sql)) die("DB error 2");
+        }
+        $stmt = $statements[$key];
+
+        // Bind parameters and insert
+        if (!$stmt->bind_param(implode("", $types), ...$values)) die("DB error 3");
+        if (!$stmt->execute()) die("DB error 4, line $line_no");
+        $stored += $stmt->affected_rows;
+    }
+    if (!$db->commit()) die("DB error 5");
+
+    // All OK
+    die("OK $stored of $line_no");
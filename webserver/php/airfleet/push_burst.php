@@ -0,0 +1,85 @@
+<?php
+    /*
+        @brief      Endpoint for burst captures, see sensor/src/Burst.h.
+                    Each publish is one part of a burst, with samples in
+                    binary form as base64. Parts are stored as they arrive,
+                    samples already stored are skipped.
+        @author     Thomas Stadel
+        @date       2026-10-18
+    */
+
+    // Include config
+    require_once("config.php");
+    require_once("schema.php");
+
+    // Validate client
+    if (empty($_SERVER["HTTP_API_KEY"]) or $_SERVER["HTTP_API_KEY"] != $_api_token) {
+        http_response_code(403);
+        die("Forbidden");
+    }
+
+    // Read JSON
+    if (!$json = json_decode(file_get_contents("php://input"), true)) die("Unable to parse JSON");
+
+    // Data
+    if (!$data = json_decode($json["data"], true)) die("Unable to parse data");
+    foreach (array("burst", "reason", "samples") as $field) {
+        if (!isset($data[$field])) die("Missing field: $field");
+    }
+    if (!preg_match("/^[0-9]{13}$/", $data["burst"])) die("Invalid data in field: burst");
+    if (!preg_match("/^[0-9]+$/", $data["reason"])) die("Invalid data in field: reason");
+    if (($raw = base64_decode($data["samples"], true)) === false) die("Invalid data in field: samples");
+
+    // Version byte and fields
+    $record_len = 1;
+    foreach ($sample_binary as $arr) $record_len += $arr[0];
+    if (strlen($raw) == 0 or strlen($raw) % $record_len != 0) die("Invalid data in field: samples");
+
+    // UTC epoch ms as datetime(3)
+    function ms_datetime($t) {
+        return gmdate("Y-m-d H:i:s", intdiv($t, 1000)) . sprintf(".%03d", $t % 1000);
+    }
+
+    // Fixed point integer as decimal text, exact
+    function fixed_text($value, $decimals) {
+        if ($decimals == 0) return strval($value);
+        $digits = str_pad(strval(abs($value)), $decimals + 1, "0", STR_PAD_LEFT);
+        return ($value < 0 ? "-" : "") . substr($digits, 0, -$decimals) . "." . substr($digits, -$decimals);
+    }
+
+    // Connect to DB
+    $db = new mysqli($_db_hostname, $_db_username, $_db_password, $_db_database);
+    if ($db->connect_errno) die("DB error 1");
+
+    // Prepare query
+    $fields = array_merge(array("burst", "reason"), array_keys($sample_binary));
+    $sql = "INSERT IGNORE INTO airfleet_burst " .
+        "(" . implode(",", $fields) . ") " .
+        "VALUES " .
+        "(" . implode(",", array_fill(0, count($fields), "?")) . ")";
+    if (!$stmt = $db->prepare($sql)) die("DB error 2");
+
+    // Decode and insert samples, all or none
+    $db->begin_transaction();
+    for ($pos = 0; $pos < strlen($raw); ) {
+        if (ord($raw[$pos]) != $sample_version) die("Unsupported sample version");
+        $pos++;
+
+        $values = array(ms_datetime(intval($data["burst"])), $data["reason"]);
+        foreach ($sample_binary as $field => $arr) {
+            // Little endian, sign extended
+            $value = 0;
+            for ($i = $arr[0] - 1; $i >= 0; $i--) $value = ($value << 8) | ord($raw[$pos + $i]);
+            if ($arr[1] and $value >= 1 << (8 * $arr[0] - 1)) $value -= 1 << (8 * $arr[0]);
+            $pos += $arr[0];
+
+            $values[] = in_array($field, $time_fields) ? ms_datetime($value) : fixed_text($value, $arr[2]);
+        }
+
+        if (!$stmt->bind_param(str_repeat("s", count($values)), ...$values)) die("DB error 3");
+        if (!$stmt->execute()) die("DB error 4");
+    }
+    if (!$db->commit()) die("DB error 5");
+
+    // All OK
+    die("OK");
@@ -0,0 +1,47 @@
+<?php
+    /*
+        @brief      Sample fields, generated by tools/schema/schema_gen
+                    from sensor/src/SampleSchema.h - do not edit
+    */
+
+    // Field => array(regex, bind type)
+    $sample_fields = array(
+        "pm1" => array("/^[0-9]+(\\.[0-9]+)?$/", "d"),
+        "pm25" => array("/^[0-9]+(\\.[0-9]+)?$/", "d"),
+        "pm4" => array("/^[0-9]+(\\.[0-9]+)?$/", "d"),
+        "pm10" => array("/^[0-9]+(\\.[0-9]+)?$/", "d"),
+        "temp" => array("/^-?[0-9]+(\\.[0-9]+)?$/", "d"),
+        "humi" => array("/^[0-9]+(\\.[0-9]+)?$/", "d"),
+        "voc" => array("/^[0-9]+$/", "i"),
+        "co2" => array("/^[0-9]+$/", "i"),
+        "lat" => array("/^-?[0-9]+(\\.[0-9]+)?$/", "d"),
+        "lng" => array("/^-?[0-9]+(\\.[0-9]+)?$/", "d"),
+        "batt" => array("/^[0-9]+(\\.[0-9]+)?$/", "d"),
+        "flags" => array("/^[0-9]+$/", "i"),
+        "time" => array("/^[0-9]{13}$/", "s")
+    );
+
+    // UTC epoch ms, stored as datetime(3)
+    $time_fields = array("time");
+
+    // Averaged and sent back to the sensor
+    $level_fields = array("pm1", "pm25", "pm4", "pm10", "co2");
+
+    // Binary samples: version byte, then fields little endian
+    $sample_version = 4;
+    // Field => array(bytes, signed, decimals)
+    $sample_binary = array(
+        "pm1" => array(2, false, 1),
+        "pm25" => array(2, false, 1),
+        "pm4" => array(2, false, 1),
+        "pm10" => array(2, false, 1),
+        "temp" => array(2, true, 2),
+        "humi" => array(2, false, 2),
+        "voc" => array(2, false, 0),
+        "co2" => array(2, false, 0),
+        "lat" => array(4, true, 7),
+        "lng" => array(4, true, 7),
+        "batt" => array(2, false, 3),
+        "flags" => array(1, false, 0),
+        "time" => array(8, false, 0)
+    );